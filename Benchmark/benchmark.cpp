@@ -0,0 +1,1642 @@
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#pragma warning(push, 0)
+#include <learnopengl/filesystem.h>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/camera.h>
+#include <learnopengl/model.h>
+#include <learnopengl/transform_hierarchy.h>
+#include <learnopengl/transform_kernels.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/entity.h>
+#pragma warning(pop)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "headless_context.h"
+#include "render_target.h"
+#include "scene.h"
+#include "anti_aliasing.h"
+#include "aabb_tree.h"
+#include "occlusion_culler.h"
+#include "loose_octree.h"
+
+// Renders the demo scene offscreen for a fixed number of frames along a scripted
+// camera path with a fixed timestep and reports frame-time percentiles and GPU
+// pass timings. Exits with 1 when a configured budget is exceeded, so it can
+// gate build servers. Run it from the OpenGLDemo directory, like the demo.
+
+struct BenchmarkSettings
+{
+	int width = 1280;
+	int height = 720;
+	AntiAliasing antiAliasing = AntiAliasing::Msaa4;
+	// also run every anti-aliasing mode and print their timings side by side
+	bool compareAntiAliasing = false;
+	unsigned int frames = 600;
+	// rendered before measuring so shader compilation and driver warm-up do not count
+	unsigned int warmupFrames = 60;
+	float timestep = 1.0f / 60.0f;
+	unsigned int shaderFeatures = FEATURE_DAY;
+	float fogIntensity = 0.0f;
+	// 95th percentile frame time and mean total GPU time per frame allowed, 0 = no budget
+	double frameBudget = 0.0;
+	double gpuBudget = 0.0;
+	const char* tracePath = nullptr;
+	// scene file to render, nullptr = the demo's
+	const char* scenePath = nullptr;
+	// nodes of the CPU transform hierarchy benchmark, 0 = render the scene instead
+	unsigned int hierarchyNodes = 0;
+	// objects of the CPU frustum culling benchmark, 0 = render the scene instead
+	unsigned int visibilityObjects = 0;
+	// objects of the CPU occlusion culling benchmark, 0 = render the scene instead
+	unsigned int occlusionObjects = 0;
+	// objects of the largest static scene of the loose octree benchmark, 0 = render the scene instead
+	unsigned int octreeObjects = 0;
+	// matrices and boxes per batch of the transform kernel benchmark, 0 = render the scene instead
+	unsigned int kernelElements = 0;
+	// entities of the scene file loading benchmark, 0 = render the scene instead
+	unsigned int sceneLoadEntities = 0;
+	// triangles of every mesh of the level of detail benchmark, 0 = render the scene instead
+	unsigned int lodTriangles = 0;
+};
+
+struct Statistics
+{
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p90 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+// deterministic pseudo random numbers, so that runs of a CPU benchmark compare
+struct BenchmarkRandom
+{
+	uint32_t seed = 12345;
+
+	uint32_t next()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	float uniform(float min, float max)
+	{
+		return min + (max - min) * static_cast<float>(next() & 0xFFFF) / 65535.0f;
+	}
+};
+
+struct PassSamples
+{
+	const char* name;
+	std::vector<double> milliseconds;
+};
+
+struct BenchmarkResult
+{
+	std::vector<double> frameTimes;
+	std::vector<PassSamples> passes;
+};
+
+bool parseArguments(int argc, char* argv[], BenchmarkSettings& settings);
+BenchmarkResult runBenchmark(const BenchmarkSettings& settings, AntiAliasing antiAliasing, DemoScene& scene, FxaaPass& fxaaPass, GpuProfiler& gpuProfiler);
+void setCameraPath(Camera& camera, float progress);
+Statistics computeStatistics(std::vector<double> samples);
+void addPassTimings(std::vector<PassSamples>& passes, const std::vector<GpuPassTiming>& timings);
+double getPassMean(const std::vector<PassSamples>& passes, const char* name);
+bool runHierarchyBenchmark(const BenchmarkSettings& settings);
+bool runVisibilityBenchmark(const BenchmarkSettings& settings);
+bool runOcclusionBenchmark(const BenchmarkSettings& settings);
+bool runOctreeBenchmark(const BenchmarkSettings& settings);
+bool runOctreeScene(const BenchmarkSettings& settings, unsigned int count, bool applyBudget);
+bool runKernelBenchmark(const BenchmarkSettings& settings);
+bool runSceneLoadBenchmark(const BenchmarkSettings& settings);
+bool runLodBenchmark(const BenchmarkSettings& settings);
+
+// settings
+float nearPlane = 0.1f;
+float farPlane = 100.0f;
+
+JobSystem jobSystem;
+Profiler profiler;
+
+
+int main(int argc, char* argv[])
+{
+	BenchmarkSettings settings;
+	if (!parseArguments(argc, argv, settings))
+		return -1;
+
+	// CPU only, no context needed
+	if (settings.hierarchyNodes > 0)
+		return runHierarchyBenchmark(settings) ? 0 : 1;
+	if (settings.visibilityObjects > 0)
+		return runVisibilityBenchmark(settings) ? 0 : 1;
+	if (settings.occlusionObjects > 0)
+		return runOcclusionBenchmark(settings) ? 0 : 1;
+	if (settings.octreeObjects > 0)
+		return runOctreeBenchmark(settings) ? 0 : 1;
+	if (settings.kernelElements > 0)
+		return runKernelBenchmark(settings) ? 0 : 1;
+	if (settings.sceneLoadEntities > 0)
+		return runSceneLoadBenchmark(settings) ? 0 : 1;
+	if (settings.lodTriangles > 0)
+		return runLodBenchmark(settings) ? 0 : 1;
+
+	SceneFile sceneFile;
+	if (!sceneFile.load(settings.scenePath ? std::string(settings.scenePath) : FileSystem::getPath("Resources/scenes/demo.scene")))
+		return -1;
+
+	HeadlessContext context;
+	if (!context.isValid())
+		return -1;
+	ProgramBuild::enableParallelCompile(HeadlessContext::getLoader());
+
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+
+	profiler.setThreadName("Render");
+	jobSystem.setTimingHook([](const JobTiming& timing) { profiler.recordJob(timing); });
+	GpuProfiler gpuProfiler(profiler);
+
+	ProgramCache programCache("ShaderCache");
+	DemoScene scene(programCache, jobSystem, profiler, sceneFile);
+	FxaaPass fxaaPass(programCache);
+
+	const BenchmarkResult result = runBenchmark(settings, settings.antiAliasing, scene, fxaaPass, gpuProfiler);
+
+	if (settings.tracePath)
+		profiler.writeChromeTrace(settings.tracePath);
+
+
+	// report
+	// ------
+	const Statistics frameStatistics = computeStatistics(result.frameTimes);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << settings.frames << " frames at " << settings.width << "x" << settings.height << ", "
+		<< getAntiAliasingName(settings.antiAliasing) << ", timestep " << settings.timestep * 1000.0f << " ms" << std::endl;
+	std::cout << "Frame time (ms): mean " << frameStatistics.mean << "  p50 " << frameStatistics.p50
+		<< "  p90 " << frameStatistics.p90 << "  p95 " << frameStatistics.p95
+		<< "  p99 " << frameStatistics.p99 << "  max " << frameStatistics.max << std::endl;
+
+	double gpuTotal = 0.0;
+	std::cout << "GPU passes (ms):" << std::endl;
+	for (const PassSamples& pass : result.passes)
+	{
+		const Statistics passStatistics = computeStatistics(pass.milliseconds);
+		gpuTotal += passStatistics.mean;
+		std::cout << "  " << std::left << std::setw(18) << pass.name << std::right
+			<< " mean " << passStatistics.mean << "  p95 " << passStatistics.p95 << "  max " << passStatistics.max << std::endl;
+	}
+	std::cout << "  " << std::left << std::setw(18) << "total" << std::right << " mean " << gpuTotal << std::endl;
+	if (gpuProfiler.getDroppedCount() > 0)
+		std::cout << "  (" << gpuProfiler.getDroppedCount() << " frames without GPU results)" << std::endl;
+
+	// the same run once per anti-aliasing mode; the AA column is the resolve or FXAA pass alone
+	if (settings.compareAntiAliasing)
+	{
+		std::cout << "Anti-aliasing (ms):" << std::endl;
+		std::cout << "  mode      frame mean   frame p95   GPU total   AA pass" << std::endl;
+		for (AntiAliasing mode : antiAliasingModes)
+		{
+			const BenchmarkResult modeResult = runBenchmark(settings, mode, scene, fxaaPass, gpuProfiler);
+			const Statistics modeStatistics = computeStatistics(modeResult.frameTimes);
+			double modeGpuTotal = 0.0;
+			for (const PassSamples& pass : modeResult.passes)
+				modeGpuTotal += computeStatistics(pass.milliseconds).mean;
+			const double aaPass = mode == AntiAliasing::Fxaa ? getPassMean(modeResult.passes, "fxaa") : getPassMean(modeResult.passes, "resolve");
+
+			std::cout << "  " << std::left << std::setw(8) << getAntiAliasingName(mode) << std::right
+				<< std::setw(12) << modeStatistics.mean << std::setw(12) << modeStatistics.p95
+				<< std::setw(12) << modeGpuTotal << std::setw(10) << aaPass << std::endl;
+		}
+	}
+
+	bool withinBudget = true;
+	if (settings.frameBudget > 0.0 && frameStatistics.p95 > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 frame time " << frameStatistics.p95 << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		withinBudget = false;
+	}
+	if (settings.gpuBudget > 0.0 && gpuTotal > settings.gpuBudget)
+	{
+		std::cout << "FAILED: mean GPU time " << gpuTotal << " ms exceeds the budget of " << settings.gpuBudget << " ms" << std::endl;
+		withinBudget = false;
+	}
+	return withinBudget ? 0 : 1;
+}
+
+bool parseArguments(int argc, char* argv[], BenchmarkSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (argument == "--frames" && hasValue)
+			settings.frames = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--warmup" && hasValue)
+			settings.warmupFrames = std::max(0, std::atoi(argv[++i]));
+		else if (argument == "--size" && hasValue)
+		{
+			if (std::sscanf(argv[++i], "%dx%d", &settings.width, &settings.height) != 2 || settings.width <= 0 || settings.height <= 0)
+			{
+				std::cout << "Invalid size, expected WIDTHxHEIGHT" << std::endl;
+				return false;
+			}
+		}
+		else if (argument == "--aa" && hasValue)
+		{
+			if (!parseAntiAliasing(argv[++i], settings.antiAliasing))
+			{
+				std::cout << "Invalid anti-aliasing mode, expected none, msaa2, msaa4, msaa8 or fxaa" << std::endl;
+				return false;
+			}
+		}
+		else if (argument == "--compare-aa")
+			settings.compareAntiAliasing = true;
+		else if (argument == "--timestep" && hasValue)
+			settings.timestep = static_cast<float>(std::atof(argv[++i])) / 1000.0f;
+		else if (argument == "--night")
+			settings.shaderFeatures &= ~FEATURE_DAY;
+		else if (argument == "--blinn")
+			settings.shaderFeatures |= FEATURE_BLINN;
+		else if (argument == "--fog" && hasValue)
+		{
+			settings.fogIntensity = glm::clamp(static_cast<float>(std::atof(argv[++i])), 0.0f, 1.0f);
+			if (settings.fogIntensity > 0.0f)
+				settings.shaderFeatures |= FEATURE_FOG;
+		}
+		else if (argument == "--budget" && hasValue)
+			settings.frameBudget = std::atof(argv[++i]);
+		else if (argument == "--gpu-budget" && hasValue)
+			settings.gpuBudget = std::atof(argv[++i]);
+		else if (argument == "--trace" && hasValue)
+			settings.tracePath = argv[++i];
+		else if (argument == "--scene" && hasValue)
+			settings.scenePath = argv[++i];
+		else if (argument == "--hierarchy" && hasValue)
+			settings.hierarchyNodes = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--visibility" && hasValue)
+			settings.visibilityObjects = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--occlusion" && hasValue)
+			settings.occlusionObjects = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--octree" && hasValue)
+			settings.octreeObjects = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--kernels" && hasValue)
+			settings.kernelElements = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--scene-load" && hasValue)
+			settings.sceneLoadEntities = std::max(1, std::atoi(argv[++i]));
+		else if (argument == "--lods" && hasValue)
+			settings.lodTriangles = std::max(1, std::atoi(argv[++i]));
+		else
+		{
+			std::cout << "Usage: Benchmark [--frames N] [--warmup N] [--size WxH] [--aa MODE] [--compare-aa] [--timestep MS]\n"
+				"                 [--night] [--blinn] [--fog INTENSITY] [--budget MS] [--gpu-budget MS] [--trace FILE] [--scene FILE]\n"
+				"       Benchmark --hierarchy NODES [--frames N] [--warmup N] [--budget MS]\n"
+				"       Benchmark --visibility OBJECTS [--frames N] [--warmup N] [--budget MS]\n"
+				"       Benchmark --occlusion OBJECTS [--frames N] [--warmup N] [--budget MS]\n"
+				"       Benchmark --octree OBJECTS [--frames N] [--warmup N] [--budget MS]\n"
+				"       Benchmark --kernels ELEMENTS [--frames N] [--warmup N] [--budget MS]\n"
+				"       Benchmark --scene-load ENTITIES [--frames N] [--warmup N] [--budget MS]\n"
+				"       Benchmark --lods TRIANGLES [--budget MS]" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// renders the scripted run with the given anti-aliasing mode and collects frame and GPU pass times
+BenchmarkResult runBenchmark(const BenchmarkSettings& settings, AntiAliasing antiAliasing, DemoScene& scene, FxaaPass& fxaaPass, GpuProfiler& gpuProfiler)
+{
+	RenderTarget sceneTarget(settings.width, settings.height, getSampleCount(antiAliasing));
+	RenderTarget outputTarget(settings.width, settings.height);
+
+	Camera camera;
+	FrameSnapshot frame;
+	frame.shaderFeatures = settings.shaderFeatures;
+	frame.isDay = (settings.shaderFeatures & FEATURE_DAY) != 0;
+	frame.useBlinn = (settings.shaderFeatures & FEATURE_BLINN) != 0;
+	frame.fogIntensity = settings.fogIntensity;
+	frame.viewportHeight = static_cast<float>(settings.height);
+
+	BenchmarkResult result;
+	result.frameTimes.reserve(settings.frames);
+	uint64_t firstMeasuredFrame = 0;
+	uint64_t lastReadFrame = gpuProfiler.getLatestFrame();
+
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		profiler.beginFrame();
+		gpuProfiler.beginFrame();
+		if (i == settings.warmupFrames)
+			firstMeasuredFrame = profiler.getFrame();
+		if (gpuProfiler.getLatestFrame() != lastReadFrame && gpuProfiler.getLatestFrame() >= firstMeasuredFrame && firstMeasuredFrame != 0)
+			addPassTimings(result.passes, gpuProfiler.getLatest());
+		lastReadFrame = gpuProfiler.getLatestFrame();
+
+		const auto start = std::chrono::steady_clock::now();
+		{
+			ProfileScope frameScope(profiler, "frame");
+
+			// simulate with the fixed timestep, independent of how long frames take
+			const float time = i * settings.timestep;
+			frame.time = time;
+			scene.update(time, 0.0f, 0.0f);
+			setCameraPath(camera, static_cast<float>(i) / totalFrames);
+			scene.setViews(frame, camera, static_cast<float>(settings.width) / settings.height, nearPlane, farPlane);
+			scene.recordFrame(frame);
+			scene.cullFrame(frame);
+			scene.selectLods(frame);
+
+			sceneTarget.bind();
+			scene.render(frame, gpuProfiler);
+
+			// finish the image the way the demo presents it, so the anti-aliasing cost is included
+			if (antiAliasing == AntiAliasing::Fxaa)
+			{
+				gpuProfiler.begin("fxaa");
+				outputTarget.bind();
+				fxaaPass.apply(sceneTarget.getColorTexture(), settings.width, settings.height, settings.width, settings.height);
+				gpuProfiler.end();
+			}
+			else if (sceneTarget.getSamples() > 0)
+			{
+				gpuProfiler.begin("resolve");
+				sceneTarget.blitTo(outputTarget.getFramebuffer(), settings.width, settings.height);
+				gpuProfiler.end();
+			}
+
+			// there is no swap to pace the CPU, so wait for the GPU to get the full frame time
+			glFinish();
+		}
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (i >= settings.warmupFrames)
+			result.frameTimes.push_back(milliseconds);
+
+		profiler.collect();
+	}
+
+	// read back the queries of the last frames
+	for (unsigned int i = 0; i < GpuProfiler::latency; i++)
+	{
+		profiler.beginFrame();
+		gpuProfiler.beginFrame();
+		if (gpuProfiler.getLatestFrame() != lastReadFrame && gpuProfiler.getLatestFrame() >= firstMeasuredFrame)
+			addPassTimings(result.passes, gpuProfiler.getLatest());
+		lastReadFrame = gpuProfiler.getLatestFrame();
+	}
+	return result;
+}
+
+// one orbit around the scene over the whole run, bobbing up and down and
+// passing in front of the mirror so the reflected pass has work to do
+void setCameraPath(Camera& camera, float progress)
+{
+	constexpr glm::vec3 center = glm::vec3(1.0f, 1.0f, 5.0f);
+	const float angle = progress * glm::two_pi<float>();
+
+	camera.Position = center + glm::vec3(9.0f * glm::cos(angle), 3.0f + glm::sin(2.0f * angle), 7.0f * glm::sin(angle) + 2.0f);
+	camera.SetFront(glm::normalize(center - camera.Position));
+}
+
+// nearest-rank percentiles
+Statistics computeStatistics(std::vector<double> samples)
+{
+	Statistics statistics;
+	if (samples.empty())
+		return statistics;
+
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&](double p)
+		{
+			const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+			return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+		};
+
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+
+	statistics.mean = sum / samples.size();
+	statistics.p50 = percentile(50.0);
+	statistics.p90 = percentile(90.0);
+	statistics.p95 = percentile(95.0);
+	statistics.p99 = percentile(99.0);
+	statistics.max = samples.back();
+	return statistics;
+}
+
+void addPassTimings(std::vector<PassSamples>& passes, const std::vector<GpuPassTiming>& timings)
+{
+	for (const GpuPassTiming& timing : timings)
+	{
+		auto it = std::find_if(passes.begin(), passes.end(), [&](const PassSamples& pass) { return std::strcmp(pass.name, timing.name) == 0; });
+		if (it == passes.end())
+		{
+			passes.push_back({ timing.name, {} });
+			it = passes.end() - 1;
+		}
+		it->milliseconds.push_back(timing.milliseconds);
+	}
+}
+
+// mean of the named pass, 0 when the run did not have it
+double getPassMean(const std::vector<PassSamples>& passes, const char* name)
+{
+	for (const PassSamples& pass : passes)
+		if (std::strcmp(pass.name, name) == 0)
+			return computeStatistics(pass.milliseconds).mean;
+	return 0.0;
+}
+
+// node of a pointer-based scene graph, the layout TransformHierarchy replaced;
+// the hierarchy benchmark compares against it and checks the results match
+struct PointerNode
+{
+	std::list<std::unique_ptr<PointerNode>> children;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 rotation = glm::vec3(0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::mat4 world = glm::mat4(1.0f);
+	bool dirty = true;
+
+	// like the old Entity::updateSelfAndChild: visits every node, recomputes dirty subtrees
+	void updateDirty(const glm::mat4& parent)
+	{
+		if (dirty)
+		{
+			update(parent);
+			return;
+		}
+		for (auto& child : children)
+			child->updateDirty(world);
+	}
+
+	void update(const glm::mat4& parent)
+	{
+		dirty = false;
+		const glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f))
+			* glm::rotate(glm::mat4(1.0f), glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f))
+			* glm::rotate(glm::mat4(1.0f), glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+		world = parent * glm::translate(glm::mat4(1.0f), position) * rotationMatrix * glm::scale(glm::mat4(1.0f), scale);
+		for (auto& child : children)
+			child->update(world);
+	}
+};
+
+// updates a random hierarchy of settings.hierarchyNodes nodes, once in the flat
+// TransformHierarchy and once as a pointer-based tree, and reports both: first with
+// the root spinning so every node changes, then with 1% of the nodes moving per
+// frame. Fails when the flat update exceeds the frame budget or the results differ.
+bool runHierarchyBenchmark(const BenchmarkSettings& settings)
+{
+	// deterministic so runs compare: every node picks a random earlier node as parent
+	BenchmarkRandom random;
+
+	const unsigned int count = settings.hierarchyNodes;
+	TransformHierarchy hierarchy;
+	std::vector<TransformHierarchy::Handle> handles(count);
+	PointerNode root;
+	std::vector<PointerNode*> pointerNodes(count);
+	unsigned int depth = 0;
+	std::vector<unsigned int> depths(count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const unsigned int parent = i == 0 ? 0 : random.next() % i;
+		handles[i] = hierarchy.create(i == 0 ? TransformHierarchy::none : handles[parent]);
+		PointerNode& parentNode = i == 0 ? root : *pointerNodes[parent];
+		parentNode.children.push_back(std::make_unique<PointerNode>());
+		pointerNodes[i] = parentNode.children.back().get();
+		depths[i] = i == 0 ? 1 : depths[parent] + 1;
+		depth = std::max(depth, depths[i]);
+
+		const glm::vec3 position = glm::vec3(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f));
+		const glm::vec3 rotation = glm::vec3(random.uniform(-180.0f, 180.0f), random.uniform(-180.0f, 180.0f), random.uniform(-180.0f, 180.0f));
+		const glm::vec3 scale = glm::vec3(random.uniform(0.9f, 1.1f));
+		hierarchy.setLocalPosition(handles[i], position);
+		hierarchy.setLocalRotation(handles[i], rotation);
+		hierarchy.setLocalScale(handles[i], scale);
+		pointerNodes[i]->position = position;
+		pointerNodes[i]->rotation = rotation;
+		pointerNodes[i]->scale = scale;
+	}
+
+	std::vector<double> flatTimes;
+	std::vector<double> pointerTimes;
+	std::vector<double> incrementalFlatTimes;
+	std::vector<double> incrementalPointerTimes;
+	double updatedNodes = 0.0;
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		// spin the root so every frame has new results
+		const glm::vec3 rotation = glm::vec3(0.0f, i * 0.5f, 0.0f);
+		hierarchy.setLocalRotation(handles[0], rotation);
+		pointerNodes[0]->rotation = rotation;
+
+		const auto start = std::chrono::steady_clock::now();
+		hierarchy.update();
+		const auto flatEnd = std::chrono::steady_clock::now();
+		root.children.front()->update(glm::mat4(1.0f));
+		const auto pointerEnd = std::chrono::steady_clock::now();
+
+		if (i >= settings.warmupFrames)
+		{
+			flatTimes.push_back(std::chrono::duration<double, std::milli>(flatEnd - start).count());
+			pointerTimes.push_back(std::chrono::duration<double, std::milli>(pointerEnd - flatEnd).count());
+		}
+	}
+
+	const unsigned int movedNodes = std::max(1u, count / 100);
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		for (unsigned int j = 0; j < movedNodes; j++)
+		{
+			const unsigned int node = random.next() % count;
+			const glm::vec3 position = pointerNodes[node]->position + glm::vec3(random.uniform(-0.01f, 0.01f), 0.0f, 0.0f);
+			hierarchy.setLocalPosition(handles[node], position);
+			pointerNodes[node]->position = position;
+			pointerNodes[node]->dirty = true;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		hierarchy.update();
+		const auto flatEnd = std::chrono::steady_clock::now();
+		root.children.front()->updateDirty(glm::mat4(1.0f));
+		const auto pointerEnd = std::chrono::steady_clock::now();
+
+		if (i >= settings.warmupFrames)
+		{
+			incrementalFlatTimes.push_back(std::chrono::duration<double, std::milli>(flatEnd - start).count());
+			incrementalPointerTimes.push_back(std::chrono::duration<double, std::milli>(pointerEnd - flatEnd).count());
+			updatedNodes += static_cast<double>(hierarchy.getUpdatedCount()) / settings.frames;
+		}
+	}
+
+	// relative to the size of the translation, which grows with depth
+	float maxError = 0.0f;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const glm::mat4& flat = hierarchy.getWorldMatrix(handles[i]);
+		const glm::mat4& pointer = pointerNodes[i]->world;
+		const float magnitude = std::max(1.0f, glm::length(glm::vec3(pointer[3])));
+		for (int column = 0; column < 4; column++)
+			maxError = std::max(maxError, glm::length(flat[column] - pointer[column]) / magnitude);
+	}
+
+	const Statistics flat = computeStatistics(flatTimes);
+	const Statistics pointer = computeStatistics(pointerTimes);
+	const Statistics incrementalFlat = computeStatistics(incrementalFlatTimes);
+	const Statistics incrementalPointer = computeStatistics(incrementalPointerTimes);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Transform hierarchy: " << count << " nodes, depth " << depth << ", " << settings.frames << " updates" << std::endl;
+	std::cout << "  flat array    mean " << flat.mean << "  p95 " << flat.p95 << "  max " << flat.max << " ms" << std::endl;
+	std::cout << "  pointer tree  mean " << pointer.mean << "  p95 " << pointer.p95 << "  max " << pointer.max << " ms" << std::endl;
+	std::cout << "  speedup " << pointer.mean / std::max(flat.mean, 1e-9) << "x" << std::endl;
+	std::cout << "Moving " << movedNodes << " nodes per frame, " << std::setprecision(0) << updatedNodes << std::setprecision(3) << " nodes updated on average" << std::endl;
+	std::cout << "  flat array    mean " << incrementalFlat.mean << "  p95 " << incrementalFlat.p95 << "  max " << incrementalFlat.max << " ms" << std::endl;
+	std::cout << "  pointer tree  mean " << incrementalPointer.mean << "  p95 " << incrementalPointer.p95 << "  max " << incrementalPointer.max << " ms" << std::endl;
+	std::cout << "  speedup " << incrementalPointer.mean / std::max(incrementalFlat.mean, 1e-9) << "x" << std::endl;
+	std::cout << "Max relative difference " << std::scientific << maxError << std::fixed << std::endl;
+
+	bool passed = true;
+	if (maxError > 1e-4f)
+	{
+		std::cout << "FAILED: flat and pointer results differ" << std::endl;
+		passed = false;
+	}
+	if (settings.frameBudget > 0.0 && std::max(flat.p95, incrementalFlat.p95) > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 update time " << std::max(flat.p95, incrementalFlat.p95) << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+// frustum culls settings.visibilityObjects random boxes from a turning camera that
+// sees a small part of the world, once with DynamicAabbTree and once by testing
+// every box, while 1% of the boxes move per frame. Fails when the tree misses a
+// visible box or its culling exceeds the frame budget.
+bool runVisibilityBenchmark(const BenchmarkSettings& settings)
+{
+	BenchmarkRandom random;
+
+	// constant density, so the visible count stays about the same for every size
+	const unsigned int count = settings.visibilityObjects;
+	const float worldSize = 4.0f * std::cbrt(static_cast<float>(count));
+	std::vector<BoundingBox> boxes(count);
+	for (BoundingBox& box : boxes)
+	{
+		const glm::vec3 center = glm::vec3(random.uniform(-0.5f, 0.5f), random.uniform(-0.5f, 0.5f), random.uniform(-0.5f, 0.5f)) * worldSize;
+		const glm::vec3 extents = glm::vec3(random.uniform(0.1f, 1.0f), random.uniform(0.1f, 1.0f), random.uniform(0.1f, 1.0f));
+		box = { center - extents, center + extents };
+	}
+
+	const auto buildStart = std::chrono::steady_clock::now();
+	DynamicAabbTree tree;
+	std::vector<int32_t> proxies(count);
+	for (unsigned int i = 0; i < count; i++)
+		proxies[i] = tree.insert(boxes[i], i);
+	const double buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+	std::vector<double> treeTimes;
+	std::vector<double> linearTimes;
+	double visible = 0.0;
+	double reported = 0.0;
+	double visited = 0.0;
+	unsigned int missed = 0;
+	std::vector<uint8_t> found(count);
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 30.0f);
+	const unsigned int movedBoxes = std::max(1u, count / 100);
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		for (unsigned int j = 0; j < movedBoxes; j++)
+		{
+			const unsigned int box = random.next() % count;
+			const glm::vec3 offset = glm::vec3(random.uniform(-0.05f, 0.05f), random.uniform(-0.05f, 0.05f), random.uniform(-0.05f, 0.05f));
+			boxes[box] = { boxes[box].min + offset, boxes[box].max + offset };
+			tree.move(proxies[box], boxes[box]);
+		}
+
+		const float angle = static_cast<float>(i) / totalFrames * glm::two_pi<float>();
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(glm::sin(angle), 0.0f, glm::cos(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+		const ViewFrustum frustum(projection * view);
+
+		std::fill(found.begin(), found.end(), 0);
+		unsigned int frameReported = 0;
+		const auto start = std::chrono::steady_clock::now();
+		const unsigned int frameVisited = tree.cull(frustum, [&](uint32_t index)
+			{
+				found[index] = 1;
+				frameReported++;
+			});
+		const auto treeEnd = std::chrono::steady_clock::now();
+		unsigned int frameVisible = 0;
+		for (unsigned int j = 0; j < count; j++)
+		{
+			unsigned int mask = ViewFrustum::allPlanes;
+			if (frustum.test(boxes[j], mask))
+			{
+				frameVisible++;
+				missed += found[j] ? 0 : 1;
+			}
+		}
+		const auto linearEnd = std::chrono::steady_clock::now();
+
+		if (i >= settings.warmupFrames)
+		{
+			treeTimes.push_back(std::chrono::duration<double, std::milli>(treeEnd - start).count());
+			linearTimes.push_back(std::chrono::duration<double, std::milli>(linearEnd - treeEnd).count());
+			visible += static_cast<double>(frameVisible) / settings.frames;
+			reported += static_cast<double>(frameReported) / settings.frames;
+			visited += static_cast<double>(frameVisited) / settings.frames;
+		}
+	}
+
+	const Statistics treeStatistics = computeStatistics(treeTimes);
+	const Statistics linearStatistics = computeStatistics(linearTimes);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Frustum culling: " << count << " boxes, tree height " << tree.getHeight() << ", built in " << buildTime << " ms, "
+		<< movedBoxes << " moving per frame" << std::endl;
+	std::cout << std::setprecision(0) << "  " << visible << " visible, " << reported << " reported with margin, "
+		<< visited << " tree nodes visited on average" << std::setprecision(3) << std::endl;
+	std::cout << "  AABB tree     mean " << treeStatistics.mean << "  p95 " << treeStatistics.p95 << "  max " << treeStatistics.max << " ms" << std::endl;
+	std::cout << "  linear scan   mean " << linearStatistics.mean << "  p95 " << linearStatistics.p95 << "  max " << linearStatistics.max << " ms" << std::endl;
+	std::cout << "  speedup " << linearStatistics.mean / std::max(treeStatistics.mean, 1e-9) << "x" << std::endl;
+
+	bool passed = true;
+	if (missed > 0)
+	{
+		std::cout << "FAILED: the tree missed " << missed << " visible boxes" << std::endl;
+		passed = false;
+	}
+	if (settings.frameBudget > 0.0 && treeStatistics.p95 > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 culling time " << treeStatistics.p95 << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+// culls settings.occlusionObjects random boxes between random walls with the
+// OcclusionCuller, from a camera turning at eye height. Every 16th frame the
+// boxes it hides are checked by casting rays to points on them; fails when one
+// of those points can be seen or the culling exceeds the frame budget.
+bool runOcclusionBenchmark(const BenchmarkSettings& settings)
+{
+	BenchmarkRandom random;
+
+	// a unit cube, scaled and moved into place for every wall
+	OccluderMesh cube;
+	for (int i = 0; i < 8; i++)
+		cube.positions.push_back(glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f));
+	const uint32_t faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+	for (const auto& face : faces)
+		cube.indices.insert(cube.indices.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+
+	const float worldSize = 60.0f;
+	std::vector<BoundingBox> walls(48);
+	std::vector<glm::mat4> wallMatrices;
+	for (BoundingBox& wall : walls)
+	{
+		const bool alongX = random.next() & 1;
+		const glm::vec3 center = glm::vec3(random.uniform(-0.5f, 0.5f) * worldSize, 1.5f, random.uniform(-0.5f, 0.5f) * worldSize);
+		const glm::vec3 extents = glm::vec3(alongX ? random.uniform(1.0f, 4.0f) : 0.1f, 1.5f, alongX ? 0.1f : random.uniform(1.0f, 4.0f));
+		wall = { center - extents, center + extents };
+		wallMatrices.push_back(glm::scale(glm::translate(glm::mat4(1.0f), center), extents));
+	}
+
+	const unsigned int count = settings.occlusionObjects;
+	std::vector<BoundingBox> boxes(count);
+	for (BoundingBox& box : boxes)
+	{
+		const glm::vec3 center = glm::vec3(random.uniform(-0.5f, 0.5f) * worldSize, random.uniform(0.0f, 2.5f), random.uniform(-0.5f, 0.5f) * worldSize);
+		const glm::vec3 extents = glm::vec3(random.uniform(0.05f, 0.4f), random.uniform(0.05f, 0.4f), random.uniform(0.05f, 0.4f));
+		box = { center - extents, center + extents };
+	}
+
+	// true when the segment from a to b passes through the box
+	auto segmentHits = [](const glm::vec3& a, const glm::vec3& b, const BoundingBox& box)
+		{
+			const glm::vec3 direction = b - a;
+			float enter = 0.0f;
+			float exit = 1.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				if (std::abs(direction[i]) < 1e-9f)
+				{
+					if (a[i] < box.min[i] || a[i] > box.max[i])
+						return false;
+					continue;
+				}
+				float t0 = (box.min[i] - a[i]) / direction[i];
+				float t1 = (box.max[i] - a[i]) / direction[i];
+				if (t0 > t1)
+					std::swap(t0, t1);
+				enter = std::max(enter, t0);
+				exit = std::min(exit, t1);
+				if (enter > exit)
+					return false;
+			}
+			return true;
+		};
+
+	OcclusionCuller culler;
+	std::vector<double> rasterizeTimes;
+	std::vector<double> testTimes;
+	double inFrustum = 0.0;
+	double occluded = 0.0;
+	unsigned int checkedBoxes = 0;
+	unsigned int wrong = 0;
+	std::vector<uint8_t> visible(count);
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		const float angle = static_cast<float>(i) / totalFrames * glm::two_pi<float>();
+		const glm::vec3 eye = glm::vec3(0.0f, 1.7f, 0.0f);
+		const glm::mat4 viewProjection = projection * glm::lookAt(eye, eye + glm::vec3(glm::sin(angle), -0.1f, glm::cos(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+		const ViewFrustum frustum(viewProjection);
+
+		const auto start = std::chrono::steady_clock::now();
+		culler.begin(viewProjection);
+		for (size_t j = 0; j < walls.size(); j++)
+		{
+			unsigned int mask = ViewFrustum::allPlanes;
+			if (frustum.test(walls[j], mask))
+				culler.addOccluder(cube, wallMatrices[j]);
+		}
+		culler.rasterize(jobSystem);
+		const auto rasterizeEnd = std::chrono::steady_clock::now();
+		unsigned int frameInFrustum = 0;
+		unsigned int frameOccluded = 0;
+		for (unsigned int j = 0; j < count; j++)
+		{
+			unsigned int mask = ViewFrustum::allPlanes;
+			visible[j] = frustum.test(boxes[j], mask);
+			if (!visible[j])
+				continue;
+			frameInFrustum++;
+			visible[j] = culler.isVisible(boxes[j]);
+			frameOccluded += visible[j] ? 0 : 1;
+		}
+		const auto testEnd = std::chrono::steady_clock::now();
+
+		if (i >= settings.warmupFrames)
+		{
+			rasterizeTimes.push_back(std::chrono::duration<double, std::milli>(rasterizeEnd - start).count());
+			testTimes.push_back(std::chrono::duration<double, std::milli>(testEnd - rasterizeEnd).count());
+			inFrustum += static_cast<double>(frameInFrustum) / settings.frames;
+			occluded += static_cast<double>(frameOccluded) / settings.frames;
+		}
+
+		if (i % 16 != 0)
+			continue;
+		for (unsigned int j = 0; j < count; j++)
+		{
+			unsigned int mask = ViewFrustum::allPlanes;
+			if (visible[j] || !frustum.test(boxes[j], mask))
+				continue;
+			checkedBoxes++;
+			// a 5x5x5 grid of points in the box, each must be off screen or behind a wall
+			bool seen = false;
+			for (int k = 0; k < 125 && !seen; k++)
+			{
+				const glm::vec3 point = glm::mix(boxes[j].min, boxes[j].max, glm::vec3(k % 5, k / 5 % 5, k / 25) / 4.0f);
+				const glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+				if (clip.w <= 0.0f || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w || std::abs(clip.z) > clip.w)
+					continue;
+				seen = std::none_of(walls.begin(), walls.end(), [&](const BoundingBox& wall) { return segmentHits(eye, point, wall); });
+			}
+			wrong += seen ? 1 : 0;
+		}
+	}
+
+	const Statistics rasterizeStatistics = computeStatistics(rasterizeTimes);
+	const Statistics testStatistics = computeStatistics(testTimes);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Occlusion culling: " << count << " boxes, " << walls.size() << " walls, " << culler.getWidth() << "x" << culler.getHeight()
+		<< " depth buffer, " << jobSystem.getThreadCount() << " threads" << std::endl;
+	std::cout << std::setprecision(0) << "  " << inFrustum << " boxes in the frustum, " << occluded << " of them hidden on average ("
+		<< 100.0 * occluded / std::max(inFrustum, 1.0) << "%)" << std::setprecision(3) << std::endl;
+	std::cout << "  rasterize     mean " << rasterizeStatistics.mean << "  p95 " << rasterizeStatistics.p95 << "  max " << rasterizeStatistics.max << " ms" << std::endl;
+	std::cout << "  test boxes    mean " << testStatistics.mean << "  p95 " << testStatistics.p95 << "  max " << testStatistics.max << " ms" << std::endl;
+	std::cout << "  " << checkedBoxes << " hidden boxes checked by ray casts" << std::endl;
+
+	bool passed = true;
+	if (wrong > 0)
+	{
+		std::cout << "FAILED: " << wrong << " hidden boxes can be seen" << std::endl;
+		passed = false;
+	}
+	const double p95 = rasterizeStatistics.p95 + testStatistics.p95;
+	if (settings.frameBudget > 0.0 && p95 > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 culling time " << p95 << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+// builds a LooseOctree over static scenes with a hundredth, a tenth and all of
+// settings.octreeObjects random props and compares its frustum culling with
+// testing every box like entity.h does. The budget applies to the largest scene.
+bool runOctreeBenchmark(const BenchmarkSettings& settings)
+{
+	bool passed = true;
+	for (unsigned int divisor : { 100u, 10u, 1u })
+	{
+		if (settings.octreeObjects / divisor > 0)
+			passed &= runOctreeScene(settings, settings.octreeObjects / divisor, divisor == 1);
+	}
+	return passed;
+}
+
+// one scene of runOctreeBenchmark: count props on the ground, most of them small and a
+// few large, seen from a camera turning at eye height. Every frame also runs a sphere
+// and a ray query. Fails when a query of the octree differs from testing every box.
+bool runOctreeScene(const BenchmarkSettings& settings, unsigned int count, bool applyBudget)
+{
+	BenchmarkRandom random;
+
+	// constant density on the ground, so the visible count stays about the same for every size
+	const float worldSize = 8.0f * std::sqrt(static_cast<float>(count));
+	std::vector<BoundingBox> boxes(count);
+	std::vector<AABB> entityBoxes;
+	entityBoxes.reserve(count);
+	for (BoundingBox& box : boxes)
+	{
+		const bool large = random.next() % 32 == 0;
+		const glm::vec3 extents = large ? glm::vec3(random.uniform(1.0f, 4.0f), random.uniform(1.0f, 4.0f), random.uniform(1.0f, 4.0f))
+			: glm::vec3(random.uniform(0.1f, 0.5f), random.uniform(0.1f, 0.5f), random.uniform(0.1f, 0.5f));
+		const glm::vec3 center = glm::vec3(random.uniform(-0.5f, 0.5f) * worldSize, extents.y + random.uniform(0.0f, 1.0f), random.uniform(-0.5f, 0.5f) * worldSize);
+		box = { center - extents, center + extents };
+		entityBoxes.emplace_back(box.min, box.max);
+	}
+
+	LooseOctree octree;
+	double buildTime = std::numeric_limits<double>::max();
+	for (int i = 0; i < 5; i++)
+	{
+		const auto buildStart = std::chrono::steady_clock::now();
+		octree.build(boxes, jobSystem);
+		buildTime = std::min(buildTime, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count());
+	}
+	const auto treeStart = std::chrono::steady_clock::now();
+	DynamicAabbTree tree;
+	for (unsigned int i = 0; i < count; i++)
+		tree.insert(boxes[i], i);
+	const double treeBuildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - treeStart).count();
+
+	// the same slab test as the octree, for checking the ray queries
+	auto rayHits = [](const glm::vec3& origin, const glm::vec3& inverse, float maxDistance, const BoundingBox& box)
+		{
+			const glm::vec3 t0 = (box.min - origin) * inverse;
+			const glm::vec3 t1 = (box.max - origin) * inverse;
+			const glm::vec3 tMin = glm::min(t0, t1);
+			const glm::vec3 tMax = glm::max(t0, t1);
+			return std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f)) <= std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+		};
+
+	std::vector<double> octreeTimes;
+	std::vector<double> linearTimes;
+	std::vector<double> sphereTimes;
+	std::vector<double> rayTimes;
+	double visible = 0.0;
+	double visited = 0.0;
+	unsigned int wrong = 0;
+	unsigned int wrongQueries = 0;
+	unsigned int entityDifferences = 0;
+	std::vector<uint8_t> found(count);
+	const float aspect = 16.0f / 9.0f;
+	const float fovY = glm::radians(60.0f);
+	const float zNear = 0.1f;
+	const float zFar = 100.0f;
+	const glm::mat4 projection = glm::perspective(fovY, aspect, zNear, zFar);
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		const float yaw = static_cast<float>(i) / totalFrames * 360.0f;
+		Camera camera(glm::vec3(0.0f, 1.7f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), yaw, -5.0f);
+		const ViewFrustum frustum(projection * camera.GetViewMatrix());
+		const Frustum entityFrustum = createFrustumFromCamera(camera, aspect, fovY, zNear, zFar);
+
+		std::fill(found.begin(), found.end(), 0);
+		unsigned int frameVisible = 0;
+		const auto start = std::chrono::steady_clock::now();
+		const unsigned int frameVisited = octree.cull(frustum, [&](uint32_t index)
+			{
+				found[index] = 1;
+				frameVisible++;
+			});
+		const auto octreeEnd = std::chrono::steady_clock::now();
+		unsigned int entityVisible = 0;
+		for (const AABB& box : entityBoxes)
+			entityVisible += box.isOnFrustum(entityFrustum) ? 1 : 0;
+		const auto linearEnd = std::chrono::steady_clock::now();
+
+		// exactly the boxes that pass the frustum test
+		for (unsigned int j = 0; j < count; j++)
+		{
+			unsigned int mask = ViewFrustum::allPlanes;
+			wrong += frustum.test(boxes[j], mask) != (found[j] != 0) ? 1 : 0;
+		}
+		// the two frusta only differ in rounding at their planes
+		entityDifferences += static_cast<unsigned int>(std::abs(static_cast<int>(entityVisible) - static_cast<int>(frameVisible)));
+
+		const glm::vec3 sphereCenter = camera.Position + camera.Front * random.uniform(0.0f, zFar);
+		const float radius = random.uniform(1.0f, 10.0f);
+		unsigned int sphereHits = 0;
+		const auto sphereStart = std::chrono::steady_clock::now();
+		octree.querySphere(sphereCenter, radius, [&sphereHits](uint32_t) { sphereHits++; return true; });
+		const auto sphereEnd = std::chrono::steady_clock::now();
+		unsigned int rayHitCount = 0;
+		octree.raycast(camera.Position, camera.Front, zFar, [&rayHitCount](uint32_t, float maxDistance) { rayHitCount++; return maxDistance; });
+		const auto rayEnd = std::chrono::steady_clock::now();
+
+		const glm::vec3 inverse = 1.0f / camera.Front;
+		for (const BoundingBox& box : boxes)
+		{
+			const glm::vec3 offset = sphereCenter - glm::clamp(sphereCenter, box.min, box.max);
+			sphereHits -= glm::dot(offset, offset) <= radius * radius ? 1 : 0;
+			rayHitCount -= rayHits(camera.Position, inverse, zFar, box) ? 1 : 0;
+		}
+		wrongQueries += (sphereHits != 0 ? 1 : 0) + (rayHitCount != 0 ? 1 : 0);
+
+		if (i >= settings.warmupFrames)
+		{
+			octreeTimes.push_back(std::chrono::duration<double, std::milli>(octreeEnd - start).count());
+			linearTimes.push_back(std::chrono::duration<double, std::milli>(linearEnd - octreeEnd).count());
+			sphereTimes.push_back(std::chrono::duration<double, std::milli>(sphereEnd - sphereStart).count());
+			rayTimes.push_back(std::chrono::duration<double, std::milli>(rayEnd - sphereEnd).count());
+			visible += static_cast<double>(frameVisible) / settings.frames;
+			visited += static_cast<double>(frameVisited) / settings.frames;
+		}
+	}
+
+	const Statistics octreeStatistics = computeStatistics(octreeTimes);
+	const Statistics linearStatistics = computeStatistics(linearTimes);
+	const Statistics sphereStatistics = computeStatistics(sphereTimes);
+	const Statistics rayStatistics = computeStatistics(rayTimes);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Loose octree: " << count << " static boxes, depth " << octree.getDepth() << ", " << octree.getNodeCount() << " nodes, built in "
+		<< buildTime << " ms on " << jobSystem.getThreadCount() << " threads (AABB tree inserts " << treeBuildTime << " ms)" << std::endl;
+	std::cout << std::setprecision(0) << "  " << visible << " visible, " << visited << " nodes visited on average, "
+		<< entityDifferences << " boxes on the planes counted differently by entity.h" << std::setprecision(3) << std::endl;
+	std::cout << "  octree        mean " << octreeStatistics.mean << "  p95 " << octreeStatistics.p95 << "  max " << octreeStatistics.max << " ms" << std::endl;
+	std::cout << "  entity.h scan mean " << linearStatistics.mean << "  p95 " << linearStatistics.p95 << "  max " << linearStatistics.max << " ms" << std::endl;
+	std::cout << "  speedup " << linearStatistics.mean / std::max(octreeStatistics.mean, 1e-9) << "x" << std::endl;
+	std::cout << "  sphere query  mean " << sphereStatistics.mean << " ms, ray query mean " << rayStatistics.mean << " ms" << std::endl;
+
+	bool passed = true;
+	if (wrong > 0)
+	{
+		std::cout << "FAILED: the octree culled " << wrong << " boxes differently than testing every box" << std::endl;
+		passed = false;
+	}
+	if (wrongQueries > 0)
+	{
+		std::cout << "FAILED: " << wrongQueries << " sphere or ray queries returned the wrong boxes" << std::endl;
+		passed = false;
+	}
+	if (applyBudget && settings.frameBudget > 0.0 && octreeStatistics.p95 > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 culling time " << octreeStatistics.p95 << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+// runs every transform kernel on settings.kernelElements random affine matrices and
+// boxes per frame and the scalar glm code it replaces on the same input: products of
+// two matrices, one matrix times many, normal matrices (glm::inverse for the
+// reference), normal matrices of uniformly scaled matrices, normal matrices picked
+// per matrix as the demo does for a mix of both, and box transforms (the nine dot
+// products entity.h used for the reference). Fails when the results differ or the slowest kernel exceeds the frame budget.
+bool runKernelBenchmark(const BenchmarkSettings& settings)
+{
+	BenchmarkRandom random;
+	auto randomTransform = [&](bool uniformScale)
+		{
+			const glm::vec3 position = glm::vec3(random.uniform(-10.0f, 10.0f), random.uniform(-10.0f, 10.0f), random.uniform(-10.0f, 10.0f));
+			const glm::vec3 rotation = glm::vec3(random.uniform(-180.0f, 180.0f), random.uniform(-180.0f, 180.0f), random.uniform(-180.0f, 180.0f));
+			const glm::vec3 scale = uniformScale ? glm::vec3(random.uniform(0.5f, 2.0f)) : glm::vec3(random.uniform(0.5f, 2.0f), random.uniform(0.5f, 2.0f), random.uniform(0.5f, 2.0f));
+			return composeTransform(position, rotation, scale);
+		};
+
+	const unsigned int count = settings.kernelElements;
+	std::vector<glm::mat4> left(count);
+	std::vector<glm::mat4> right(count);
+	std::vector<glm::mat4> uniform(count);
+	std::vector<BoxBounds> boxes(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		left[i] = randomTransform(false);
+		right[i] = randomTransform(false);
+		uniform[i] = randomTransform(true);
+		boxes[i].center = glm::vec3(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f));
+		boxes[i].extents = glm::vec3(random.uniform(0.1f, 1.0f), random.uniform(0.1f, 1.0f), random.uniform(0.1f, 1.0f));
+	}
+	// the scene mixes both kinds, most props are only rotated and uniformly scaled
+	std::vector<glm::mat4> mixed(count);
+	for (unsigned int i = 0; i < count; i++)
+		mixed[i] = i % 4 == 0 ? left[i] : uniform[i];
+	const glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 2.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::vector<glm::mat4> referenceMatrices(count);
+	std::vector<glm::mat4> kernelMatrices(count);
+	std::vector<glm::mat3> referenceNormals(count);
+	std::vector<glm::mat3> kernelNormals(count);
+	std::vector<BoxBounds> referenceBoxes(count);
+	std::vector<BoxBounds> kernelBoxes(count);
+
+	// the largest difference of any component, relative to the largest component of the reference
+	auto relativeError = [](const float* reference, const float* result, size_t floats)
+		{
+			float magnitude = 1e-6f;
+			float error = 0.0f;
+			for (size_t i = 0; i < floats; i++)
+			{
+				magnitude = std::max(magnitude, std::abs(reference[i]));
+				error = std::max(error, std::abs(reference[i] - result[i]));
+			}
+			return error / magnitude;
+		};
+
+	struct KernelRun
+	{
+		KernelRun(const char* name)
+			: name(name)
+		{
+		}
+
+		const char* name;
+		std::vector<double> referenceTimes;
+		std::vector<double> kernelTimes;
+		float maxError = 0.0f;
+	};
+	KernelRun runs[] = { { "matrix * matrix" }, { "shared * matrix" }, { "normal matrix" }, { "uniform normal" }, { "selected normal" }, { "box transform" } };
+
+	// the box transform AABB::isOnFrustum did before transformBounds: the scaled axes
+	// projected onto the world axes with nine dot products
+	auto dotProductBounds = [](const glm::mat4& matrix, const BoxBounds& box)
+		{
+			const glm::vec3 globalCenter{ matrix * glm::vec4(box.center, 1.f) };
+			const glm::vec3 right = glm::vec3(matrix[0]) * box.extents.x;
+			const glm::vec3 up = glm::vec3(matrix[1]) * box.extents.y;
+			const glm::vec3 forward = -glm::vec3(matrix[2]) * box.extents.z;
+
+			const float newIi = std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, right)) +
+				std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, up)) +
+				std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, forward));
+			const float newIj = std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, right)) +
+				std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, up)) +
+				std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, forward));
+			const float newIk = std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, right)) +
+				std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, up)) +
+				std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, forward));
+			return BoxBounds{ globalCenter, glm::vec3(newIi, newIj, newIk) };
+		};
+
+	auto measure = [&settings](KernelRun& run, unsigned int frame, auto&& reference, auto&& kernel, auto&& compare)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			reference();
+			const auto referenceEnd = std::chrono::steady_clock::now();
+			kernel();
+			const auto kernelEnd = std::chrono::steady_clock::now();
+			if (frame >= settings.warmupFrames)
+			{
+				run.referenceTimes.push_back(std::chrono::duration<double, std::milli>(referenceEnd - start).count());
+				run.kernelTimes.push_back(std::chrono::duration<double, std::milli>(kernelEnd - referenceEnd).count());
+			}
+			run.maxError = std::max(run.maxError, compare());
+		};
+	auto compareMatrices = [&]() { return relativeError(&referenceMatrices[0][0][0], &kernelMatrices[0][0][0], count * 16); };
+	auto compareNormals = [&]() { return relativeError(&referenceNormals[0][0][0], &kernelNormals[0][0][0], count * 9); };
+
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		measure(runs[0], i,
+			[&]() { for (unsigned int j = 0; j < count; j++) referenceMatrices[j] = left[j] * right[j]; },
+			[&]() { multiplyMatrices(left.data(), right.data(), kernelMatrices.data(), count); },
+			compareMatrices);
+		measure(runs[1], i,
+			[&]() { for (unsigned int j = 0; j < count; j++) referenceMatrices[j] = viewProjection * right[j]; },
+			[&]() { multiplyMatrices(viewProjection, right.data(), kernelMatrices.data(), count); },
+			compareMatrices);
+		measure(runs[2], i,
+			[&]() { for (unsigned int j = 0; j < count; j++) referenceNormals[j] = glm::mat3(glm::transpose(glm::inverse(left[j]))); },
+			[&]() { normalMatrices(left.data(), kernelNormals.data(), count); },
+			compareNormals);
+		measure(runs[3], i,
+			[&]() { for (unsigned int j = 0; j < count; j++) referenceNormals[j] = glm::mat3(glm::transpose(glm::inverse(uniform[j]))); },
+			[&]() { uniformScaleNormalMatrices(uniform.data(), kernelNormals.data(), count); },
+			compareNormals);
+		measure(runs[4], i,
+			[&]() { for (unsigned int j = 0; j < count; j++) referenceNormals[j] = glm::mat3(glm::transpose(glm::inverse(mixed[j]))); },
+			[&]() { selectNormalMatrices(mixed.data(), kernelNormals.data(), count); },
+			compareNormals);
+		measure(runs[5], i,
+			[&]() { for (unsigned int j = 0; j < count; j++) referenceBoxes[j] = dotProductBounds(left[j], boxes[j]); },
+			[&]() { transformBounds(left.data(), boxes.data(), kernelBoxes.data(), count); },
+			[&]() { return relativeError(&referenceBoxes[0].center.x, &kernelBoxes[0].center.x, count * 6); });
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Transform kernels (" << getTransformKernelPath() << "): " << count << " elements, " << settings.frames << " frames" << std::endl;
+	bool passed = true;
+	double slowest = 0.0;
+	for (const KernelRun& run : runs)
+	{
+		const Statistics reference = computeStatistics(run.referenceTimes);
+		const Statistics kernel = computeStatistics(run.kernelTimes);
+		slowest = std::max(slowest, kernel.p95);
+		std::cout << "  " << std::left << std::setw(16) << run.name << std::right << "glm mean " << reference.mean << " ms  kernel mean " << kernel.mean
+			<< " p95 " << kernel.p95 << " ms  speedup " << reference.mean / std::max(kernel.mean, 1e-9) << "x  max relative difference "
+			<< std::scientific << run.maxError << std::fixed << std::endl;
+		if (run.maxError > 1e-4f)
+		{
+			std::cout << "FAILED: " << run.name << " differs from glm" << std::endl;
+			passed = false;
+		}
+	}
+	if (settings.frameBudget > 0.0 && slowest > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 kernel time " << slowest << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+// writes a random scene of settings.sceneLoadEntities entities in the text form and
+// compiles it, then times parsing the text, mapping the compiled file and creating
+// the World entities from the mapped arrays. Fails when either form differs from
+// what was generated or mapping the compiled file exceeds the frame budget.
+bool runSceneLoadBenchmark(const BenchmarkSettings& settings)
+{
+	BenchmarkRandom random;
+
+	const unsigned int count = settings.sceneLoadEntities;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::string textPath = (directory / "benchmark_scene.scene").string();
+	const std::string binaryPath = (directory / "benchmark_scene.sceneb").string();
+
+	// what the generator wrote, for checking both forms against
+	std::vector<glm::vec3> positions(count);
+	std::vector<glm::vec3> rotations(count);
+	std::vector<float> scales(count);
+	std::vector<uint32_t> meshes(count);
+	std::vector<ScenePointLight> lights;
+	{
+		// the meshes are never loaded, only referenced
+		std::ofstream text(textPath, std::ios::trunc);
+		text << std::setprecision(9);
+		text << "sun 0 -1 0  0.5 0.5 0.5\n";
+		const char* meshNames[] = { "sphere", "lantern", "flashlight", "floor", "house" };
+		for (const char* mesh : meshNames)
+			text << "mesh " << mesh << " Resources/objects/" << mesh << "/" << mesh << ".obj\n";
+		const float worldSize = 8.0f * std::sqrt(static_cast<float>(count));
+		for (unsigned int i = 0; i < count; i++)
+		{
+			meshes[i] = random.next() % 5;
+			positions[i] = glm::vec3(random.uniform(-0.5f, 0.5f) * worldSize, 0.0f, random.uniform(-0.5f, 0.5f) * worldSize);
+			rotations[i] = glm::vec3(0.0f, random.uniform(-180.0f, 180.0f), 0.0f);
+			scales[i] = random.uniform(0.5f, 2.0f);
+			text << "entity e" << i << "\n\tmesh " << meshNames[meshes[i]] << "\n";
+			text << "\tposition " << positions[i].x << " " << positions[i].y << " " << positions[i].z << "\n";
+			text << "\trotation " << rotations[i].x << " " << rotations[i].y << " " << rotations[i].z << "\n";
+			text << "\tscale " << scales[i] << "\n";
+			if (random.next() % 100 == 0)
+			{
+				const ScenePointLight light = { i, glm::vec3(0.0f, random.uniform(0.5f, 2.0f), 0.0f), glm::vec3(random.uniform(0.0f, 1.0f), random.uniform(0.0f, 1.0f), random.uniform(0.0f, 1.0f)) };
+				text << "\tpoint_light " << light.offset.x << " " << light.offset.y << " " << light.offset.z
+					<< "  " << light.color.x << " " << light.color.y << " " << light.color.z << "\n";
+				lights.push_back(light);
+			}
+		}
+		text << "camera still position -10 4 12 front 0.8 -0.2 -0.5\n";
+	}
+
+	const auto compileStart = std::chrono::steady_clock::now();
+	if (!SceneFile::compile(textPath, binaryPath))
+		return false;
+	const double compileTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+	const uintmax_t textSize = std::filesystem::file_size(textPath);
+	const uintmax_t binarySize = std::filesystem::file_size(binaryPath);
+
+	SceneFile parsed;
+	double parseTime = std::numeric_limits<double>::max();
+	for (int i = 0; i < 3; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if (!parsed.load(textPath))
+			return false;
+		parseTime = std::min(parseTime, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// opening includes the validation, which reads every entity's mesh index
+	std::vector<double> mapTimes;
+	SceneFile mapped;
+	const unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if (!mapped.load(binaryPath))
+			return false;
+		const auto end = std::chrono::steady_clock::now();
+		if (i >= settings.warmupFrames)
+			mapTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// what DemoScene does with the arrays, without the meshes
+	double createTime = std::numeric_limits<double>::max();
+	for (int i = 0; i < 3; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		World world;
+		const SceneArray<glm::mat4> transforms = mapped.getTransforms();
+		const SceneArray<uint32_t> flags = mapped.getEntityFlags();
+		std::vector<ModelTransform> modelTransforms(transforms.size());
+		setModelTransforms(modelTransforms.data(), transforms.data, transforms.size());
+		std::vector<EntityId> entities(mapped.getEntityCount());
+		for (uint32_t j = 0; j < mapped.getEntityCount(); j++)
+			entities[j] = world.create(modelTransforms[j], MeshRef{ nullptr }, Material{ (flags[j] & SCENE_OCCLUDER) != 0, (flags[j] & SCENE_HIDDEN_IN_MIRROR) == 0 });
+		for (const ScenePointLight& light : mapped.getPointLights())
+			world.add(entities[light.entity], PointLightSource{ light.offset, light.color });
+		createTime = std::min(createTime, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// both forms against what was written; the text has nine digits, so only the
+	// matrices, which are computed from the angles, need a tolerance
+	auto matchesGenerated = [&](const SceneFile& scene)
+		{
+			if (scene.getEntityCount() != count || scene.getPointLights().size() != lights.size())
+				return false;
+			const SceneArray<glm::mat4> transforms = scene.getTransforms();
+			const SceneArray<uint32_t> entityMeshes = scene.getEntityMeshes();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const glm::mat4 expected = composeTransform(positions[i], rotations[i], glm::vec3(scales[i]));
+				for (int column = 0; column < 4; column++)
+				{
+					const glm::vec4 difference = glm::abs(transforms[i][column] - expected[column]);
+					const glm::vec4 tolerance = 1e-5f * glm::max(glm::abs(expected[column]), glm::vec4(1.0f));
+					if (glm::any(glm::greaterThan(difference, tolerance)))
+						return false;
+				}
+				if (entityMeshes[i] != meshes[i])
+					return false;
+			}
+			for (uint32_t i = 0; i < lights.size(); i++)
+			{
+				const ScenePointLight& light = scene.getPointLights()[i];
+				if (light.entity != lights[i].entity || light.offset != lights[i].offset || light.color != lights[i].color)
+					return false;
+			}
+			return true;
+		};
+	const bool textMatches = !parsed.isMapped() && matchesGenerated(parsed);
+	const bool compiledMatches = mapped.isMapped() && matchesGenerated(mapped);
+
+	const Statistics map = computeStatistics(mapTimes);
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Scene file: " << count << " entities, " << mapped.getPointLights().size() << " point lights, text "
+		<< textSize / 1024 << " KiB, compiled " << binarySize / 1024 << " KiB" << std::endl;
+	std::cout << "  parse text       " << parseTime << " ms" << std::endl;
+	std::cout << "  compile          " << compileTime << " ms" << std::endl;
+	std::cout << "  map compiled     mean " << map.mean << "  p95 " << map.p95 << "  max " << map.max << " ms" << std::endl;
+	std::cout << "  create entities  " << createTime << " ms" << std::endl;
+
+	std::filesystem::remove(textPath);
+	std::filesystem::remove(binaryPath);
+
+	bool passed = true;
+	if (!textMatches)
+	{
+		std::cout << "FAILED: the parsed text scene differs from the generated one" << std::endl;
+		passed = false;
+	}
+	if (!compiledMatches)
+	{
+		std::cout << "FAILED: the compiled scene differs from the generated one" << std::endl;
+		passed = false;
+	}
+	if (settings.frameBudget > 0.0 && map.p95 > settings.frameBudget)
+	{
+		std::cout << "FAILED: p95 map time " << map.p95 << " ms exceeds the budget of " << settings.frameBudget << " ms" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
+
+// builds the levels of detail of a sphere with a texture seam and of an open
+// heightfield with about settings.lodTriangles triangles each, the way Mesh::buildLods
+// does, and measures how far every original position is from each level. Fails when
+// a level does not have about half the triangles of the one before, when the
+// measured distance exceeds what MeshSimplifier::getError reports, or when
+// simplifying one mesh exceeds the frame budget.
+bool runLodBenchmark(const BenchmarkSettings& settings)
+{
+	struct LodMesh
+	{
+		const char* name;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<unsigned int> indices;
+	};
+
+	// a UV sphere; the first and last column share positions but not texture
+	// coordinates, and the pole rows have one triangle per quad
+	auto makeSphere = [](unsigned int triangles)
+		{
+			LodMesh mesh;
+			mesh.name = "sphere";
+			const unsigned int rows = std::max(4u, static_cast<unsigned int>(std::sqrt(triangles / 4.0)));
+			const unsigned int columns = 2 * rows;
+			for (unsigned int row = 0; row <= rows; row++)
+			{
+				for (unsigned int column = 0; column <= columns; column++)
+				{
+					const float theta = glm::pi<float>() * row / rows;
+					const float phi = glm::two_pi<float>() * (column % columns) / columns;
+					const glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+					mesh.positions.push_back(position);
+					mesh.normals.push_back(position);
+					mesh.texCoords.push_back(glm::vec2(static_cast<float>(column) / columns, static_cast<float>(row) / rows));
+				}
+			}
+			for (unsigned int row = 0; row < rows; row++)
+			{
+				for (unsigned int column = 0; column < columns; column++)
+				{
+					const unsigned int a = row * (columns + 1) + column, b = a + 1, c = a + columns + 1, d = c + 1;
+					if (row > 0)
+						mesh.indices.insert(mesh.indices.end(), { a, b, c });
+					if (row < rows - 1)
+						mesh.indices.insert(mesh.indices.end(), { b, d, c });
+				}
+			}
+			return mesh;
+		};
+
+	// rolling hills over a square with open borders
+	auto makeHeightfield = [](unsigned int triangles)
+		{
+			LodMesh mesh;
+			mesh.name = "heightfield";
+			const unsigned int size = std::max(4u, static_cast<unsigned int>(std::sqrt(triangles / 2.0)));
+			auto height = [](float x, float z) { return 0.1f * std::sin(3.0f * x) * std::cos(2.0f * z) + 0.03f * std::sin(7.0f * x + 5.0f * z); };
+			for (unsigned int row = 0; row <= size; row++)
+			{
+				for (unsigned int column = 0; column <= size; column++)
+				{
+					const float x = 2.0f * column / size - 1.0f, z = 2.0f * row / size - 1.0f;
+					const float dx = 0.3f * std::cos(3.0f * x) * std::cos(2.0f * z) + 0.21f * std::cos(7.0f * x + 5.0f * z);
+					const float dz = -0.2f * std::sin(3.0f * x) * std::sin(2.0f * z) + 0.15f * std::cos(7.0f * x + 5.0f * z);
+					mesh.positions.push_back(glm::vec3(x, height(x, z), z));
+					mesh.normals.push_back(glm::normalize(glm::vec3(-dx, 1.0f, -dz)));
+					mesh.texCoords.push_back(glm::vec2(static_cast<float>(column) / size, static_cast<float>(row) / size));
+				}
+			}
+			for (unsigned int row = 0; row < size; row++)
+			{
+				for (unsigned int column = 0; column < size; column++)
+				{
+					const unsigned int a = row * (size + 1) + column, b = a + 1, c = a + size + 1, d = c + 1;
+					mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+				}
+			}
+			return mesh;
+		};
+
+	// distance of p to the triangle abc: to its plane when p projects inside, else to the closest edge
+	auto triangleDistance = [](const glm::dvec3& p, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+		{
+			auto segmentDistance = [&p](const glm::dvec3& from, const glm::dvec3& to)
+				{
+					const glm::dvec3 edge = to - from;
+					const double length = glm::dot(edge, edge);
+					const double t = length > 0.0 ? glm::clamp(glm::dot(p - from, edge) / length, 0.0, 1.0) : 0.0;
+					return glm::length(p - (from + edge * t));
+				};
+			const glm::dvec3 normal = glm::cross(b - a, c - a);
+			if (glm::dot(normal, normal) > 0.0)
+			{
+				const bool insideAB = glm::dot(glm::cross(b - a, p - a), normal) >= 0.0;
+				const bool insideBC = glm::dot(glm::cross(c - b, p - b), normal) >= 0.0;
+				const bool insideCA = glm::dot(glm::cross(a - c, p - c), normal) >= 0.0;
+				if (insideAB && insideBC && insideCA)
+					return std::abs(glm::dot(p - a, normal)) / glm::length(normal);
+			}
+			return std::min({ segmentDistance(a, b), segmentDistance(b, c), segmentDistance(c, a) });
+		};
+
+	// largest distance of the original positions to the level; a grid of the level's
+	// triangles answers every position within the expected error, and the few that
+	// find nothing that close are measured against every triangle
+	auto measureDistance = [&triangleDistance](const LodMesh& mesh, const std::vector<unsigned int>& level, double expected)
+		{
+			glm::dvec3 low(std::numeric_limits<double>::max()), high(-std::numeric_limits<double>::max());
+			for (const glm::vec3& position : mesh.positions)
+			{
+				low = glm::min(low, glm::dvec3(position));
+				high = glm::max(high, glm::dvec3(position));
+			}
+			const size_t triangleCount = level.size() / 3;
+			const int cells = glm::clamp(static_cast<int>(std::sqrt(triangleCount / 2.0)), 1, 64);
+			const glm::dvec3 cellSize = glm::max(high - low, glm::dvec3(1e-9)) / static_cast<double>(cells);
+			auto cellOf = [&](const glm::dvec3& point)
+				{
+					return glm::clamp(glm::ivec3((point - low) / cellSize), glm::ivec3(0), glm::ivec3(cells - 1));
+				};
+			auto cellIndex = [cells](int x, int y, int z) { return (static_cast<size_t>(z) * cells + y) * cells + x; };
+
+			// triangles per cell in one array, every triangle in all cells its box touches
+			// first counted, then filled from the end of every cell towards its start
+			std::vector<uint32_t> cellStart(static_cast<size_t>(cells) * cells * cells + 1, 0);
+			std::vector<uint32_t> cellTriangles;
+			for (int pass = 0; pass < 2; pass++)
+			{
+				if (pass == 1)
+				{
+					for (size_t i = 1; i < cellStart.size(); i++)
+						cellStart[i] += cellStart[i - 1];
+					cellTriangles.resize(cellStart.back());
+				}
+				for (size_t t = 0; t < triangleCount; t++)
+				{
+					const glm::dvec3 a(mesh.positions[level[3 * t]]), b(mesh.positions[level[3 * t + 1]]), c(mesh.positions[level[3 * t + 2]]);
+					const glm::ivec3 first = cellOf(glm::min(a, glm::min(b, c))), last = cellOf(glm::max(a, glm::max(b, c)));
+					for (int z = first.z; z <= last.z; z++)
+						for (int y = first.y; y <= last.y; y++)
+							for (int x = first.x; x <= last.x; x++)
+							{
+								if (pass == 0)
+									cellStart[cellIndex(x, y, z)]++;
+								else
+									cellTriangles[--cellStart[cellIndex(x, y, z)]] = static_cast<uint32_t>(t);
+							}
+				}
+			}
+
+			auto distanceTo = [&](const glm::dvec3& p, size_t t)
+				{
+					return triangleDistance(p, mesh.positions[level[3 * t]], mesh.positions[level[3 * t + 1]], mesh.positions[level[3 * t + 2]]);
+				};
+			double maxDistance = 0.0;
+			for (const glm::vec3& position : mesh.positions)
+			{
+				const glm::dvec3 p(position);
+				const glm::ivec3 first = cellOf(p - expected), last = cellOf(p + expected);
+				double distance = std::numeric_limits<double>::max();
+				for (int z = first.z; z <= last.z; z++)
+					for (int y = first.y; y <= last.y; y++)
+						for (int x = first.x; x <= last.x; x++)
+						{
+							const size_t cell = cellIndex(x, y, z);
+							for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+								distance = std::min(distance, distanceTo(p, cellTriangles[i]));
+						}
+				if (distance > expected)
+				{
+					for (size_t t = 0; t < triangleCount; t++)
+						distance = std::min(distance, distanceTo(p, t));
+				}
+				maxDistance = std::max(maxDistance, distance);
+			}
+			return maxDistance;
+		};
+
+	// the levels Mesh::buildLods would keep, down to its smallest mesh
+	const unsigned int maxLevels = 16;
+	const size_t minIndexCount = 3 * 256;
+
+	LodMesh meshes[] = { makeSphere(settings.lodTriangles), makeHeightfield(settings.lodTriangles) };
+	std::cout << std::fixed << std::setprecision(3);
+	bool passed = true;
+	for (const LodMesh& mesh : meshes)
+	{
+		struct Level
+		{
+			std::vector<unsigned int> indices;
+			float error;
+		};
+		std::vector<Level> levels;
+
+		const auto start = std::chrono::steady_clock::now();
+		MeshSimplifier simplifier(mesh.positions, mesh.normals, mesh.texCoords, mesh.indices);
+		size_t indexCount = mesh.indices.size();
+		while (levels.size() < maxLevels && indexCount >= minIndexCount)
+		{
+			std::vector<unsigned int> simplified = simplifier.simplify(indexCount / 2);
+			if (simplified.empty())
+				break;
+			indexCount = simplified.size();
+			levels.push_back({ std::move(simplified), simplifier.getError() });
+		}
+		const double simplifyTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "Levels of detail: " << mesh.name << ", " << mesh.indices.size() / 3 << " triangles, " << levels.size()
+			<< " levels in " << std::setprecision(3) << simplifyTime << " ms" << std::endl;
+		size_t previous = mesh.indices.size() / 3;
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			const size_t triangles = levels[i].indices.size() / 3;
+			const double ratio = static_cast<double>(triangles) / previous;
+			const double error = levels[i].error;
+			const double distance = measureDistance(mesh, levels[i].indices, error * (1.0 + 1e-4) + 1e-6);
+			std::cout << "  level " << i + 1 << "  " << std::setw(7) << triangles << " triangles (" << std::setprecision(1) << ratio * 100.0
+				<< "%)  error " << std::setprecision(6) << error << "  measured " << distance << std::endl;
+
+			if (ratio < 0.4 || ratio > 0.55)
+			{
+				std::cout << "FAILED: " << mesh.name << " level " << i + 1 << " has " << std::setprecision(1) << ratio * 100.0 << "% of the triangles of the level before" << std::endl;
+				passed = false;
+			}
+			if (distance > error * (1.0 + 1e-4) + 1e-6)
+			{
+				std::cout << "FAILED: " << mesh.name << " level " << i + 1 << " is " << distance << " from the original surface, getError reports " << error << std::endl;
+				passed = false;
+			}
+			previous = triangles;
+		}
+		if (levels.empty())
+		{
+			std::cout << "FAILED: " << mesh.name << " could not be simplified" << std::endl;
+			passed = false;
+		}
+		if (settings.frameBudget > 0.0 && simplifyTime > settings.frameBudget)
+		{
+			std::cout << "FAILED: simplifying the " << mesh.name << " took " << std::setprecision(3) << simplifyTime << " ms, the budget is " << settings.frameBudget << " ms" << std::endl;
+			passed = false;
+		}
+	}
+	return passed;
+}
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 #include <learnopengl/bone.h>
@@ -17,6 +19,20 @@ struct AssimpNodeData
 	std::vector<AssimpNodeData> children;
 };
 
+// a node of the hierarchy with its bone track and palette entry resolved, see Animation::GetNodes
+struct AnimationNode
+{
+	// rest transform relative to the parent, used when the node has no track
+	glm::mat4 transformation;
+	// index in the node array, -1 for the root
+	int parent;
+	// index of the node's track in the animation's bones, -1 when it is not animated
+	int bone;
+	// index in the final bone matrices, -1 when no vertex is skinned to the node
+	int boneId;
+	glm::mat4 offset;
+};
+
 class Animation
 {
 public:
@@ -34,6 +50,7 @@ public:
 		globalTransformation = globalTransformation.Inverse();
 		ReadHierarchyData(m_RootNode, scene->mRootNode);
 		ReadMissingBones(animation, *model);
+		FlattenHierarchy();
 	}
 
 	~Animation()
@@ -60,6 +77,12 @@ public:
 	{ 
 		return m_BoneInfoMap;
 	}
+	// the hierarchy with every parent before its children, resolved once for the model the
+	// animation was loaded for
+	inline const std::vector<AnimationNode>& GetNodes() { return m_Nodes; }
+	inline std::vector<Bone>& GetBones() { return m_Bones; }
+	// one more than the largest boneId of the nodes
+	inline int GetBoneMatrixCount() { return m_BoneMatrixCount; }
 
 private:
 	void ReadMissingBones(const aiAnimation* animation, Model& model)
@@ -102,10 +125,43 @@ private:
 			dest.children.push_back(newData);
 		}
 	}
+	// looks the names of the nodes up once, so that evaluating the skeleton is one loop over m_Nodes
+	void FlattenHierarchy()
+	{
+		std::unordered_map<std::string, int> boneIndices;
+		for (int i = 0; i < static_cast<int>(m_Bones.size()); i++)
+			boneIndices.emplace(m_Bones[i].GetBoneName(), i);
+
+		std::vector<std::pair<const AssimpNodeData*, int>> stack = { { &m_RootNode, -1 } };
+		while (!stack.empty())
+		{
+			const auto [node, parent] = stack.back();
+			stack.pop_back();
+
+			AnimationNode flat;
+			flat.transformation = node->transformation;
+			flat.parent = parent;
+			const auto bone = boneIndices.find(node->name);
+			flat.bone = bone != boneIndices.end() ? bone->second : -1;
+			const auto boneInfo = m_BoneInfoMap.find(node->name);
+			flat.boneId = boneInfo != m_BoneInfoMap.end() ? boneInfo->second.id : -1;
+			flat.offset = boneInfo != m_BoneInfoMap.end() ? boneInfo->second.offset : glm::mat4(1.0f);
+			m_BoneMatrixCount = std::max(m_BoneMatrixCount, flat.boneId + 1);
+
+			const int index = static_cast<int>(m_Nodes.size());
+			m_Nodes.push_back(flat);
+			// reversed so that the children come out of the stack in their order
+			for (int i = node->childrenCount - 1; i >= 0; i--)
+				stack.push_back({ &node->children[i], index });
+		}
+	}
+
 	float m_Duration;
 	int m_TicksPerSecond;
 	std::vector<Bone> m_Bones;
 	AssimpNodeData m_RootNode;
 	std::map<std::string, BoneInfo> m_BoneInfoMap;
+	std::vector<AnimationNode> m_Nodes;
+	int m_BoneMatrixCount = 0;
 };
 
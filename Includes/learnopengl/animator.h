@@ -20,6 +20,7 @@ public:
 
 		for (int i = 0; i < 100; i++)
 			m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
+		ReserveBoneMatrices();
 	}
 
 	void UpdateAnimation(float dt)
@@ -29,7 +30,7 @@ public:
 		{
 			m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
 			m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
-			CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+			CalculateBoneTransforms();
 		}
 	}
 
@@ -37,42 +38,49 @@ public:
 	{
 		m_CurrentAnimation = pAnimation;
 		m_CurrentTime = 0.0f;
+		ReserveBoneMatrices();
 	}
 
-	void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
+	// the nodes are in parent first order, so the global transform of a node's parent is
+	// final when the node is reached and one pass over them evaluates the whole skeleton
+	void CalculateBoneTransforms()
 	{
-		std::string nodeName = node->name;
-		glm::mat4 nodeTransform = node->transformation;
+		const std::vector<AnimationNode>& nodes = m_CurrentAnimation->GetNodes();
+		std::vector<Bone>& bones = m_CurrentAnimation->GetBones();
+		m_GlobalTransforms.resize(nodes.size());
 
-		Bone* Bone = m_CurrentAnimation->FindBone(nodeName);
-
-		if (Bone)
+		for (size_t i = 0; i < nodes.size(); i++)
 		{
-			Bone->Update(m_CurrentTime);
-			nodeTransform = Bone->GetLocalTransform();
-		}
+			const AnimationNode& node = nodes[i];
+			glm::mat4 nodeTransform = node.transformation;
+			if (node.bone >= 0)
+			{
+				bones[node.bone].Update(m_CurrentTime);
+				nodeTransform = bones[node.bone].GetLocalTransform();
+			}
 
-		glm::mat4 globalTransformation = parentTransform * nodeTransform;
-
-		auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-		if (boneInfoMap.find(nodeName) != boneInfoMap.end())
-		{
-			int index = boneInfoMap[nodeName].id;
-			glm::mat4 offset = boneInfoMap[nodeName].offset;
-			m_FinalBoneMatrices[index] = globalTransformation * offset;
+			m_GlobalTransforms[i] = node.parent < 0 ? nodeTransform : m_GlobalTransforms[node.parent] * nodeTransform;
+			if (node.boneId >= 0)
+				m_FinalBoneMatrices[node.boneId] = m_GlobalTransforms[i] * node.offset;
 		}
-
-		for (int i = 0; i < node->childrenCount; i++)
-			CalculateBoneTransform(&node->children[i], globalTransformation);
 	}
 
-	std::vector<glm::mat4> GetFinalBoneMatrices()
+	const std::vector<glm::mat4>& GetFinalBoneMatrices() const
 	{
 		return m_FinalBoneMatrices;
 	}
 
 private:
+	// models with more bones than the shaders' 100 get a longer palette instead of writing past it
+	void ReserveBoneMatrices()
+	{
+		if (m_CurrentAnimation && m_CurrentAnimation->GetBoneMatrixCount() > static_cast<int>(m_FinalBoneMatrices.size()))
+			m_FinalBoneMatrices.resize(m_CurrentAnimation->GetBoneMatrixCount(), glm::mat4(1.0f));
+	}
+
 	std::vector<glm::mat4> m_FinalBoneMatrices;
+	// per node of the current animation, reused every update
+	std::vector<glm::mat4> m_GlobalTransforms;
 	Animation* m_CurrentAnimation;
 	float m_CurrentTime;
 	float m_DeltaTime;
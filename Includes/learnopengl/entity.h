@@ -2,9 +2,9 @@
 #define ENTITY_H
 
 #include <glm/glm.hpp> //glm::mat4
-#include <list> //std::list
 #include <array> //std::array
-#include <memory> //std::unique_ptr
+
+#include <learnopengl/transform_hierarchy.h>
 
 class Transform
 {
@@ -23,15 +23,8 @@ protected:
 protected:
 	glm::mat4 getLocalModelMatrix()
 	{
-		const glm::mat4 transformX = glm::rotate(glm::mat4(1.0f), glm::radians(m_eulerRot.x), glm::vec3(1.0f, 0.0f, 0.0f));
-		const glm::mat4 transformY = glm::rotate(glm::mat4(1.0f), glm::radians(m_eulerRot.y), glm::vec3(0.0f, 1.0f, 0.0f));
-		const glm::mat4 transformZ = glm::rotate(glm::mat4(1.0f), glm::radians(m_eulerRot.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-		// Y * X * Z
-		const glm::mat4 rotationMatrix = transformY * transformX * transformZ;
-
-		// translation * rotation * scale (also know as TRS matrix)
-		return glm::translate(glm::mat4(1.0f), m_pos) * rotationMatrix * glm::scale(glm::mat4(1.0f), m_scale);
+		// translation * rotation (Y * X * Z) * scale (also know as TRS matrix)
+		return composeTransform(m_pos, m_eulerRot, m_scale);
 	}
 public:
 
@@ -43,7 +36,7 @@ public:
 
 	void computeModelMatrix(const glm::mat4& parentGlobalModelMatrix)
 	{
-		m_modelMatrix = parentGlobalModelMatrix * getLocalModelMatrix();
+		m_modelMatrix = multiplyAffine(parentGlobalModelMatrix, getLocalModelMatrix());
 		m_isDirty = false;
 	}
 
@@ -65,7 +58,7 @@ public:
 		m_isDirty = true;
 	}
 
-	const glm::vec3& getGlobalPosition() const
+	glm::vec3 getGlobalPosition() const
 	{
 		return m_modelMatrix[3];
 	}
@@ -194,8 +187,7 @@ struct Sphere : public BoundingVolume
 		//To wrap correctly our shape, we need the maximum scale scalar.
 		const float maxScale = std::max(std::max(globalScale.x, globalScale.y), globalScale.z);
 
-		//Max scale is assuming for the diameter. So, we need the half to apply it to our radius
-		Sphere globalSphere(globalCenter, radius * (maxScale * 0.5f));
+		Sphere globalSphere(globalCenter, radius * maxScale);
 
 		//Check Firstly the result that have the most chance to failure to avoid to call all functions.
 		return (globalSphere.isOnOrForwardPlane(camFrustum.leftFace) &&
@@ -269,6 +261,8 @@ struct AABB : public BoundingVolume
 		: BoundingVolume{}, center{ inCenter }, extents{ iI, iJ, iK }
 	{}
 
+	using BoundingVolume::isOnFrustum;
+
 	std::array<glm::vec3, 8> getVertice() const
 	{
 		std::array<glm::vec3, 8> vertice;
@@ -295,27 +289,9 @@ struct AABB : public BoundingVolume
 
 	bool isOnFrustum(const Frustum& camFrustum, const Transform& transform) const final
 	{
-		//Get global scale thanks to our transform
-		const glm::vec3 globalCenter{ transform.getModelMatrix() * glm::vec4(center, 1.f) };
-
-		// Scaled orientation
-		const glm::vec3 right = transform.getRight() * extents.x;
-		const glm::vec3 up = transform.getUp() * extents.y;
-		const glm::vec3 forward = transform.getForward() * extents.z;
-
-		const float newIi = std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, right)) +
-			std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, up)) +
-			std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, forward));
-
-		const float newIj = std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, right)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, up)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, forward));
-
-		const float newIk = std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, right)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, up)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, forward));
-
-		const AABB globalAABB(globalCenter, newIi, newIj, newIk);
+		// the world box around the transformed box, three abs-weighted columns instead of nine dot products
+		const BoxBounds global = transformBounds(transform.getModelMatrix(), { center, extents });
+		const AABB globalAABB(global.center, global.extents.x, global.extents.y, global.extents.z);
 
 		return (globalAABB.isOnOrForwardPlane(camFrustum.leftFace) &&
 			globalAABB.isOnOrForwardPlane(camFrustum.rightFace) &&
@@ -342,144 +318,81 @@ Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, flo
 	return frustum;
 }
 
+// the bounds are computed when the model is imported, see Model::bounds
 AABB generateAABB(const Model& model)
 {
-	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
-	for (auto&& mesh : model.meshes)
-	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
-
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
-	}
-	return AABB(minAABB, maxAABB);
+	return AABB(model.bounds.min, model.bounds.max);
 }
 
 Sphere generateSphereBV(const Model& model)
 {
-	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
-	for (auto&& mesh : model.meshes)
-	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
-
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
-	}
-
-	return Sphere((maxAABB + minAABB) * 0.5f, glm::length(minAABB - maxAABB));
+	return Sphere(model.bounds.sphereCenter, model.bounds.sphereRadius);
 }
 
+// A model placed in a TransformHierarchy. Entities are handles: the transforms and
+// world bounds of all entities live in the hierarchy, so one update of it moves
+// every entity and refits the bounds of those that moved.
 class Entity
 {
 public:
 	//Scene graph
-	std::list<std::unique_ptr<Entity>> children;
-	Entity* parent = nullptr;
-
-	//Space information
-	Transform transform;
+	TransformHierarchy* transforms = nullptr;
+	TransformHierarchy::Handle node = TransformHierarchy::none;
 
 	Model* pModel = nullptr;
-	std::unique_ptr<AABB> boundingVolume;
+	AABB boundingVolume;
 
 
-	// constructor, expects a filepath to a 3D model.
-	Entity(Model& model) : pModel{ &model }
+	// constructor, expects the hierarchy to place the node in and a 3D model.
+	Entity(TransformHierarchy& hierarchy, Model& model, TransformHierarchy::Handle parent = TransformHierarchy::none)
+		: transforms{ &hierarchy }, node{ hierarchy.create(parent) }, pModel{ &model }, boundingVolume{ generateAABB(model) }
 	{
-		boundingVolume = std::make_unique<AABB>(generateAABB(model));
-		//boundingVolume = std::make_unique<Sphere>(generateSphereBV(model));
+		hierarchy.setLocalBounds(node, { boundingVolume.center, boundingVolume.extents });
 	}
 
-	AABB getGlobalAABB()
+	//Add child placed relative to this entity
+	Entity addChild(Model& model)
 	{
-		//Get global scale thanks to our transform
-		const glm::vec3 globalCenter{ transform.getModelMatrix() * glm::vec4(boundingVolume->center, 1.f) };
-
-		// Scaled orientation
-		const glm::vec3 right = transform.getRight() * boundingVolume->extents.x;
-		const glm::vec3 up = transform.getUp() * boundingVolume->extents.y;
-		const glm::vec3 forward = transform.getForward() * boundingVolume->extents.z;
-
-		const float newIi = std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, right)) +
-			std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, up)) +
-			std::abs(glm::dot(glm::vec3{ 1.f, 0.f, 0.f }, forward));
-
-		const float newIj = std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, right)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, up)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 1.f, 0.f }, forward));
-
-		const float newIk = std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, right)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, up)) +
-			std::abs(glm::dot(glm::vec3{ 0.f, 0.f, 1.f }, forward));
-
-		return AABB(globalCenter, newIi, newIj, newIk);
+		return Entity(*transforms, model, node);
 	}
 
-	//Add child. Argument input is argument of any constructor that you create. By default you can use the default constructor and don't put argument input.
-	template<typename... TArgs>
-	void addChild(TArgs&... args)
+	void setLocalPosition(const glm::vec3& newPosition)
 	{
-		children.emplace_back(std::make_unique<Entity>(args...));
-		children.back()->parent = this;
+		transforms->setLocalPosition(node, newPosition);
 	}
 
-	//Update transform if it was changed
-	void updateSelfAndChild()
-	{
-		if (transform.isDirty()) {
-			forceUpdateSelfAndChild();
-			return;
-		}
-			
-		for (auto&& child : children)
-		{
-			child->updateSelfAndChild();
-		}
+	void setLocalRotation(const glm::vec3& newRotation)
+	{
+		transforms->setLocalRotation(node, newRotation);
 	}
 
-	//Force update of transform even if local space don't change
-	void forceUpdateSelfAndChild()
+	void setLocalScale(const glm::vec3& newScale)
 	{
-		if (parent)
-			transform.computeModelMatrix(parent->transform.getModelMatrix());
-		else
-			transform.computeModelMatrix();
+		transforms->setLocalScale(node, newScale);
+	}
 
-		for (auto&& child : children)
-		{
-			child->forceUpdateSelfAndChild();
-		}
+	//Global model matrix as of the last TransformHierarchy::update
+	const glm::mat4& getModelMatrix() const
+	{
+		return transforms->getWorldMatrix(node);
 	}
 
+	//World bounds cached by the hierarchy, refit only when the entity or one of its parents moved
+	AABB getGlobalAABB() const
+	{
+		const BoxBounds& bounds = transforms->getWorldBounds(node);
+		return AABB(bounds.center, bounds.extents.x, bounds.extents.y, bounds.extents.z);
+	}
 
-	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total)
+	//Draw if the bounding volume is in the frustum, returns whether it was drawn
+	bool draw(const Frustum& frustum, Shader& ourShader) const
 	{
-		if (boundingVolume->isOnFrustum(frustum, transform))
-		{
-			ourShader.setMat4("model", transform.getModelMatrix());
-			pModel->Draw(ourShader);
-			display++;
-		}
-		total++;
+		if (!getGlobalAABB().isOnFrustum(frustum))
+			return false;
 
-		for (auto&& child : children)
-		{
-			child->drawSelfAndChild(frustum, ourShader, display, total);
-		}
+		ourShader.setMat4("model", getModelMatrix());
+		pModel->Draw(ourShader);
+		return true;
 	}
 };
 #endif
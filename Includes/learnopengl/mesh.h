@@ -7,7 +7,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/mesh_bounds.h>
+#include <learnopengl/mesh_simplifier.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 using namespace std;
@@ -31,6 +34,14 @@ struct Vertex {
 	float m_Weights[MAX_BONE_INFLUENCE];
 };
 
+// a level of detail: a range of the index buffer over the shared vertices
+struct MeshLod {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    // largest distance to the surface of the full mesh, in model units
+    float error;
+};
+
 struct Texture {
     unsigned int id;
     string type;
@@ -43,21 +54,27 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // lods[0] is the full mesh, every further level has about half the triangles of the one before
+    vector<MeshLod>      lods;
+    // model space bounds, computed by the importer
+    MeshBounds           bounds;
     unsigned int VAO;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor; lodCount > 1 also simplifies the mesh into that many levels of detail in total
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, unsigned int lodCount = 1, const MeshBounds& bounds = MeshBounds())
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        this->bounds = bounds;
 
+        buildLods(lodCount);
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // render the mesh at a level of detail, clamped to the coarsest one
+    void Draw(Shader &shader, unsigned int lod = 0) 
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -96,8 +113,9 @@ public:
         }
         
         // draw mesh
+        const MeshLod& level = lods[std::min<size_t>(lod, lods.size() - 1)];
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(level.indexOffset * sizeof(unsigned int)));
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -107,6 +125,38 @@ public:
 private:
     // render data 
     unsigned int VBO, EBO;
+    // indices of the simplified levels, stored after indices in the index buffer
+    vector<unsigned int> lodIndices;
+
+    // meshes smaller than this are drawn in full at every level
+    static constexpr size_t minLodIndexCount = 3 * 256;
+
+    // simplifies the mesh level by level; stops early when half of the triangles cannot be removed anymore
+    void buildLods(unsigned int lodCount)
+    {
+        lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+        if (lodCount <= 1 || indices.size() < minLodIndexCount)
+            return;
+
+        vector<glm::vec3> positions, normals;
+        vector<glm::vec2> texCoords;
+        for (const Vertex& vertex : vertices)
+        {
+            positions.push_back(vertex.Position);
+            normals.push_back(vertex.Normal);
+            texCoords.push_back(vertex.TexCoords);
+        }
+
+        MeshSimplifier simplifier(positions, normals, texCoords, indices);
+        for (unsigned int i = 1; i < lodCount; i++)
+        {
+            const vector<unsigned int> simplified = simplifier.simplify(lods.back().indexCount / 2);
+            if (simplified.empty() || simplified.size() > lods.back().indexCount * 3 / 4)
+                break;
+            lods.push_back({ static_cast<unsigned int>(indices.size() + lodIndices.size()), static_cast<unsigned int>(simplified.size()), simplifier.getError() });
+            lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+        }
+    }
 
     // initializes all the buffer objects/arrays
     void setupMesh()
@@ -125,7 +175,9 @@ private:
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (indices.size() + lodIndices.size()) * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), lodIndices.size() * sizeof(unsigned int), lodIndices.data());
 
         // set the vertex attribute pointers
         // vertex Positions
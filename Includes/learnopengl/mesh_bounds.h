@@ -0,0 +1,207 @@
+#ifndef MESH_BOUNDS_H
+#define MESH_BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Bounds of a mesh in model space, computed once when it is imported: an
+// axis-aligned box, a bounding sphere and a box along the principal axes of
+// the vertices. An empty mesh has all bounds at the origin with zero size.
+struct MeshBounds
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	// the smaller of Ritter's sphere and the sphere around the center of the box
+	glm::vec3 sphereCenter = glm::vec3(0.0f);
+	float sphereRadius = 0.0f;
+
+	// oriented box: columns of boxAxes are unit axes, boxExtents the half sizes along
+	// them; the axis-aligned box when the principal axes do not give a smaller one
+	glm::vec3 boxCenter = glm::vec3(0.0f);
+	glm::mat3 boxAxes = glm::mat3(1.0f);
+	glm::vec3 boxExtents = glm::vec3(0.0f);
+
+	// whether the bounds can be in front of all planes, see getClipPlanes; the sphere
+	// rejects most boxes far outside a plane, the oriented box the rest
+	bool isInside(const std::array<glm::vec4, 6>& planes) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			const glm::vec3 normal = glm::vec3(plane);
+			if (glm::dot(normal, sphereCenter) + plane.w < -sphereRadius * glm::length(normal))
+				return false;
+			const float radius = boxExtents.x * std::abs(glm::dot(normal, boxAxes[0]))
+				+ boxExtents.y * std::abs(glm::dot(normal, boxAxes[1]))
+				+ boxExtents.z * std::abs(glm::dot(normal, boxAxes[2]));
+			if (glm::dot(normal, boxCenter) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+};
+
+// The planes of the clip volume of a projection * view * model matrix in model space
+// (Gribb and Hartmann), with normals pointing inwards. They are not normalized: a point
+// p is inside when dot(plane, vec4(p, 1)) >= 0 for all of them.
+inline std::array<glm::vec4, 6> getClipPlanes(const glm::mat4& matrix)
+{
+	const glm::vec4 x = glm::vec4(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	const glm::vec4 y = glm::vec4(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	const glm::vec4 z = glm::vec4(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	const glm::vec4 w = glm::vec4(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+	return { w + x, w - x, w + y, w - y, w + z, w - z };
+}
+
+// eigenvectors of a symmetric matrix as columns, by cyclic Jacobi rotations
+inline glm::dmat3 getSymmetricEigenvectors(glm::dmat3 matrix)
+{
+	glm::dmat3 vectors(1.0);
+	for (int sweep = 0; sweep < 32; sweep++)
+	{
+		const double offDiagonal = matrix[1][0] * matrix[1][0] + matrix[2][0] * matrix[2][0] + matrix[2][1] * matrix[2][1];
+		const double diagonal = matrix[0][0] * matrix[0][0] + matrix[1][1] * matrix[1][1] + matrix[2][2] * matrix[2][2];
+		if (offDiagonal <= 1e-24 * diagonal)
+			break;
+
+		for (int p = 0; p < 2; p++)
+		{
+			for (int q = p + 1; q < 3; q++)
+			{
+				if (matrix[q][p] == 0.0)
+					continue;
+				// the rotation in the p, q plane that zeroes matrix[q][p]
+				const double theta = (matrix[q][q] - matrix[p][p]) / (2.0 * matrix[q][p]);
+				const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+				const double c = 1.0 / std::sqrt(t * t + 1.0);
+				const double s = t * c;
+				glm::dmat3 rotation(1.0);
+				rotation[p][p] = c;
+				rotation[q][q] = c;
+				rotation[q][p] = s;
+				rotation[p][q] = -s;
+				matrix = glm::transpose(rotation) * matrix * rotation;
+				vectors = vectors * rotation;
+			}
+		}
+	}
+	return vectors;
+}
+
+// bounds of count positions, positionAt(i) returns the i-th one; a few passes over them,
+// meant for import time and not for every frame
+template <typename PositionAt>
+MeshBounds computeMeshBounds(size_t count, PositionAt&& positionAt)
+{
+	MeshBounds bounds;
+	if (count == 0)
+		return bounds;
+
+	// box, mean and covariance in one pass; the covariance sums are in double so that
+	// subtracting the mean afterwards does not cancel
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+	glm::dvec3 sum(0.0);
+	glm::dmat3 products(0.0);
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::vec3 position = positionAt(i);
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+		const glm::dvec3 p(position);
+		sum += p;
+		products += glm::outerProduct(p, p);
+	}
+	bounds.min = min;
+	bounds.max = max;
+
+	auto farthestFrom = [&](const glm::vec3& point)
+		{
+			size_t farthest = 0;
+			float farthestDistance = -1.0f;
+			for (size_t i = 0; i < count; i++)
+			{
+				const glm::vec3 offset = positionAt(i) - point;
+				const float distance = glm::dot(offset, offset);
+				if (distance > farthestDistance)
+				{
+					farthest = i;
+					farthestDistance = distance;
+				}
+			}
+			return farthest;
+		};
+	auto radiusAround = [&](const glm::vec3& center)
+		{
+			float radius = 0.0f;
+			for (size_t i = 0; i < count; i++)
+				radius = std::max(radius, glm::length(positionAt(i) - center));
+			return radius;
+		};
+
+	// Ritter: start with the sphere through two far apart points and grow it towards
+	// every point outside; the radius is then measured again, which also covers points
+	// that rounding left just outside
+	const glm::vec3 a = positionAt(farthestFrom(positionAt(0)));
+	const glm::vec3 b = positionAt(farthestFrom(a));
+	glm::vec3 center = (a + b) * 0.5f;
+	float radius = glm::length(b - a) * 0.5f;
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::vec3 offset = positionAt(i) - center;
+		const float distance = glm::length(offset);
+		if (distance > radius)
+		{
+			const float grown = (radius + distance) * 0.5f;
+			center += offset * ((grown - radius) / distance);
+			radius = grown;
+		}
+	}
+	bounds.sphereCenter = center;
+	bounds.sphereRadius = radiusAround(center);
+	const glm::vec3 boxCenter = (min + max) * 0.5f;
+	const float boxRadius = radiusAround(boxCenter);
+	if (boxRadius < bounds.sphereRadius)
+	{
+		bounds.sphereCenter = boxCenter;
+		bounds.sphereRadius = boxRadius;
+	}
+
+	// principal axes: the eigenvectors of the covariance of the positions
+	bounds.boxCenter = boxCenter;
+	bounds.boxExtents = (max - min) * 0.5f;
+	const glm::dvec3 mean = sum / static_cast<double>(count);
+	const glm::dmat3 covariance = products / static_cast<double>(count) - glm::outerProduct(mean, mean);
+	const glm::mat3 axes = glm::mat3(getSymmetricEigenvectors(covariance));
+
+	glm::vec3 low = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 high = glm::vec3(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::vec3 projected = glm::transpose(axes) * positionAt(i);
+		low = glm::min(low, projected);
+		high = glm::max(high, projected);
+	}
+	const glm::vec3 size = high - low;
+	const glm::vec3 boxSize = max - min;
+	if (size.x * size.y * size.z < boxSize.x * boxSize.y * boxSize.z)
+	{
+		bounds.boxCenter = axes * ((low + high) * 0.5f);
+		bounds.boxAxes = axes;
+		bounds.boxExtents = size * 0.5f;
+	}
+	return bounds;
+}
+
+inline MeshBounds computeMeshBounds(const std::vector<glm::vec3>& positions)
+{
+	return computeMeshBounds(positions.size(), [&positions](size_t i) { return positions[i]; });
+}
+
+#endif
@@ -0,0 +1,498 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Sum of squared distances to a set of planes as a symmetric 4x4 matrix
+// (Garland and Heckbert). Face planes are weighted by the triangle area and
+// add it to weight, so evaluate(p) / weight is the mean squared distance.
+struct Quadric
+{
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double weight = 0.0;
+
+	// the plane dot(normal, p) + distance = 0 with a unit normal
+	static Quadric fromPlane(const glm::dvec3& normal, double distance, double weight)
+	{
+		Quadric q;
+		q.a2 = normal.x * normal.x * weight;
+		q.ab = normal.x * normal.y * weight;
+		q.ac = normal.x * normal.z * weight;
+		q.ad = normal.x * distance * weight;
+		q.b2 = normal.y * normal.y * weight;
+		q.bc = normal.y * normal.z * weight;
+		q.bd = normal.y * distance * weight;
+		q.c2 = normal.z * normal.z * weight;
+		q.cd = normal.z * distance * weight;
+		q.d2 = distance * distance * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	void add(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+		weight += q.weight;
+	}
+
+	double evaluate(const glm::dvec3& p) const
+	{
+		return a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+			+ b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+			+ c2 * p.z * p.z + 2.0 * cd * p.z
+			+ d2;
+	}
+};
+
+// Quadric error edge collapse simplification of an indexed triangle mesh.
+// Vertices are welded by position first, so attribute seams do not split the
+// surface; a collapse moves one position onto the other, and every vertex at
+// the removed position takes the vertex at the kept position with the
+// closest normal and texture coordinates. No new vertices are created, so
+// every level of detail indexes the original vertex buffer. Borders and
+// attribute seams get extra planes through their edges that keep them in
+// place, and collapses that would flip a triangle or pinch the surface are
+// skipped. Successive simplify calls continue from the previous result,
+// which gives nested levels of detail for the price of one simplification.
+class MeshSimplifier
+{
+public:
+	// normals and texCoords may be empty; they only pick vertices across seams
+	MeshSimplifier(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texCoords, const std::vector<unsigned int>& indices)
+		: normals(normals), texCoords(texCoords)
+	{
+		// weld vertices at the same position
+		std::vector<unsigned int> order(positions.size());
+		std::iota(order.begin(), order.end(), 0u);
+		auto less = [&positions](unsigned int a, unsigned int b)
+			{
+				const glm::vec3& pa = positions[a];
+				const glm::vec3& pb = positions[b];
+				return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+			};
+		std::sort(order.begin(), order.end(), less);
+		vertexPosition.resize(positions.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			if (i == 0 || positions[order[i]] != positions[order[i - 1]])
+			{
+				weldedPositions.push_back(positions[order[i]]);
+				positionVertices.emplace_back();
+			}
+			vertexPosition[order[i]] = static_cast<unsigned int>(weldedPositions.size() - 1);
+			positionVertices.back().push_back(order[i]);
+		}
+
+		const size_t positionCount = weldedPositions.size();
+		quadrics.resize(positionCount);
+		positionTriangles.resize(positionCount);
+		positionAlive.assign(positionCount, true);
+		clusters.resize(positionCount);
+		for (unsigned int i = 0; i < positionCount; i++)
+			clusters[i].push_back(i);
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const std::array<unsigned int, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+			const unsigned int p0 = vertexPosition[triangle[0]], p1 = vertexPosition[triangle[1]], p2 = vertexPosition[triangle[2]];
+			if (p0 == p1 || p1 == p2 || p2 == p0)
+				continue;
+			const unsigned int index = static_cast<unsigned int>(triangles.size());
+			triangles.push_back(triangle);
+			triangleAlive.push_back(true);
+			for (unsigned int p : { p0, p1, p2 })
+				positionTriangles[p].push_back(index);
+		}
+		liveTriangleCount = triangles.size();
+
+		// face planes, and the edges with the triangles that use them
+		struct Edge
+		{
+			unsigned int count = 0;
+			unsigned int vertexA = 0, vertexB = 0;
+			bool seam = false;
+		};
+		std::unordered_map<uint64_t, Edge> edges;
+		for (const std::array<unsigned int, 3>& triangle : triangles)
+		{
+			const glm::dvec3 p0 = getPosition(triangle[0]), p1 = getPosition(triangle[1]), p2 = getPosition(triangle[2]);
+			const glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+			const double length = glm::length(cross);
+			if (length > 0.0)
+			{
+				const glm::dvec3 normal = cross / length;
+				const Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+				for (int k = 0; k < 3; k++)
+					quadrics[vertexPosition[triangle[k]]].add(plane);
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned int a = triangle[k], b = triangle[(k + 1) % 3];
+				Edge& edge = edges[getEdgeKey(vertexPosition[a], vertexPosition[b])];
+				// the neighbor runs the edge the other way and shares its vertices unless there is a seam
+				if (edge.count++ == 0)
+				{
+					edge.vertexA = a;
+					edge.vertexB = b;
+				}
+				else if (edge.vertexA != b || edge.vertexB != a)
+					edge.seam = true;
+			}
+		}
+
+		// planes through border and seam edges, perpendicular to their triangle; they
+		// bound how far such an edge can move without counting as surface area
+		for (const std::array<unsigned int, 3>& triangle : triangles)
+		{
+			const glm::dvec3 p0 = getPosition(triangle[0]), p1 = getPosition(triangle[1]), p2 = getPosition(triangle[2]);
+			const glm::dvec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned int a = triangle[k], b = triangle[(k + 1) % 3];
+				const Edge& edge = edges[getEdgeKey(vertexPosition[a], vertexPosition[b])];
+				if (edge.count == 2 && !edge.seam)
+					continue;
+				const glm::dvec3 pa = getPosition(a);
+				const glm::dvec3 direction = getPosition(b) - pa;
+				const glm::dvec3 cross = glm::cross(direction, faceNormal);
+				const double length = glm::length(cross);
+				if (length == 0.0)
+					continue;
+				const glm::dvec3 normal = cross / length;
+				Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, pa), borderWeight * glm::dot(direction, direction));
+				plane.weight = 0.0;
+				quadrics[vertexPosition[a]].add(plane);
+				quadrics[vertexPosition[b]].add(plane);
+			}
+		}
+
+		for (const auto& [key, edge] : edges)
+		{
+			const unsigned int a = static_cast<unsigned int>(key >> 32), b = static_cast<unsigned int>(key);
+			pushCollapse(a, b);
+			pushCollapse(b, a);
+		}
+	}
+
+	// collapses the cheapest edges until at most targetIndexCount indices are left or
+	// no edge can be collapsed anymore; returns the indices of what is left
+	std::vector<unsigned int> simplify(size_t targetIndexCount)
+	{
+		while (liveTriangleCount * 3 > targetIndexCount && !collapses.empty())
+		{
+			const Collapse collapse = collapses.top();
+			collapses.pop();
+			if (!positionAlive[collapse.from] || !positionAlive[collapse.to])
+				continue;
+
+			// quadrics only grow, so a queued cost is a lower bound; requeue outdated ones
+			const double cost = getCost(collapse.from, collapse.to);
+			if (cost > collapse.cost * (1.0 + 1e-9) + 1e-30)
+			{
+				collapses.push({ cost, collapse.from, collapse.to });
+				continue;
+			}
+			if (!canCollapse(collapse.from, collapse.to))
+				continue;
+
+			collapseEdge(collapse.from, collapse.to);
+		}
+
+		std::vector<unsigned int> result;
+		result.reserve(liveTriangleCount * 3);
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			if (triangleAlive[i])
+				result.insert(result.end(), triangles[i].begin(), triangles[i].end());
+		}
+		return result;
+	}
+
+	// largest distance of an original position to the simplified surface around the
+	// position it was collapsed into, measured whenever a collapse changes the triangles
+	// there, in model units
+	float getError() const
+	{
+		return error;
+	}
+
+private:
+	struct Collapse
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+
+		bool operator>(const Collapse& other) const
+		{
+			return cost > other.cost;
+		}
+	};
+
+	// border and seam planes count this much more than the faces around them
+	static constexpr double borderWeight = 10.0;
+
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texCoords;
+
+	std::vector<glm::vec3> weldedPositions;
+	std::vector<unsigned int> vertexPosition;
+	std::vector<std::vector<unsigned int>> positionVertices;
+	std::vector<Quadric> quadrics;
+	// triangles around every position; may still list removed triangles
+	std::vector<std::vector<unsigned int>> positionTriangles;
+	std::vector<bool> positionAlive;
+	// the original positions every live position stands for
+	std::vector<std::vector<unsigned int>> clusters;
+
+	// corners are vertex indices
+	std::vector<std::array<unsigned int, 3>> triangles;
+	std::vector<bool> triangleAlive;
+	size_t liveTriangleCount = 0;
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+	float error = 0.0f;
+
+	static uint64_t getEdgeKey(unsigned int a, unsigned int b)
+	{
+		return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+	}
+
+	glm::dvec3 getPosition(unsigned int vertex) const
+	{
+		return glm::dvec3(weldedPositions[vertexPosition[vertex]]);
+	}
+
+	// mean squared distance of the kept position to the planes of both
+	double getCost(unsigned int from, unsigned int to) const
+	{
+		Quadric q = quadrics[from];
+		q.add(quadrics[to]);
+		return std::max(0.0, q.evaluate(glm::dvec3(weldedPositions[to]))) / std::max(q.weight, 1e-30);
+	}
+
+	void pushCollapse(unsigned int from, unsigned int to)
+	{
+		collapses.push({ getCost(from, to), from, to });
+	}
+
+	// the positions of live triangles around position, without itself
+	void getNeighbors(unsigned int position, std::vector<unsigned int>& neighbors) const
+	{
+		neighbors.clear();
+		for (unsigned int t : positionTriangles[position])
+		{
+			if (!triangleAlive[t])
+				continue;
+			for (unsigned int vertex : triangles[t])
+			{
+				const unsigned int p = vertexPosition[vertex];
+				if (p != position && std::find(neighbors.begin(), neighbors.end(), p) == neighbors.end())
+					neighbors.push_back(p);
+			}
+		}
+	}
+
+	// the edge still exists, no remaining triangle flips or degenerates, and the
+	// positions share no neighbors except across the triangles of the edge
+	bool canCollapse(unsigned int from, unsigned int to) const
+	{
+		const glm::dvec3 target = glm::dvec3(weldedPositions[to]);
+		unsigned int sharedTriangles = 0;
+		for (unsigned int t : positionTriangles[from])
+		{
+			if (!triangleAlive[t])
+				continue;
+			std::array<glm::dvec3, 3> corners;
+			bool hasTo = false;
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned int p = vertexPosition[triangles[t][k]];
+				hasTo = hasTo || p == to;
+				corners[k] = glm::dvec3(weldedPositions[p]);
+			}
+			if (hasTo)
+			{
+				sharedTriangles++;
+				continue;
+			}
+
+			const glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			for (int k = 0; k < 3; k++)
+			{
+				if (vertexPosition[triangles[t][k]] == from)
+					corners[k] = target;
+			}
+			const glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			if (glm::dot(before, after) <= 1e-6 * glm::dot(before, before))
+				return false;
+		}
+		if (sharedTriangles == 0)
+			return false;
+
+		static thread_local std::vector<unsigned int> fromNeighbors, toNeighbors;
+		getNeighbors(from, fromNeighbors);
+		getNeighbors(to, toNeighbors);
+		unsigned int sharedNeighbors = 0;
+		for (unsigned int p : fromNeighbors)
+			sharedNeighbors += std::find(toNeighbors.begin(), toNeighbors.end(), p) != toNeighbors.end() ? 1 : 0;
+		return sharedNeighbors <= sharedTriangles;
+	}
+
+	static double getSquaredDistance(const glm::dvec3& p, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+	{
+		// closest point on the triangle by its Voronoi regions (Ericson, Real-Time Collision Detection 5.1.5)
+		const glm::dvec3 ab = b - a, ac = c - a, ap = p - a;
+		const double d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0 && d2 <= 0.0)
+			return glm::dot(ap, ap);
+		const glm::dvec3 bp = p - b;
+		const double d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0 && d4 <= d3)
+			return glm::dot(bp, bp);
+		const glm::dvec3 cp = p - c;
+		const double d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0 && d5 <= d6)
+			return glm::dot(cp, cp);
+
+		glm::dvec3 closest;
+		const double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+			closest = a + ab * (d1 / (d1 - d3));
+		else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+			closest = a + ac * (d2 / (d2 - d6));
+		else if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+			closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		else
+		{
+			const double denominator = 1.0 / (va + vb + vc);
+			closest = a + ab * (vb * denominator) + ac * (vc * denominator);
+		}
+		return glm::dot(p - closest, p - closest);
+	}
+
+	// the vertex at position with the attributes closest to vertex
+	unsigned int findVertex(unsigned int vertex, unsigned int position) const
+	{
+		const std::vector<unsigned int>& candidates = positionVertices[position];
+		unsigned int best = candidates[0];
+		float bestDistance = std::numeric_limits<float>::max();
+		for (unsigned int candidate : candidates)
+		{
+			float distance = 0.0f;
+			if (!normals.empty())
+				distance += glm::dot(normals[vertex] - normals[candidate], normals[vertex] - normals[candidate]);
+			if (!texCoords.empty())
+				distance += glm::dot(texCoords[vertex] - texCoords[candidate], texCoords[vertex] - texCoords[candidate]);
+			if (distance < bestDistance)
+			{
+				best = candidate;
+				bestDistance = distance;
+			}
+		}
+		return best;
+	}
+
+	void collapseEdge(unsigned int from, unsigned int to)
+	{
+		std::vector<unsigned int>& toTriangles = positionTriangles[to];
+		for (unsigned int t : positionTriangles[from])
+		{
+			if (!triangleAlive[t])
+				continue;
+			bool hasTo = false;
+			for (unsigned int vertex : triangles[t])
+				hasTo = hasTo || vertexPosition[vertex] == to;
+			if (hasTo)
+			{
+				triangleAlive[t] = false;
+				liveTriangleCount--;
+				continue;
+			}
+			for (unsigned int& vertex : triangles[t])
+			{
+				if (vertexPosition[vertex] == from)
+					vertex = findVertex(vertex, to);
+			}
+			toTriangles.push_back(t);
+		}
+		positionTriangles[from].clear();
+		positionTriangles[from].shrink_to_fit();
+		positionAlive[from] = false;
+		quadrics[to].add(quadrics[from]);
+
+		toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [this](unsigned int t) { return !triangleAlive[t]; }), toTriangles.end());
+
+		// every edge at the kept position has a new cost
+		std::vector<unsigned int> neighbors;
+		getNeighbors(to, neighbors);
+		for (unsigned int neighbor : neighbors)
+		{
+			pushCollapse(to, neighbor);
+			pushCollapse(neighbor, to);
+		}
+
+		// the quadric cost ranks collapses but underestimates how far the surface moved.
+		// The removed positions lay on the surface that the triangles around the
+		// position they were collapsed into now cover; earlier collapses of neighbors
+		// may have moved part of it into their fans, so those count too. The collapse
+		// changed the fans of the kept position and of all its neighbors, so the
+		// positions collapsed into any of them are measured again. A position stops
+		// being measured once it is within the error so far, as it cannot raise it.
+		clusters[to].insert(clusters[to].end(), clusters[from].begin(), clusters[from].end());
+		double maxDistance = static_cast<double>(error) * error;
+		std::vector<unsigned int> ring, nearby;
+		auto measure = [&](unsigned int position)
+			{
+				getNeighbors(position, ring);
+				nearby.clear();
+				ring.push_back(position);
+				for (unsigned int p : ring)
+				{
+					for (unsigned int t : positionTriangles[p])
+					{
+						if (triangleAlive[t])
+							nearby.push_back(t);
+					}
+				}
+				if (nearby.empty())
+					return;
+				for (unsigned int clustered : clusters[position])
+				{
+					const glm::dvec3 p = glm::dvec3(weldedPositions[clustered]);
+					double distance = std::numeric_limits<double>::max();
+					for (size_t i = 0; i < nearby.size() && distance > maxDistance; i++)
+					{
+						const std::array<unsigned int, 3>& triangle = triangles[nearby[i]];
+						distance = std::min(distance, getSquaredDistance(p, getPosition(triangle[0]), getPosition(triangle[1]), getPosition(triangle[2])));
+					}
+					maxDistance = std::max(maxDistance, distance);
+				}
+			};
+		measure(to);
+		for (unsigned int neighbor : neighbors)
+			measure(neighbor);
+		error = std::max(error, static_cast<float>(std::sqrt(maxDistance)));
+		clusters[from].clear();
+		clusters[from].shrink_to_fit();
+	}
+};
+
+#endif
@@ -33,18 +33,22 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // levels of detail built for every mesh while importing, including the full mesh
+    unsigned int lodCount;
+    // bounds of all meshes together; every mesh has its own as well
+    MeshBounds bounds;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, unsigned int lodCount = 4) : gammaCorrection(gamma), lodCount(lodCount)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // draws the model, and thus all its meshes, at a level of detail
+    void Draw(Shader &shader, unsigned int lod = 0)
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, lod);
     }
     
 private:
@@ -65,6 +69,15 @@ private:
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+
+        // bounds of the whole model, once here instead of whenever something needs them
+        vector<glm::vec3> positions;
+        for (const Mesh& mesh : meshes)
+        {
+            for (const Vertex& vertex : mesh.vertices)
+                positions.push_back(vertex.Position);
+        }
+        bounds = computeMeshBounds(positions);
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -177,8 +190,11 @@ private:
 		std::vector<Texture> shininessMaps = loadMaterialTextures(material, aiTextureType_SHININESS, "texture_shininess", scene);
 		textures.insert(textures.end(), shininessMaps.begin(), shininessMaps.end());
         
+        // bounds of the mesh in model space, for culling it on its own
+        const MeshBounds meshBounds = computeMeshBounds(vertices.size(), [&vertices](size_t i) { return vertices[i].Position; });
+
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(vertices, indices, textures, lodCount, meshBounds);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
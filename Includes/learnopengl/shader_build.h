@@ -0,0 +1,196 @@
+#ifndef SHADER_BUILD_H
+#define SHADER_BUILD_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+// GL_KHR_parallel_shader_compile is not part of the generated glad loader
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Compiles and links a program without querying any status, so the driver is free
+// to do the work on its own threads. Errors are only checked in finish(), which the
+// shader classes call the first time the program is used; that is the only place
+// a caller can stall on the compiler.
+class ProgramBuild
+{
+public:
+    ProgramBuild() = default;
+    ProgramBuild(const ProgramBuild&) = delete;
+    ProgramBuild& operator=(const ProgramBuild&) = delete;
+
+    ProgramBuild(ProgramBuild&& other) noexcept
+        : program(other.program), stages(std::move(other.stages)), pending(other.pending)
+    {
+        other.stages.clear();
+        other.pending = false;
+    }
+
+    // a build that never finished still owns its compiled stages
+    ~ProgramBuild()
+    {
+        releaseStages();
+    }
+
+    ProgramBuild& operator=(ProgramBuild&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        releaseStages();
+        program = other.program;
+        stages = std::move(other.stages);
+        pending = other.pending;
+        other.stages.clear();
+        other.pending = false;
+        return *this;
+    }
+
+    // enables GL_KHR_parallel_shader_compile (or the ARB variant) when the driver has it;
+    // call once after gladLoadGLLoader with the same loader
+    // ------------------------------------------------------------------------
+    static void enableParallelCompile(GLADloadproc load)
+    {
+        typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+        PFNGLMAXSHADERCOMPILERTHREADSPROC maxShaderCompilerThreads = nullptr;
+
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount && !maxShaderCompilerThreads; i++)
+        {
+            const std::string extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension == "GL_KHR_parallel_shader_compile")
+                maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsKHR");
+            else if (extension == "GL_ARB_parallel_shader_compile")
+                maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsARB");
+        }
+
+        if (maxShaderCompilerThreads)
+        {
+            // let the driver pick the number of threads
+            maxShaderCompilerThreads(0xFFFFFFFF);
+            parallelCompile() = true;
+        }
+    }
+
+    static bool isParallelCompileEnabled()
+    {
+        return parallelCompile();
+    }
+
+    // compiles one stage; the compile status is not queried here
+    // ------------------------------------------------------------------------
+    void addStage(GLenum type, const std::string& code, const char* typeName)
+    {
+        const char* shaderCode = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &shaderCode, NULL);
+        glCompileShader(shader);
+        stages.push_back({ shader, typeName });
+    }
+
+    // attaches all stages and starts linking, returns the program ID right away
+    // ------------------------------------------------------------------------
+    unsigned int link()
+    {
+        program = glCreateProgram();
+        for (const Stage& stage : stages)
+            glAttachShader(program, stage.shader);
+        // allow the linked binary to be read back for an on-disk program cache
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+        pending = true;
+        return program;
+    }
+
+    bool isPending() const
+    {
+        return pending;
+    }
+
+    // true once finish() would not block; without parallel compile support this
+    // cannot be known, so it reports ready and the work happens in finish()
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        if (!pending || !parallelCompile())
+            return true;
+
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+
+    // waits for the link to complete, reports errors and releases the stages
+    // ------------------------------------------------------------------------
+    bool finish()
+    {
+        if (!pending)
+            return true;
+
+        for (const Stage& stage : stages)
+            checkCompileErrors(stage.shader, stage.type);
+        const bool linked = checkCompileErrors(program, "PROGRAM");
+
+        // delete the shaders as they're linked into our program now and no longer necessary
+        releaseStages();
+        pending = false;
+        return linked;
+    }
+
+private:
+    struct Stage
+    {
+        unsigned int shader;
+        std::string type;
+    };
+
+    unsigned int program = 0;
+    std::vector<Stage> stages;
+    bool pending = false;
+
+    void releaseStages()
+    {
+        for (const Stage& stage : stages)
+            glDeleteShader(stage.shader);
+        stages.clear();
+    }
+
+    static bool& parallelCompile()
+    {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    // utility function for checking shader compilation/linking errors.
+    // ------------------------------------------------------------------------
+    static bool checkCompileErrors(GLuint shader, const std::string& type)
+    {
+        GLint success;
+        GLchar infoLog[1024];
+        if (type != "PROGRAM")
+        {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        else
+        {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        return success;
+    }
+};
+#endif
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/shader_build.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -13,7 +15,8 @@ class ComputeShader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor submits the shader to the driver; compiling and linking finish
+    // in the background (where supported) until the program is first used
     // ------------------------------------------------------------------------
     ComputeShader(const char* computePath)
     {
@@ -39,27 +42,29 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        const char* cShaderCode = computeCode.c_str();
-        // 2. compile shaders
-        unsigned int compute;
-        // compute shader
-        compute = glCreateShader(GL_COMPUTE_SHADER);
-        glShaderSource(compute, 1, &cShaderCode, NULL);
-        glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
-        
+        // 2. submit shader, compile/link status is only checked on first use
+        build.addStage(GL_COMPUTE_SHADER, computeCode, "COMPUTE");
         // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, compute);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(compute);
+        ID = build.link();
+    }
+    // true when the program can be used without waiting for the compiler
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        return build.isReady();
+    }
+    // waits for the program to be linked and reports compile/link errors
+    // ------------------------------------------------------------------------
+    bool finishBuild()
+    {
+        return build.finish();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
+        if (build.isPending())
+            build.finish();
         glUseProgram(ID); 
     }
     // utility uniform functions
@@ -122,30 +127,6 @@ public:
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
-    // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
-    {
-        GLint success;
-        GLchar infoLog[1024];
-        if(type != "PROGRAM")
-        {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if(!success)
-            {
-                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-        else
-        {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if(!success)
-            {
-                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-    }
+    ProgramBuild build;
 };
 #endif
\ No newline at end of file
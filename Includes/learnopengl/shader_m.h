@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/shader_build.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -13,67 +15,76 @@ class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor submits the shader to the driver; compiling and linking finish
+    // in the background (where supported) until the program is first used
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
         // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+        std::string vertexCode = readFile(vertexPath);
+        std::string fragmentCode = readFile(fragmentPath);
+        // 2. compile shaders
+        compile(vertexCode, fragmentCode);
+    }
+    // generates the shader from source code already in memory (e.g. with injected #defines)
+    // ------------------------------------------------------------------------
+    static Shader fromSource(const std::string& vertexCode, const std::string& fragmentCode)
+    {
+        Shader shader;
+        shader.compile(vertexCode, fragmentCode);
+        return shader;
+    }
+    // wraps an already linked program (e.g. one restored with glProgramBinary)
+    // ------------------------------------------------------------------------
+    static Shader fromProgram(unsigned int program)
+    {
+        Shader shader;
+        shader.ID = program;
+        return shader;
+    }
+    // reads the whole shader file into a string
+    // ------------------------------------------------------------------------
+    static std::string readFile(const char* path)
+    {
+        std::ifstream shaderFile;
         // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        shaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
         try 
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
+            // open file
+            shaderFile.open(path);
+            std::stringstream shaderStream;
+            // read file's buffer contents into stream
+            shaderStream << shaderFile.rdbuf();
+            // close file handler
+            shaderFile.close();
             // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
+            return shaderStream.str();
         }
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
+        return std::string();
+    }
+    // true when the program can be used without waiting for the compiler
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        return build.isReady();
+    }
+    // waits for the program to be linked and reports compile/link errors
+    // ------------------------------------------------------------------------
+    bool finishBuild() const
+    {
+        return build.finish();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     { 
+        if (build.isPending())
+            build.finish();
         glUseProgram(ID); 
     }
     // utility uniform functions
@@ -136,30 +147,17 @@ public:
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    Shader() = default;
+
+    mutable ProgramBuild build;
+
+    // submits the given vertex/fragment source code, linking into ID
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    void compile(const std::string& vertexCode, const std::string& fragmentCode)
     {
-        GLint success;
-        GLchar infoLog[1024];
-        if (type != "PROGRAM")
-        {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-        else
-        {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if (!success)
-            {
-                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
+        build.addStage(GL_VERTEX_SHADER, vertexCode, "VERTEX");
+        build.addStage(GL_FRAGMENT_SHADER, fragmentCode, "FRAGMENT");
+        ID = build.link();
     }
 };
 #endif
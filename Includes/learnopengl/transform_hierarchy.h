@@ -0,0 +1,396 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <learnopengl/transform_kernels.h>
+
+// translation * rotation * scale with the rotation Y * X * Z of Euler angles in
+// degrees, written out instead of multiplying five 4x4 matrices
+inline glm::mat4 composeTransform(const glm::vec3& position, const glm::vec3& eulerRotation, const glm::vec3& scale)
+{
+	const glm::vec3 radians = glm::radians(eulerRotation);
+	const float sx = std::sin(radians.x), cx = std::cos(radians.x);
+	const float sy = std::sin(radians.y), cy = std::cos(radians.y);
+	const float sz = std::sin(radians.z), cz = std::cos(radians.z);
+
+	glm::mat4 matrix;
+	matrix[0] = glm::vec4(cy * cz + sy * sx * sz, cx * sz, cy * sx * sz - sy * cz, 0.0f) * scale.x;
+	matrix[1] = glm::vec4(sy * sx * cz - cy * sz, cx * cz, sy * sz + cy * sx * cz, 0.0f) * scale.y;
+	matrix[2] = glm::vec4(sy * cx, -sx, cy * cx, 0.0f) * scale.z;
+	matrix[3] = glm::vec4(position, 1.0f);
+	return matrix;
+}
+
+// Transforms of a node hierarchy in flat arrays, one per component, in depth
+// first order: every parent comes before its children and every subtree is a
+// contiguous range. Setting a local transform marks the node dirty; update()
+// only walks the subtrees of dirty nodes, front to back, so a parent's world
+// matrix is final when its children are reached. World bounds are refit for
+// the same nodes, every other node keeps its cached matrix and bounds. Nodes
+// are addressed by handles that stay valid while the arrays are reordered.
+class TransformHierarchy
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle none = UINT32_MAX;
+
+	// appends a node with identity transform; parent must be a valid handle or none
+	Handle create(Handle parent = none)
+	{
+		Handle handle;
+		if (!freeHandles.empty())
+		{
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else
+		{
+			handle = static_cast<Handle>(indices.size());
+			indices.push_back(noIndex);
+		}
+
+		const uint32_t index = static_cast<uint32_t>(parents.size());
+		const uint32_t parentIndex = parent == none ? noIndex : indices[parent];
+		// appending keeps the order when the parent's subtree ends at the back;
+		// otherwise the next update sorts
+		if (!sorted || (parentIndex != noIndex && parentIndex + subtreeSizes[parentIndex] != index))
+			sorted = false;
+		else
+		{
+			for (uint32_t ancestor = parentIndex; ancestor != noIndex; ancestor = parents[ancestor])
+				subtreeSizes[ancestor]++;
+		}
+
+		indices[handle] = index;
+		parents.push_back(parentIndex);
+		subtreeSizes.push_back(1);
+		positions.push_back(glm::vec3(0.0f));
+		rotations.push_back(glm::vec3(0.0f));
+		scales.push_back(glm::vec3(1.0f));
+		localMatrices.push_back(glm::mat4(1.0f));
+		worldMatrices.push_back(glm::mat4(1.0f));
+		localBounds.push_back(BoxBounds());
+		worldBounds.push_back(BoxBounds());
+		dirty.push_back(0);
+		handles.push_back(handle);
+		markDirty(index);
+		return handle;
+	}
+
+	// removes the node and all of its descendants
+	void destroy(Handle node)
+	{
+		sort();
+
+		const uint32_t first = indices[node];
+		const uint32_t count = subtreeSizes[first];
+		for (uint32_t ancestor = parents[first]; ancestor != noIndex; ancestor = parents[ancestor])
+			subtreeSizes[ancestor] -= count;
+
+		std::vector<uint32_t> order;
+		order.reserve(parents.size() - count);
+		for (uint32_t i = 0; i < parents.size(); i++)
+		{
+			if (i >= first && i < first + count)
+			{
+				indices[handles[i]] = noIndex;
+				freeHandles.push_back(handles[i]);
+			}
+			else
+				order.push_back(i);
+		}
+		reorder(order);
+	}
+
+	// moves the node with its subtree under parent (or to the roots with none);
+	// returns false and changes nothing when parent is the node or one of its descendants
+	bool setParent(Handle node, Handle parent)
+	{
+		const uint32_t index = indices[node];
+		const uint32_t parentIndex = parent == none ? noIndex : indices[parent];
+		for (uint32_t ancestor = parentIndex; ancestor != noIndex; ancestor = parents[ancestor])
+		{
+			if (ancestor == index)
+				return false;
+		}
+		if (parents[index] == parentIndex)
+			return true;
+
+		parents[index] = parentIndex;
+		// the subtree has to move next to its new parent, the next update sorts
+		sorted = false;
+		markDirty(index);
+		return true;
+	}
+
+	Handle getParent(Handle node) const
+	{
+		const uint32_t parent = parents[indices[node]];
+		return parent == noIndex ? none : handles[parent];
+	}
+
+	bool contains(Handle node) const
+	{
+		return node < indices.size() && indices[node] != noIndex;
+	}
+
+	size_t size() const
+	{
+		return parents.size();
+	}
+
+	void setLocalPosition(Handle node, const glm::vec3& position)
+	{
+		const uint32_t index = indices[node];
+		positions[index] = position;
+		markDirty(index);
+	}
+
+	// Euler angles in degrees, applied Y * X * Z
+	void setLocalRotation(Handle node, const glm::vec3& rotation)
+	{
+		const uint32_t index = indices[node];
+		rotations[index] = rotation;
+		markDirty(index);
+	}
+
+	void setLocalScale(Handle node, const glm::vec3& scale)
+	{
+		const uint32_t index = indices[node];
+		scales[index] = scale;
+		markDirty(index);
+	}
+
+	// bounds in the node's own space, e.g. of its model
+	void setLocalBounds(Handle node, const BoxBounds& bounds)
+	{
+		const uint32_t index = indices[node];
+		localBounds[index] = bounds;
+		markDirty(index);
+	}
+
+	const glm::vec3& getLocalPosition(Handle node) const
+	{
+		return positions[indices[node]];
+	}
+
+	const glm::vec3& getLocalRotation(Handle node) const
+	{
+		return rotations[indices[node]];
+	}
+
+	const glm::vec3& getLocalScale(Handle node) const
+	{
+		return scales[indices[node]];
+	}
+
+	// as of the last update
+	const glm::mat4& getWorldMatrix(Handle node) const
+	{
+		return worldMatrices[indices[node]];
+	}
+
+	// local bounds transformed to world space, as of the last update
+	const BoxBounds& getWorldBounds(Handle node) const
+	{
+		return worldBounds[indices[node]];
+	}
+
+	// all world matrices in hierarchy order, as of the last update
+	const std::vector<glm::mat4>& getWorldMatrices() const
+	{
+		return worldMatrices;
+	}
+
+	// nodes whose world matrix the last update recomputed
+	size_t getUpdatedCount() const
+	{
+		return updatedCount;
+	}
+
+	// recomputes the world matrices and bounds of the dirty nodes and their descendants
+	void update()
+	{
+		sort();
+		updatedCount = 0;
+		if (dirtyNodes.empty())
+			return;
+
+		// dirty nodes in hierarchy order; a node inside an earlier dirty subtree is covered by it
+		std::vector<uint32_t> changed;
+		changed.reserve(dirtyNodes.size());
+		for (Handle handle : dirtyNodes)
+		{
+			if (contains(handle) && dirty[indices[handle]])
+				changed.push_back(indices[handle]);
+		}
+		dirtyNodes.clear();
+		std::sort(changed.begin(), changed.end());
+
+		uint32_t end = 0;
+		for (uint32_t first : changed)
+		{
+			if (first < end)
+				continue;
+			end = first + subtreeSizes[first];
+			updateRange(first, end);
+			updatedCount += end - first;
+		}
+	}
+
+private:
+	static constexpr uint32_t noIndex = UINT32_MAX;
+
+	// per node, in hierarchy order
+	std::vector<uint32_t> parents;
+	// the node and all of its descendants
+	std::vector<uint32_t> subtreeSizes;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<BoxBounds> localBounds;
+	std::vector<BoxBounds> worldBounds;
+	// the local transform or bounds changed since the last update
+	std::vector<uint8_t> dirty;
+	std::vector<Handle> handles;
+
+	// per handle
+	std::vector<uint32_t> indices;
+	std::vector<Handle> freeHandles;
+
+	// nodes marked dirty since the last update, by handle so sorting does not invalidate them
+	std::vector<Handle> dirtyNodes;
+	size_t updatedCount = 0;
+
+	// nodes are in depth first order and subtreeSizes is valid
+	bool sorted = true;
+
+	void markDirty(uint32_t index)
+	{
+		if (dirty[index])
+			return;
+		dirty[index] = 1;
+		dirtyNodes.push_back(handles[index]);
+	}
+
+	// front to back through one subtree: only dirty nodes compose their local
+	// matrix again, every node takes its parent's new world matrix, then the
+	// bounds of the whole range are refit
+	void updateRange(uint32_t first, uint32_t end)
+	{
+		const uint32_t* parent = parents.data();
+		glm::mat4* local = localMatrices.data();
+		glm::mat4* world = worldMatrices.data();
+
+		for (uint32_t i = first; i < end; i++)
+		{
+			if (dirty[i])
+			{
+				local[i] = composeTransform(positions[i], rotations[i], scales[i]);
+				dirty[i] = 0;
+			}
+			world[i] = parent[i] == noIndex ? local[i] : multiplyAffine(world[parent[i]], local[i]);
+		}
+		// the bounds do not depend on each other, so they are refit in one batch
+		transformBounds(world + first, localBounds.data() + first, worldBounds.data() + first, end - first);
+	}
+
+	// restores depth first order after setParent or create, and the subtree sizes
+	void sort()
+	{
+		if (sorted)
+			return;
+		sorted = true;
+
+		const uint32_t count = static_cast<uint32_t>(parents.size());
+		std::vector<uint32_t> childStart(count + 1, 0);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (parents[i] != noIndex)
+				childStart[parents[i] + 1]++;
+		}
+		for (uint32_t i = 0; i < count; i++)
+			childStart[i + 1] += childStart[i];
+
+		std::vector<uint32_t> children(childStart[count]);
+		std::vector<uint32_t> childEnd(childStart.begin(), childStart.end() - 1);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (parents[i] != noIndex)
+				children[childEnd[parents[i]]++] = i;
+		}
+
+		std::vector<uint32_t> order;
+		order.reserve(count);
+		std::vector<uint32_t> stack;
+		for (uint32_t root = 0; root < count; root++)
+		{
+			if (parents[root] != noIndex)
+				continue;
+			stack.push_back(root);
+			while (!stack.empty())
+			{
+				const uint32_t node = stack.back();
+				stack.pop_back();
+				order.push_back(node);
+				for (uint32_t child = childStart[node + 1]; child > childStart[node]; child--)
+					stack.push_back(children[child - 1]);
+			}
+		}
+		reorder(order);
+
+		// children come after their parent, so back to front every subtree is complete when it is added
+		std::fill(subtreeSizes.begin(), subtreeSizes.end(), 1);
+		for (uint32_t i = count; i-- > 0;)
+		{
+			if (parents[i] != noIndex)
+				subtreeSizes[parents[i]] += subtreeSizes[i];
+		}
+	}
+
+	// keeps the nodes listed in order, in that order
+	void reorder(const std::vector<uint32_t>& order)
+	{
+		std::vector<uint32_t> newIndex(parents.size(), noIndex);
+		for (uint32_t i = 0; i < order.size(); i++)
+			newIndex[order[i]] = i;
+
+		auto permute = [&order](auto& values)
+			{
+				std::remove_reference_t<decltype(values)> permuted;
+				permuted.reserve(order.size());
+				for (uint32_t i : order)
+					permuted.push_back(values[i]);
+				values = std::move(permuted);
+			};
+		permute(parents);
+		permute(subtreeSizes);
+		permute(positions);
+		permute(rotations);
+		permute(scales);
+		permute(localMatrices);
+		permute(worldMatrices);
+		permute(localBounds);
+		permute(worldBounds);
+		permute(dirty);
+		permute(handles);
+
+		for (uint32_t i = 0; i < parents.size(); i++)
+		{
+			if (parents[i] != noIndex)
+				parents[i] = newIndex[parents[i]];
+			indices[handles[i]] = i;
+		}
+	}
+};
+#endif
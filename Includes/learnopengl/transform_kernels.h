@@ -0,0 +1,425 @@
+#ifndef TRANSFORM_KERNELS_H
+#define TRANSFORM_KERNELS_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+
+// Math on arrays of matrices and boxes. Each kernel has an SSE path, an AVX2 path
+// that handles two elements per instruction and a scalar fallback. The path is
+// picked at compile time: AVX2 needs /arch:AVX2 or -mavx2, every x64 target has
+// SSE2. The arrays hold plain glm types, so the kernels run directly on the
+// arrays of the transform hierarchy and the ECS. Unless noted otherwise, a
+// result array may be one of the input arrays.
+
+#if defined(__AVX2__)
+#define TRANSFORM_KERNELS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_KERNELS_SSE
+#endif
+
+#if defined(TRANSFORM_KERNELS_AVX2)
+#include <immintrin.h>
+#elif defined(TRANSFORM_KERNELS_SSE)
+#include <emmintrin.h>
+#endif
+
+// parent * local for affine matrices: the bottom row is (0, 0, 0, 1), so every
+// column is a linear combination of the parent's columns without their w terms
+inline glm::mat4 multiplyAffine(const glm::mat4& parent, const glm::mat4& local)
+{
+	glm::mat4 matrix;
+	for (int column = 0; column < 3; column++)
+		matrix[column] = parent[0] * local[column].x + parent[1] * local[column].y + parent[2] * local[column].z;
+	matrix[3] = parent[0] * local[3].x + parent[1] * local[3].y + parent[2] * local[3].z + parent[3];
+	return matrix;
+}
+
+// axis-aligned box as center and half extents
+struct BoxBounds
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::vec3 extents = glm::vec3(0.0f);
+};
+
+// the axis-aligned box around a box transformed by an affine matrix
+inline BoxBounds transformBounds(const glm::mat4& matrix, const BoxBounds& bounds)
+{
+	const glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+	return { glm::vec3(matrix * glm::vec4(bounds.center, 1.0f)), absolute * bounds.extents };
+}
+
+// the inverse transpose of the upper 3x3 of an affine matrix, which transforms
+// normals: its columns are the cross products of the other two columns divided
+// by the determinant, far cheaper than inverting the whole 4x4 matrix
+inline glm::mat3 normalMatrix(const glm::mat4& model)
+{
+	const glm::vec3 x = glm::vec3(model[0]);
+	const glm::vec3 y = glm::vec3(model[1]);
+	const glm::vec3 z = glm::vec3(model[2]);
+	const glm::vec3 yz = glm::cross(y, z);
+	return glm::mat3(yz, glm::cross(z, x), glm::cross(x, y)) * (1.0f / glm::dot(x, yz));
+}
+
+// normalMatrix for rotation and uniform scale s only, where it is the matrix divided by s^2
+inline glm::mat3 uniformScaleNormalMatrix(const glm::mat4& model)
+{
+	const glm::vec3 x = glm::vec3(model[0]);
+	return glm::mat3(model) * (1.0f / glm::dot(x, x));
+}
+
+// whether the upper 3x3 is a rotation or reflection times a uniform scale, i.e. its columns
+// are orthogonal and equally long, so that uniformScaleNormalMatrix applies
+inline bool hasUniformScale(const glm::mat4& model, float tolerance = 1e-5f)
+{
+	const glm::vec3 x = glm::vec3(model[0]);
+	const glm::vec3 y = glm::vec3(model[1]);
+	const glm::vec3 z = glm::vec3(model[2]);
+	const float xx = glm::dot(x, x);
+	const float limit = tolerance * xx;
+	return std::abs(glm::dot(y, y) - xx) <= limit && std::abs(glm::dot(z, z) - xx) <= limit
+		&& std::abs(glm::dot(x, y)) <= limit && std::abs(glm::dot(y, z)) <= limit && std::abs(glm::dot(z, x)) <= limit;
+}
+
+// normalMatrix, or uniformScaleNormalMatrix when the scale is uniform
+inline glm::mat3 selectNormalMatrix(const glm::mat4& model)
+{
+	return hasUniformScale(model) ? uniformScaleNormalMatrix(model) : normalMatrix(model);
+}
+
+#if defined(TRANSFORM_KERNELS_SSE)
+namespace transform_kernels_detail
+{
+	// The kernels below are written once for a register type: Sse holds one
+	// element per register, Avx two, one per 128-bit lane. Every shuffle stays
+	// inside its lane, so the same code works for both. Elements are stride
+	// floats apart.
+	struct Sse
+	{
+		using Register = __m128;
+		static constexpr size_t width = 1;
+
+		static Register load(const float* element, size_t)
+		{
+			return _mm_loadu_ps(element);
+		}
+
+		// the same four floats in every lane
+		static Register loadShared(const float* values)
+		{
+			return _mm_loadu_ps(values);
+		}
+
+		static Register broadcast(const float* element, size_t)
+		{
+			return _mm_set1_ps(*element);
+		}
+
+		static void store(float* element, size_t, Register value)
+		{
+			_mm_storeu_ps(element, value);
+		}
+
+		// x, y and z only, for the last vector of an element
+		static void store3(float* element, size_t, Register value)
+		{
+			_mm_storel_pi(reinterpret_cast<__m64*>(element), value);
+			_mm_store_ss(element + 2, _mm_movehl_ps(value, value));
+		}
+	};
+
+	inline __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+	inline __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+	inline __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+	inline __m128 div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+	inline __m128 abs(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	inline __m128 one(__m128) { return _mm_set1_ps(1.0f); }
+
+	template <int Mask>
+	__m128 shuffle(__m128 a)
+	{
+		return _mm_shuffle_ps(a, a, Mask);
+	}
+
+#if defined(TRANSFORM_KERNELS_AVX2)
+	struct Avx
+	{
+		using Register = __m256;
+		static constexpr size_t width = 2;
+
+		static Register load(const float* element, size_t stride)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(element)), _mm_loadu_ps(element + stride), 1);
+		}
+
+		static Register loadShared(const float* values)
+		{
+			const __m128 lane = _mm_loadu_ps(values);
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(lane), lane, 1);
+		}
+
+		static Register broadcast(const float* element, size_t stride)
+		{
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(*element)), _mm_set1_ps(element[stride]), 1);
+		}
+
+		static void store(float* element, size_t stride, Register value)
+		{
+			_mm_storeu_ps(element, _mm256_castps256_ps128(value));
+			_mm_storeu_ps(element + stride, _mm256_extractf128_ps(value, 1));
+		}
+
+		static void store3(float* element, size_t stride, Register value)
+		{
+			Sse::store3(element, stride, _mm256_castps256_ps128(value));
+			Sse::store3(element + stride, stride, _mm256_extractf128_ps(value, 1));
+		}
+	};
+
+	inline __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+	inline __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+	inline __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+	inline __m256 div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+	inline __m256 abs(__m256 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	inline __m256 one(__m256) { return _mm256_set1_ps(1.0f); }
+
+	template <int Mask>
+	__m256 shuffle(__m256 a)
+	{
+		return _mm256_shuffle_ps(a, a, Mask);
+	}
+#endif
+
+	constexpr int yzxw = _MM_SHUFFLE(3, 0, 2, 1);
+
+	// a x b as (a * b.yzx - a.yzx * b).yzx; w ends up 0
+	template <typename Register>
+	Register cross(Register a, Register b)
+	{
+		return shuffle<yzxw>(sub(mul(a, shuffle<yzxw>(b)), mul(shuffle<yzxw>(a), b)));
+	}
+
+	// the sum of all four components in every component
+	template <typename Register>
+	Register horizontalSum(Register a)
+	{
+		a = add(a, shuffle<_MM_SHUFFLE(2, 3, 0, 1)>(a));
+		return add(a, shuffle<_MM_SHUFFLE(1, 0, 3, 2)>(a));
+	}
+
+	// column * right column: the left columns weighted by the right column's components
+	template <typename Register>
+	Register transformColumn(Register left0, Register left1, Register left2, Register left3, Register column)
+	{
+		return add(add(mul(left0, shuffle<_MM_SHUFFLE(0, 0, 0, 0)>(column)), mul(left1, shuffle<_MM_SHUFFLE(1, 1, 1, 1)>(column))),
+			add(mul(left2, shuffle<_MM_SHUFFLE(2, 2, 2, 2)>(column)), mul(left3, shuffle<_MM_SHUFFLE(3, 3, 3, 3)>(column))));
+	}
+
+	// result = left * right for Lanes::width elements; all columns are loaded before anything is stored
+	template <typename Lanes>
+	void multiplyMatrices(const glm::mat4* left, const glm::mat4* right, glm::mat4* result)
+	{
+		using Register = typename Lanes::Register;
+		const float* l = &left[0][0][0];
+		const float* r = &right[0][0][0];
+		const Register l0 = Lanes::load(l, 16), l1 = Lanes::load(l + 4, 16), l2 = Lanes::load(l + 8, 16), l3 = Lanes::load(l + 12, 16);
+		const Register r0 = Lanes::load(r, 16), r1 = Lanes::load(r + 4, 16), r2 = Lanes::load(r + 8, 16), r3 = Lanes::load(r + 12, 16);
+
+		float* out = &result[0][0][0];
+		Lanes::store(out, 16, transformColumn(l0, l1, l2, l3, r0));
+		Lanes::store(out + 4, 16, transformColumn(l0, l1, l2, l3, r1));
+		Lanes::store(out + 8, 16, transformColumn(l0, l1, l2, l3, r2));
+		Lanes::store(out + 12, 16, transformColumn(l0, l1, l2, l3, r3));
+	}
+
+	// result = left * right with the same left for every element
+	template <typename Lanes>
+	void multiplyMatrices(const typename Lanes::Register (&left)[4], const glm::mat4* right, glm::mat4* result)
+	{
+		using Register = typename Lanes::Register;
+		const float* r = &right[0][0][0];
+		const Register r0 = Lanes::load(r, 16), r1 = Lanes::load(r + 4, 16), r2 = Lanes::load(r + 8, 16), r3 = Lanes::load(r + 12, 16);
+
+		float* out = &result[0][0][0];
+		Lanes::store(out, 16, transformColumn(left[0], left[1], left[2], left[3], r0));
+		Lanes::store(out + 4, 16, transformColumn(left[0], left[1], left[2], left[3], r1));
+		Lanes::store(out + 8, 16, transformColumn(left[0], left[1], left[2], left[3], r2));
+		Lanes::store(out + 12, 16, transformColumn(left[0], left[1], left[2], left[3], r3));
+	}
+
+	// the mat3 columns are 3 floats apart: each store spills into the next
+	// column, which is stored afterwards, and the last one stores only x, y and z
+	template <typename Lanes>
+	void storeMat3(glm::mat3* result, typename Lanes::Register x, typename Lanes::Register y, typename Lanes::Register z)
+	{
+		float* out = &result[0][0][0];
+		Lanes::store(out, 9, x);
+		Lanes::store(out + 3, 9, y);
+		Lanes::store3(out + 6, 9, z);
+	}
+
+	template <typename Lanes>
+	void normalMatrices(const glm::mat4* models, glm::mat3* result)
+	{
+		using Register = typename Lanes::Register;
+		const float* m = &models[0][0][0];
+		const Register x = Lanes::load(m, 16), y = Lanes::load(m + 4, 16), z = Lanes::load(m + 8, 16);
+		const Register yz = cross(y, z);
+		const Register inverseDeterminant = div(one(x), horizontalSum(mul(x, yz)));
+		storeMat3<Lanes>(result, mul(yz, inverseDeterminant), mul(cross(z, x), inverseDeterminant), mul(cross(x, y), inverseDeterminant));
+	}
+
+	template <typename Lanes>
+	void uniformScaleNormalMatrices(const glm::mat4* models, glm::mat3* result)
+	{
+		using Register = typename Lanes::Register;
+		const float* m = &models[0][0][0];
+		const Register x = Lanes::load(m, 16), y = Lanes::load(m + 4, 16), z = Lanes::load(m + 8, 16);
+		const Register inverseSquaredScale = div(one(x), horizontalSum(mul(x, x)));
+		storeMat3<Lanes>(result, mul(x, inverseSquaredScale), mul(y, inverseSquaredScale), mul(z, inverseSquaredScale));
+	}
+
+	// BoxBounds are 6 floats: the center store spills into the extents, which are stored afterwards
+	template <typename Lanes>
+	void transformBounds(const glm::mat4* matrices, const BoxBounds* bounds, BoxBounds* result)
+	{
+		using Register = typename Lanes::Register;
+		const float* m = &matrices[0][0][0];
+		const float* b = &bounds[0].center.x;
+		const Register m0 = Lanes::load(m, 16), m1 = Lanes::load(m + 4, 16), m2 = Lanes::load(m + 8, 16), m3 = Lanes::load(m + 12, 16);
+
+		const Register center = add(add(mul(m0, Lanes::broadcast(b, 6)), mul(m1, Lanes::broadcast(b + 1, 6))), add(mul(m2, Lanes::broadcast(b + 2, 6)), m3));
+		const Register extents = add(add(mul(abs(m0), Lanes::broadcast(b + 3, 6)), mul(abs(m1), Lanes::broadcast(b + 4, 6))), mul(abs(m2), Lanes::broadcast(b + 5, 6)));
+
+		float* out = &result[0].center.x;
+		Lanes::store(out, 6, center);
+		Lanes::store3(out + 3, 6, extents);
+	}
+}
+#endif
+
+// the instruction set the kernels were compiled for
+inline const char* getTransformKernelPath()
+{
+#if defined(TRANSFORM_KERNELS_AVX2)
+	return "AVX2";
+#elif defined(TRANSFORM_KERNELS_SSE)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+// result[i] = left[i] * right[i]
+inline void multiplyMatrices(const glm::mat4* left, const glm::mat4* right, glm::mat4* result, size_t count)
+{
+	size_t i = 0;
+#if defined(TRANSFORM_KERNELS_AVX2)
+	for (; i + 2 <= count; i += 2)
+		transform_kernels_detail::multiplyMatrices<transform_kernels_detail::Avx>(left + i, right + i, result + i);
+#endif
+#if defined(TRANSFORM_KERNELS_SSE)
+	for (; i < count; i++)
+		transform_kernels_detail::multiplyMatrices<transform_kernels_detail::Sse>(left + i, right + i, result + i);
+#else
+	for (; i < count; i++)
+		result[i] = left[i] * right[i];
+#endif
+}
+
+// result[i] = left * right[i], e.g. one view projection applied to many model matrices
+inline void multiplyMatrices(const glm::mat4& left, const glm::mat4* right, glm::mat4* result, size_t count)
+{
+	size_t i = 0;
+#if defined(TRANSFORM_KERNELS_AVX2)
+	using transform_kernels_detail::Avx;
+	const Avx::Register wideLeft[4] = { Avx::loadShared(&left[0][0]), Avx::loadShared(&left[1][0]), Avx::loadShared(&left[2][0]), Avx::loadShared(&left[3][0]) };
+	for (; i + 2 <= count; i += 2)
+		transform_kernels_detail::multiplyMatrices<Avx>(wideLeft, right + i, result + i);
+#endif
+#if defined(TRANSFORM_KERNELS_SSE)
+	using transform_kernels_detail::Sse;
+	const Sse::Register narrowLeft[4] = { Sse::loadShared(&left[0][0]), Sse::loadShared(&left[1][0]), Sse::loadShared(&left[2][0]), Sse::loadShared(&left[3][0]) };
+	for (; i < count; i++)
+		transform_kernels_detail::multiplyMatrices<Sse>(narrowLeft, right + i, result + i);
+#else
+	const glm::mat4 shared = left;
+	for (; i < count; i++)
+		result[i] = shared * right[i];
+#endif
+}
+
+// result[i] = normalMatrix(models[i])
+inline void normalMatrices(const glm::mat4* models, glm::mat3* result, size_t count)
+{
+	size_t i = 0;
+#if defined(TRANSFORM_KERNELS_AVX2)
+	for (; i + 2 <= count; i += 2)
+		transform_kernels_detail::normalMatrices<transform_kernels_detail::Avx>(models + i, result + i);
+#endif
+#if defined(TRANSFORM_KERNELS_SSE)
+	for (; i < count; i++)
+		transform_kernels_detail::normalMatrices<transform_kernels_detail::Sse>(models + i, result + i);
+#else
+	for (; i < count; i++)
+		result[i] = normalMatrix(models[i]);
+#endif
+}
+
+// result[i] = uniformScaleNormalMatrix(models[i]), for models known to have no non-uniform scale
+inline void uniformScaleNormalMatrices(const glm::mat4* models, glm::mat3* result, size_t count)
+{
+	size_t i = 0;
+#if defined(TRANSFORM_KERNELS_AVX2)
+	for (; i + 2 <= count; i += 2)
+		transform_kernels_detail::uniformScaleNormalMatrices<transform_kernels_detail::Avx>(models + i, result + i);
+#endif
+#if defined(TRANSFORM_KERNELS_SSE)
+	for (; i < count; i++)
+		transform_kernels_detail::uniformScaleNormalMatrices<transform_kernels_detail::Sse>(models + i, result + i);
+#else
+	for (; i < count; i++)
+		result[i] = uniformScaleNormalMatrix(models[i]);
+#endif
+}
+
+// result[i] = selectNormalMatrix(models[i]): runs of models with uniform scale go through
+// uniformScaleNormalMatrices, the others through normalMatrices
+inline void selectNormalMatrices(const glm::mat4* models, glm::mat3* result, size_t count)
+{
+	size_t first = 0;
+	bool uniform = count > 0 && hasUniformScale(models[0]);
+	while (first < count)
+	{
+		size_t end = first + 1;
+		bool next = false;
+		while (end < count && (next = hasUniformScale(models[end])) == uniform)
+			end++;
+		if (uniform)
+			uniformScaleNormalMatrices(models + first, result + first, end - first);
+		else
+			normalMatrices(models + first, result + first, end - first);
+		first = end;
+		uniform = next;
+	}
+}
+
+// result[i] = transformBounds(matrices[i], bounds[i])
+inline void transformBounds(const glm::mat4* matrices, const BoxBounds* bounds, BoxBounds* result, size_t count)
+{
+	size_t i = 0;
+#if defined(TRANSFORM_KERNELS_AVX2)
+	for (; i + 2 <= count; i += 2)
+		transform_kernels_detail::transformBounds<transform_kernels_detail::Avx>(matrices + i, bounds + i, result + i);
+#endif
+#if defined(TRANSFORM_KERNELS_SSE)
+	for (; i < count; i++)
+		transform_kernels_detail::transformBounds<transform_kernels_detail::Sse>(matrices + i, bounds + i, result + i);
+#else
+	for (; i < count; i++)
+		result[i] = transformBounds(matrices[i], bounds[i]);
+#endif
+}
+#endif
@@ -0,0 +1,153 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+// center of the last rendered texel; samples past it would read stale pixels
+uniform vec2 uvMax;
+
+// Fast approximate anti-aliasing after FXAA 3.11 by Timothy Lottes: find
+// edges from luma contrast, walk along them to their ends and blend across
+// them by the distance to the nearer end, plus a subpixel blend for single
+// pixel features.
+
+// minimum contrast to process, absolute and relative to the local maximum
+#define EDGE_THRESHOLD_MIN 0.0312
+#define EDGE_THRESHOLD_MAX 0.125
+// amount of subpixel aliasing removal, 0 = off, 1 = softest
+#define SUBPIXEL_QUALITY 0.75
+#define ITERATIONS 12
+
+const float STEP[ITERATIONS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+vec3 sampleColor(vec2 uv)
+{
+    return textureLod(screenTexture, min(uv, uvMax), 0.0).rgb;
+}
+
+// the target holds display colors already, so no gamma conversion is needed
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+float sampleLuma(vec2 uv)
+{
+    return luma(sampleColor(uv));
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(screenTexture, 0));
+
+    vec3 colorCenter = sampleColor(TexCoords);
+    float lumaCenter = luma(colorCenter);
+    float lumaDown = sampleLuma(TexCoords + vec2(0.0, -texel.y));
+    float lumaUp = sampleLuma(TexCoords + vec2(0.0, texel.y));
+    float lumaLeft = sampleLuma(TexCoords + vec2(-texel.x, 0.0));
+    float lumaRight = sampleLuma(TexCoords + vec2(texel.x, 0.0));
+
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+
+    // flat area, nothing to smooth
+    if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX))
+    {
+        FragColor = vec4(colorCenter, 1.0);
+        return;
+    }
+
+    float lumaDownLeft = sampleLuma(TexCoords - texel);
+    float lumaUpRight = sampleLuma(TexCoords + texel);
+    float lumaUpLeft = sampleLuma(TexCoords + vec2(-texel.x, texel.y));
+    float lumaDownRight = sampleLuma(TexCoords + vec2(texel.x, -texel.y));
+
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+    // edge orientation from the second derivatives in both directions
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + 2.0 * abs(-2.0 * lumaCenter + lumaDownUp) + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + 2.0 * abs(-2.0 * lumaCenter + lumaLeftRight) + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    // which side of the pixel the edge lies on
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+    float stepLength = isHorizontal ? texel.y : texel.x;
+    float lumaLocalAverage;
+    if (is1Steepest)
+    {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    }
+    else
+        lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+
+    // walk along the edge, half a pixel off the center, in both directions
+    vec2 edgeUv = TexCoords;
+    if (isHorizontal)
+        edgeUv.y += 0.5 * stepLength;
+    else
+        edgeUv.x += 0.5 * stepLength;
+
+    vec2 offset = isHorizontal ? vec2(texel.x, 0.0) : vec2(0.0, texel.y);
+    vec2 uv1 = edgeUv - offset * STEP[0];
+    vec2 uv2 = edgeUv + offset * STEP[0];
+
+    float lumaEnd1 = sampleLuma(uv1) - lumaLocalAverage;
+    float lumaEnd2 = sampleLuma(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+
+    for (int i = 1; i < ITERATIONS && !(reached1 && reached2); i++)
+    {
+        if (!reached1)
+        {
+            uv1 -= offset * STEP[i];
+            lumaEnd1 = sampleLuma(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2)
+        {
+            uv2 += offset * STEP[i];
+            lumaEnd2 = sampleLuma(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    float distance1 = isHorizontal ? TexCoords.x - uv1.x : TexCoords.y - uv1.y;
+    float distance2 = isHorizontal ? uv2.x - TexCoords.x : uv2.y - TexCoords.y;
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeLength = distance1 + distance2;
+
+    // only blend when the luma at the nearer end varies in the same way as at the center
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float pixelOffset = correctVariation ? 0.5 - distanceFinal / edgeLength : 0.0;
+
+    // subpixel blend from the contrast to the 3x3 neighborhood
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixel = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+    subPixel = (-2.0 * subPixel + 3.0) * subPixel * subPixel;
+    pixelOffset = max(pixelOffset, subPixel * subPixel * SUBPIXEL_QUALITY);
+
+    vec2 finalUv = TexCoords;
+    if (isHorizontal)
+        finalUv.y += pixelOffset * stepLength;
+    else
+        finalUv.x += pixelOffset * stepLength;
+
+    FragColor = vec4(sampleColor(finalUv), 1.0);
+}
@@ -0,0 +1,13 @@
+#version 460 core
+out vec2 TexCoords;
+
+// part of the texture that holds the rendered image, see RenderTarget::bind
+uniform vec2 uvScale;
+
+// one triangle covering the screen, no vertex buffer needed
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = position * uvScale;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -46,18 +46,32 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
+// permutation defines (injected by ShaderPermutations):
+// USE_BLINN - Blinn-Phong instead of Phong specular
+// IS_DAY    - directional light enabled
+// USE_FOG   - fog enabled
+#ifndef NR_POINT_LIGHTS
 #define NR_POINT_LIGHTS 1
+#endif
+#ifndef NR_SPOT_LIGHTS
 #define NR_SPOT_LIGHTS 1
+#endif
 
 uniform vec3 viewPos;
+#ifdef IS_DAY
 uniform DirLight dirLight;
+#endif
+#if NR_POINT_LIGHTS > 0
 uniform PointLight pointLights[NR_POINT_LIGHTS];
+#endif
+#if NR_SPOT_LIGHTS > 0
 uniform SpotLight spotLights[NR_SPOT_LIGHTS];
+#endif
 
-uniform bool useBlinn;
-uniform bool isDay;
+#ifdef USE_FOG
 uniform float fogIntensity;
 uniform vec3 fogColor;
+#endif
 
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
@@ -69,7 +83,9 @@ uniform sampler2D texture_shininess1;
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+#ifdef USE_FOG
 float CalcFogFactor(vec3 worldPos);
+#endif
 
 float CalcShininessExponent(vec3 color);
 float CalcBlinnShininessExponent(vec3 color);
@@ -94,20 +110,27 @@ void main()
     vec3 result = texture(texture_ambient1, TexCoords).rgb + texture(texture_emissive1, TexCoords).rgb;
 
     // directional light
-    if(isDay)
-        result += CalcDirLight(dirLight, norm, viewDir);
+#ifdef IS_DAY
+    result += CalcDirLight(dirLight, norm, viewDir);
+#endif
 
     // point lights
+#if NR_POINT_LIGHTS > 0
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
 		result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+#endif
 
     // spot light
+#if NR_SPOT_LIGHTS > 0
 	for(int i = 0; i < NR_SPOT_LIGHTS; i++)
         result += CalcSpotLight(spotLights[i], norm, FragPos, viewDir);
+#endif
 
 
+#ifdef USE_FOG
     float fogFactor = CalcFogFactor(FragPos);
     result = mix(fogColor, result, fogFactor);
+#endif
 
     result = clamp(result, 0.0, 1.0);
 	FragColor = vec4(result, 1.0);
@@ -165,17 +188,16 @@ float CalcBlinnShininessExponent(vec3 color)
     return 4.0 * CalcShininessExponent(color);
 }
 
+#ifdef USE_FOG
 float CalcFogFactor(vec3 worldPos)
 {
-    if(fogIntensity == 0.0)
-    	return 1;
-
     float gradient = ((fogIntensity - 50) * fogIntensity + 60);
     float dist = distance(worldPos, viewPos);
 
     float fog = exp(-pow(dist / gradient, 4.0));
     return clamp(fog, 0.0, 1.0);
 }
+#endif
 
 
 float CalcDiff(vec3 normal, vec3 lightDir)
@@ -191,20 +213,17 @@ float CalcSpec(vec3 normal, vec3 lightDir, vec3 viewDir)
     vec3 v1, v2;
     float shininess;
 
-    if(useBlinn)
-    {
-        vec3 halfwayDir = normalize(lightDir + viewDir);
-        shininess = CalcBlinnShininessExponent(shininess_texture);
-        v1 = normal;
-        v2 = halfwayDir;
-    }
-    else
-	{
-		vec3 reflectDir = reflect(-lightDir, normal);
-        shininess = CalcShininessExponent(shininess_texture);
-        v1 = viewDir;
-        v2 = reflectDir;
-	}
+#ifdef USE_BLINN
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    shininess = CalcBlinnShininessExponent(shininess_texture);
+    v1 = normal;
+    v2 = halfwayDir;
+#else
+    vec3 reflectDir = reflect(-lightDir, normal);
+    shininess = CalcShininessExponent(shininess_texture);
+    v1 = viewDir;
+    v2 = reflectDir;
+#endif
 
     return pow(max(dot(v1, v2), 0.0), shininess);
 }
@@ -0,0 +1,13 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec4 Color;
+
+// single channel glyph coverage
+uniform sampler2D atlas;
+
+void main()
+{
+    FragColor = vec4(Color.rgb, Color.a * texture(atlas, TexCoords).r);
+}
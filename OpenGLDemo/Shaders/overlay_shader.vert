@@ -0,0 +1,18 @@
+#version 460 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoords;
+out vec4 Color;
+
+// positions are in pixels from the top left corner
+uniform vec2 screenSize;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    Color = aColor;
+    vec2 position = aPos / screenSize * 2.0 - 1.0;
+    gl_Position = vec4(position.x, -position.y, 0.0, 1.0);
+}
@@ -3,11 +3,18 @@ out vec4 FragColor;
 
 in vec3 TexCoords;
 
-uniform samplerCube skybox;
-uniform bool isFoggy;
+// USE_FOG is injected by ShaderPermutations
+#ifdef USE_FOG
 uniform vec3 fogColor;
+#else
+uniform samplerCube skybox;
+#endif
 
 void main()
 {    
-    FragColor = isFoggy ? vec4(fogColor, 1.0) : texture(skybox, TexCoords);
+#ifdef USE_FOG
+    FragColor = vec4(fogColor, 1.0);
+#else
+    FragColor = texture(skybox, TexCoords);
+#endif
 }
\ No newline at end of file
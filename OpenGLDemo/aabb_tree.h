@@ -0,0 +1,490 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// axis-aligned box by its corners; the default box is empty
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+	static BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+	{
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	bool contains(const BoundingBox& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+	}
+
+	bool overlaps(const BoundingBox& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+	}
+
+	// surface area, the cost measure of the surface area heuristic
+	float area() const
+	{
+		const glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	BoundingBox expanded(float margin) const
+	{
+		return { min - glm::vec3(margin), max + glm::vec3(margin) };
+	}
+
+	// the box around this box transformed by an affine matrix
+	BoundingBox transformed(const glm::mat4& matrix) const
+	{
+		const glm::vec3 center = glm::vec3(matrix * glm::vec4((min + max) * 0.5f, 1.0f));
+		const glm::vec3 extents = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2]))) * ((max - min) * 0.5f);
+		return { center - extents, center + extents };
+	}
+};
+
+// the six planes of a view-projection matrix, normals pointing inwards
+struct ViewFrustum
+{
+	static constexpr unsigned int allPlanes = 0x3F;
+
+	std::array<glm::vec4, 6> planes;
+
+	explicit ViewFrustum(const glm::mat4& viewProjection)
+	{
+		const glm::vec4 x = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		const glm::vec4 y = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		const glm::vec4 z = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		const glm::vec4 w = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		planes = { w + x, w - x, w + y, w - y, w + z, w - z };
+	}
+
+	// tests the box against the planes in mask; false when it is outside one of them,
+	// otherwise clears the bits of the planes it is completely inside of
+	bool test(const BoundingBox& box, unsigned int& mask) const
+	{
+		for (unsigned int i = 0; i < planes.size(); i++)
+		{
+			if (!(mask & (1u << i)))
+				continue;
+			const glm::vec3 normal = glm::vec3(planes[i]);
+			const glm::bvec3 positive = glm::greaterThanEqual(normal, glm::vec3(0.0f));
+			// the corners furthest along and against the normal
+			const glm::vec3 farCorner = glm::mix(box.min, box.max, glm::vec3(positive));
+			const glm::vec3 nearCorner = glm::mix(box.max, box.min, glm::vec3(positive));
+			if (glm::dot(normal, farCorner) + planes[i].w < 0.0f)
+				return false;
+			if (glm::dot(normal, nearCorner) + planes[i].w >= 0.0f)
+				mask &= ~(1u << i);
+		}
+		return true;
+	}
+};
+
+// Dynamic bounding volume hierarchy over boxes, e.g. the world bounds of scene
+// objects. Leaves store their box enlarged by a margin, so small moves do not
+// touch the tree. Inserting picks the sibling with the lowest surface area
+// cost and rotates nodes on the way up when that lowers the cost, which keeps
+// the tree shallow without rebuilding it. Frustum culling accepts or rejects
+// whole subtrees, so its cost follows what is visible, not the scene size.
+class DynamicAabbTree
+{
+public:
+	static constexpr int32_t null = -1;
+
+	DynamicAabbTree(float margin = 0.1f)
+		: margin(margin)
+	{
+	}
+
+	// returns the proxy that addresses the box from now on
+	int32_t insert(const BoundingBox& box, uint32_t userData)
+	{
+		const int32_t leaf = allocateNode();
+		nodes[leaf].box = box.expanded(margin);
+		nodes[leaf].userData = userData;
+		insertLeaf(leaf);
+		leafCount++;
+		return leaf;
+	}
+
+	void remove(int32_t proxy)
+	{
+		removeLeaf(proxy);
+		freeNode(proxy);
+		leafCount--;
+	}
+
+	// returns true when the box left its enlarged box and the leaf was reinserted
+	bool move(int32_t proxy, const BoundingBox& box)
+	{
+		if (nodes[proxy].box.contains(box))
+			return false;
+
+		removeLeaf(proxy);
+		nodes[proxy].box = box.expanded(margin);
+		insertLeaf(proxy);
+		return true;
+	}
+
+	// the enlarged box of the leaf
+	const BoundingBox& getFatBox(int32_t proxy) const
+	{
+		return nodes[proxy].box;
+	}
+
+	uint32_t getUserData(int32_t proxy) const
+	{
+		return nodes[proxy].userData;
+	}
+
+	size_t size() const
+	{
+		return leafCount;
+	}
+
+	// longest path from the root to a leaf, 0 for a single leaf
+	int getHeight() const
+	{
+		return root == null ? 0 : nodes[root].height;
+	}
+
+	// calls callback(userData) for every leaf overlapping the box until it returns false
+	template<typename Callback>
+	void query(const BoundingBox& box, Callback&& callback) const
+	{
+		traverse([&box](const BoundingBox& nodeBox) { return nodeBox.overlaps(box); }, callback);
+	}
+
+	// calls callback(userData) for every leaf overlapping the sphere until it returns false
+	template<typename Callback>
+	void querySphere(const glm::vec3& center, float radius, Callback&& callback) const
+	{
+		traverse([&center, radius](const BoundingBox& nodeBox)
+			{
+				const glm::vec3 offset = center - glm::clamp(center, nodeBox.min, nodeBox.max);
+				return glm::dot(offset, offset) <= radius * radius;
+			}, callback);
+	}
+
+	// calls callback(userData, maxDistance) for every leaf the ray hits before maxDistance;
+	// the callback returns the new maxDistance, e.g. the distance of its own hit to find
+	// the closest one, or 0 to stop. direction has to be normalized.
+	template<typename Callback>
+	void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const
+	{
+		if (root == null)
+			return;
+
+		const glm::vec3 inverse = 1.0f / direction;
+		std::vector<int32_t> stack;
+		stack.reserve(64);
+		stack.push_back(root);
+		while (!stack.empty() && maxDistance > 0.0f)
+		{
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+
+			// slab test
+			const glm::vec3 t0 = (node.box.min - origin) * inverse;
+			const glm::vec3 t1 = (node.box.max - origin) * inverse;
+			const glm::vec3 tMin = glm::min(t0, t1);
+			const glm::vec3 tMax = glm::max(t0, t1);
+			const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+			const float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+			if (enter > exit)
+				continue;
+
+			if (node.isLeaf())
+				maxDistance = callback(node.userData, maxDistance);
+			else
+			{
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+
+	// calls callback(userData) for every leaf whose enlarged box is at least partly in the
+	// frustum; returns how many nodes were visited
+	template<typename Callback>
+	unsigned int cull(const ViewFrustum& frustum, Callback&& callback) const
+	{
+		if (root == null)
+			return 0;
+
+		struct Entry
+		{
+			int32_t node;
+			// planes the parent was not completely inside of
+			unsigned int mask;
+		};
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		stack.push_back({ root, ViewFrustum::allPlanes });
+		unsigned int visited = 0;
+		while (!stack.empty())
+		{
+			Entry entry = stack.back();
+			stack.pop_back();
+			visited++;
+
+			// once inside all planes the whole subtree is accepted without further tests
+			const Node& node = nodes[entry.node];
+			if (entry.mask != 0 && !frustum.test(node.box, entry.mask))
+				continue;
+
+			if (node.isLeaf())
+				callback(node.userData);
+			else
+			{
+				stack.push_back({ node.child1, entry.mask });
+				stack.push_back({ node.child2, entry.mask });
+			}
+		}
+		return visited;
+	}
+
+private:
+	struct Node
+	{
+		BoundingBox box;
+		uint32_t userData = 0;
+		// next free node while unused
+		int32_t parent = null;
+		int32_t child1 = null;
+		int32_t child2 = null;
+		// 0 for leaves, -1 while unused
+		int32_t height = 0;
+
+		bool isLeaf() const
+		{
+			return child1 == null;
+		}
+	};
+
+	std::vector<Node> nodes;
+	int32_t root = null;
+	int32_t freeList = null;
+	size_t leafCount = 0;
+	float margin;
+
+	int32_t allocateNode()
+	{
+		if (freeList == null)
+		{
+			nodes.push_back(Node());
+			return static_cast<int32_t>(nodes.size() - 1);
+		}
+		const int32_t index = freeList;
+		freeList = nodes[index].parent;
+		nodes[index] = Node();
+		return index;
+	}
+
+	void freeNode(int32_t index)
+	{
+		nodes[index].parent = freeList;
+		nodes[index].height = -1;
+		freeList = index;
+	}
+
+	// walks down while the children promise a lower cost than pairing the leaf with the current node
+	int32_t findBestSibling(const BoundingBox& box) const
+	{
+		int32_t index = root;
+		while (!nodes[index].isLeaf())
+		{
+			const Node& node = nodes[index];
+			const float area = node.box.area();
+			const float combinedArea = BoundingBox::merge(node.box, box).area();
+
+			// a new parent for this node and the leaf
+			const float cost = 2.0f * combinedArea;
+			// every node further down grows this node's box
+			const float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto childCost = [&](int32_t child)
+				{
+					const BoundingBox merged = BoundingBox::merge(nodes[child].box, box);
+					if (nodes[child].isLeaf())
+						return merged.area() + inheritanceCost;
+					return merged.area() - nodes[child].box.area() + inheritanceCost;
+				};
+			const float cost1 = childCost(node.child1);
+			const float cost2 = childCost(node.child2);
+
+			if (cost < cost1 && cost < cost2)
+				break;
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+		return index;
+	}
+
+	void insertLeaf(int32_t leaf)
+	{
+		if (root == null)
+		{
+			root = leaf;
+			nodes[leaf].parent = null;
+			return;
+		}
+
+		const int32_t sibling = findBestSibling(nodes[leaf].box);
+		const int32_t oldParent = nodes[sibling].parent;
+		const int32_t newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].box = BoundingBox::merge(nodes[leaf].box, nodes[sibling].box);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent == null)
+			root = newParent;
+		else if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+
+		refit(oldParent);
+	}
+
+	void removeLeaf(int32_t leaf)
+	{
+		if (leaf == root)
+		{
+			root = null;
+			return;
+		}
+
+		const int32_t parent = nodes[leaf].parent;
+		const int32_t grandParent = nodes[parent].parent;
+		const int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+		nodes[sibling].parent = grandParent;
+		if (grandParent == null)
+			root = sibling;
+		else
+		{
+			if (nodes[grandParent].child1 == parent)
+				nodes[grandParent].child1 = sibling;
+			else
+				nodes[grandParent].child2 = sibling;
+		}
+		freeNode(parent);
+		refit(grandParent);
+	}
+
+	// recomputes boxes and heights from index up to the root, rotating where it helps
+	void refit(int32_t index)
+	{
+		while (index != null)
+		{
+			Node& node = nodes[index];
+			node.box = BoundingBox::merge(nodes[node.child1].box, nodes[node.child2].box);
+			node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+			rotate(index);
+			index = nodes[index].parent;
+		}
+	}
+
+	// swaps a child of a with a grandchild on the other side when that shrinks the
+	// changed inner node the most; a's own box stays the same
+	void rotate(int32_t a)
+	{
+		if (nodes[a].height < 2)
+			return;
+
+		const int32_t b = nodes[a].child1;
+		const int32_t c = nodes[a].child2;
+		const bool bInner = !nodes[b].isLeaf();
+		const bool cInner = !nodes[c].isLeaf();
+		const float areaB = nodes[b].box.area();
+		const float areaC = nodes[c].box.area();
+
+		// the rotation swaps child with grandchild, other is the grandchild that stays
+		struct Rotation
+		{
+			int32_t child;
+			int32_t grandchild;
+			int32_t other;
+			float cost;
+		};
+		Rotation best = { null, null, null, (bInner ? areaB : 0.0f) + (cInner ? areaC : 0.0f) };
+		auto consider = [&](int32_t child, int32_t grandchild, int32_t other, float unchangedArea)
+			{
+				const float cost = unchangedArea + BoundingBox::merge(nodes[child].box, nodes[other].box).area();
+				if (cost < best.cost)
+					best = { child, grandchild, other, cost };
+			};
+		if (cInner)
+		{
+			const float unchanged = bInner ? areaB : 0.0f;
+			consider(b, nodes[c].child1, nodes[c].child2, unchanged);
+			consider(b, nodes[c].child2, nodes[c].child1, unchanged);
+		}
+		if (bInner)
+		{
+			const float unchanged = cInner ? areaC : 0.0f;
+			consider(c, nodes[b].child1, nodes[b].child2, unchanged);
+			consider(c, nodes[b].child2, nodes[b].child1, unchanged);
+		}
+		if (best.child == null)
+			return;
+
+		// the inner node on the other side takes the child, a takes the grandchild
+		const int32_t inner = best.child == b ? c : b;
+		if (nodes[a].child1 == best.child)
+			nodes[a].child1 = best.grandchild;
+		else
+			nodes[a].child2 = best.grandchild;
+		if (nodes[inner].child1 == best.grandchild)
+			nodes[inner].child1 = best.child;
+		else
+			nodes[inner].child2 = best.child;
+		nodes[best.grandchild].parent = a;
+		nodes[best.child].parent = inner;
+
+		nodes[inner].box = BoundingBox::merge(nodes[best.child].box, nodes[best.other].box);
+		nodes[inner].height = 1 + std::max(nodes[best.child].height, nodes[best.other].height);
+		nodes[a].height = 1 + std::max(nodes[nodes[a].child1].height, nodes[nodes[a].child2].height);
+	}
+
+	// depth first through every node accepted by overlaps until callback returns false
+	template<typename Overlaps, typename Callback>
+	void traverse(Overlaps&& overlaps, Callback&& callback) const
+	{
+		if (root == null)
+			return;
+
+		std::vector<int32_t> stack;
+		stack.reserve(64);
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (!overlaps(node.box))
+				continue;
+
+			if (node.isLeaf())
+			{
+				if (!callback(node.userData))
+					return;
+			}
+			else
+			{
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#pragma warning(push, 0)
+#include <learnopengl/shader_m.h>
+#pragma warning(pop)
+
+#include <string>
+
+#include "shader_permutations.h"
+#include "program_cache.h"
+
+// How the scene target is anti-aliased. MSAA multisamples color, depth and
+// stencil of every pass and resolves at the end. FXAA renders single-sampled
+// and smooths edges in a post-process pass, which costs a fixed amount per
+// pixel instead of multiplying the bandwidth of every pass.
+enum class AntiAliasing
+{
+	None,
+	Msaa2,
+	Msaa4,
+	Msaa8,
+	Fxaa,
+};
+
+inline constexpr AntiAliasing antiAliasingModes[] = {
+	AntiAliasing::None, AntiAliasing::Msaa2, AntiAliasing::Msaa4, AntiAliasing::Msaa8, AntiAliasing::Fxaa
+};
+
+// samples of the scene target for the mode
+inline int getSampleCount(AntiAliasing mode)
+{
+	switch (mode)
+	{
+	case AntiAliasing::Msaa2: return 2;
+	case AntiAliasing::Msaa4: return 4;
+	case AntiAliasing::Msaa8: return 8;
+	default: return 0;
+	}
+}
+
+inline const char* getAntiAliasingName(AntiAliasing mode)
+{
+	switch (mode)
+	{
+	case AntiAliasing::Msaa2: return "msaa2";
+	case AntiAliasing::Msaa4: return "msaa4";
+	case AntiAliasing::Msaa8: return "msaa8";
+	case AntiAliasing::Fxaa: return "fxaa";
+	default: return "none";
+	}
+}
+
+// accepts the names returned by getAntiAliasingName
+inline bool parseAntiAliasing(const std::string& name, AntiAliasing& mode)
+{
+	for (AntiAliasing candidate : antiAliasingModes)
+	{
+		if (name == getAntiAliasingName(candidate))
+		{
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+// FXAA post-process pass: reads a single-sample color texture and writes the
+// smoothed image into the bound framebuffer with one full-screen triangle.
+class FxaaPass
+{
+public:
+	FxaaPass(ProgramCache& programCache)
+		: shader("Shaders/fxaa_shader.vert", "Shaders/fxaa_shader.frag")
+	{
+		shader.programCache = &programCache;
+		shader.onCompile = [](Shader& shader)
+			{
+				shader.setInt("screenTexture", 0);
+			};
+		shader.submitAll();
+
+		// core profile needs a bound vertex array even without attributes
+		glGenVertexArrays(1, &VAO);
+	}
+
+	~FxaaPass()
+	{
+		glDeleteVertexArrays(1, &VAO);
+	}
+
+	FxaaPass(const FxaaPass&) = delete;
+	FxaaPass& operator=(const FxaaPass&) = delete;
+
+	bool isReady() const
+	{
+		return shader.isReady();
+	}
+
+	// the image covers the lower left width x height texels of a textureWidth x textureHeight
+	// texture; the viewport has to be set to the output size
+	void apply(unsigned int colorTexture, int width, int height, int textureWidth, int textureHeight)
+	{
+		const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		const GLboolean stencilTest = glIsEnabled(GL_STENCIL_TEST);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
+
+		const glm::vec2 textureSize = glm::vec2(textureWidth, textureHeight);
+		Shader& fxaaShader = shader.get(0);
+		fxaaShader.use();
+		fxaaShader.setVec2("uvScale", glm::vec2(width, height) / textureSize);
+		fxaaShader.setVec2("uvMax", (glm::vec2(width, height) - 0.5f) / textureSize);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, colorTexture);
+
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+
+		if (depthTest)
+			glEnable(GL_DEPTH_TEST);
+		if (stencilTest)
+			glEnable(GL_STENCIL_TEST);
+	}
+
+private:
+	ShaderPermutations shader;
+	unsigned int VAO = 0;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+// Counts edits to anything a rendered image depends on: object transforms,
+// the view, lights and render settings. A frame records the count it was
+// built from, so the renderer can tell that a frame would look exactly like
+// the one on screen and skip it. Touched only by the thread that owns the
+// scene; other threads read the count from the frame it was recorded into.
+class ChangeCounter
+{
+public:
+	void touch()
+	{
+		count++;
+	}
+
+	uint64_t get() const
+	{
+		return count;
+	}
+
+private:
+	uint64_t count = 0;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <learnopengl/transform_kernels.h>
+
+#include <vector>
+
+#include "ecs.h"
+#include "objects.h"
+
+class Camera;
+
+// Components of the demo's entities, stored by World. Systems that work on
+// them are part of DemoScene.
+
+// where an entity is; normalModel follows model for the lighting shader
+struct ModelTransform
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat3 normalModel = glm::mat3(1.0f);
+
+	ModelTransform() = default;
+	explicit ModelTransform(const glm::mat4& matrix)
+	{
+		set(matrix);
+	}
+
+	// returns whether the matrix changed
+	bool set(const glm::mat4& matrix)
+	{
+		if (matrix == model)
+			return false;
+		model = matrix;
+		normalModel = selectNormalMatrix(matrix);
+		return true;
+	}
+};
+
+// ModelTransform::set for count transforms, with the normal matrices of those that changed
+// computed in one batch; returns how many changed
+inline size_t setModelTransforms(ModelTransform* transforms, const glm::mat4* matrices, size_t count)
+{
+	std::vector<glm::mat4> changedModels;
+	std::vector<size_t> changed;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (matrices[i] == transforms[i].model)
+			continue;
+		changed.push_back(i);
+		changedModels.push_back(matrices[i]);
+	}
+
+	std::vector<glm::mat3> normals(changed.size());
+	selectNormalMatrices(changedModels.data(), normals.data(), changed.size());
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		transforms[changed[i]].model = changedModels[i];
+		transforms[changed[i]].normalModel = normals[i];
+	}
+	return changed.size();
+}
+
+// the meshes an entity draws, shared with every other entity that draws them
+struct MeshRef
+{
+	RenderMesh* mesh = nullptr;
+};
+
+// how the renderer treats an entity's meshes; their textures come with the model
+struct Material
+{
+	// rasterized by the occlusion culler to hide what is behind it
+	bool occluder = false;
+	// drawn in the mirror as well as in the main view
+	bool reflected = true;
+};
+
+// a point light at an offset from the entity's origin, in model space
+struct PointLightSource
+{
+	glm::vec3 offset = glm::vec3(0.0f);
+	glm::vec3 color = glm::vec3(1.0f);
+};
+
+// a spotlight at an offset from the entity's origin, shining along direction, in model space
+struct SpotLightSource
+{
+	glm::vec3 offset = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);
+	float edgeCoeff = 50.0f;
+	glm::vec3 color = glm::vec3(1.0f);
+};
+
+// moves a camera with another entity
+struct CameraAttachment
+{
+	enum class Mode
+	{
+		// the camera sits at offset in the target's model space and looks at its origin
+		Follow,
+		// the camera stays where it is and turns to the target's origin
+		Watch,
+	};
+
+	Camera* camera = nullptr;
+	EntityId target;
+	Mode mode = Mode::Watch;
+	glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// moves the entity along the figure eight of the demo's flashlight; the reflector
+// angles turn it away from the direction of the path
+struct FlashlightPath
+{
+	glm::vec3 origin = glm::vec3(0.0f);
+	// rotation of the path around the y axis, in degrees
+	float heading = 0.0f;
+	float amplitude = 5.0f;
+	// path parameter per second of simulation time
+	float speed = 0.5f;
+	float scale = 1.0f;
+};
@@ -0,0 +1,402 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "job_system.h"
+
+// handle of an entity; stays invalid once the entity is destroyed, even when its slot is reused
+struct EntityId
+{
+	static constexpr uint32_t invalidIndex = ~0u;
+
+	uint32_t index = invalidIndex;
+	uint32_t generation = 0;
+
+	bool operator==(const EntityId&) const = default;
+};
+
+// Archetype based entity component system. Entities with the same set of
+// components share an archetype, which stores them in chunks of a fixed size
+// with one contiguous array per component, so a system touches only the
+// memory of the components it asks for. Adding or removing a component moves
+// the entity to another archetype; destroying it moves the last entity of the
+// archetype into the hole. Components have to be trivially copyable, they
+// are moved around with memcpy.
+class World
+{
+public:
+	// bytes of one chunk; its capacity is how many entities of the archetype fit
+	static constexpr size_t chunkSize = 16 * 1024;
+	static constexpr unsigned int maxComponentTypes = 32;
+
+	World() = default;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Components>
+	EntityId create(const Components&... components)
+	{
+		const EntityId entity = allocateEntity();
+		Archetype& archetype = getArchetype(getMask<Components...>());
+		place(entity, archetype);
+		(write(entity, components), ...);
+		return entity;
+	}
+
+	void destroy(EntityId entity)
+	{
+		if (!isAlive(entity))
+			return;
+		removeFromArchetype(entity);
+		Slot& slot = slots[entity.index];
+		slot.generation++;
+		slot.archetype = nullptr;
+		freeIndices.push_back(entity.index);
+	}
+
+	bool isAlive(EntityId entity) const
+	{
+		return entity.index < slots.size() && slots[entity.index].generation == entity.generation && slots[entity.index].archetype;
+	}
+
+	template<typename Component>
+	bool has(EntityId entity) const
+	{
+		return isAlive(entity) && (slots[entity.index].archetype->mask & getBit<Component>());
+	}
+
+	// nullptr when the entity is gone or does not have the component
+	template<typename Component>
+	Component* get(EntityId entity)
+	{
+		if (!has<Component>(entity))
+			return nullptr;
+		const Slot& slot = slots[entity.index];
+		return slot.archetype->template getArray<Component>(*slot.archetype->chunks[slot.chunk]) + slot.row;
+	}
+
+	template<typename Component>
+	const Component* get(EntityId entity) const
+	{
+		return const_cast<World*>(this)->get<Component>(entity);
+	}
+
+	// adds the component or overwrites the one the entity has
+	template<typename Component>
+	void add(EntityId entity, const Component& component)
+	{
+		if (!isAlive(entity))
+			return;
+		const uint32_t mask = slots[entity.index].archetype->mask | getBit<Component>();
+		if (mask != slots[entity.index].archetype->mask)
+			moveToArchetype(entity, getArchetype(mask));
+		write(entity, component);
+	}
+
+	template<typename Component>
+	void remove(EntityId entity)
+	{
+		if (has<Component>(entity))
+			moveToArchetype(entity, getArchetype(slots[entity.index].archetype->mask & ~getBit<Component>()));
+	}
+
+	// entities with at least the given components
+	template<typename... Components>
+	size_t count() const
+	{
+		const uint32_t mask = getMask<Components...>();
+		size_t total = 0;
+		for (const auto& archetype : archetypes)
+		{
+			if ((archetype->mask & mask) == mask)
+				total += archetype->size;
+		}
+		return total;
+	}
+
+	// calls function(const EntityId* entities, size_t count, size_t first, Components*... arrays) for
+	// every chunk with all of the components. first is the position of the chunk's first entity in
+	// the order of the query, which stays the same until an entity is created, destroyed or changes
+	// its components.
+	template<typename... Components, typename Function>
+	void eachChunk(Function&& function)
+	{
+		size_t first = 0;
+		for (const ChunkRef& chunk : getChunks(getMask<Components...>()))
+		{
+			function(chunk.chunk->entities(), chunk.chunk->size, first, chunk.archetype->template getArray<Components>(*chunk.chunk)...);
+			first += chunk.chunk->size;
+		}
+	}
+
+	// eachChunk with every chunk as a job; function must not change the structure of the world
+	template<typename... Components, typename Function>
+	void parallelEachChunk(JobSystem& jobSystem, Function&& function, const char* name = "parallelEachChunk")
+	{
+		const std::vector<ChunkRef> chunks = getChunks(getMask<Components...>());
+		std::vector<size_t> firsts(chunks.size());
+		for (size_t i = 1; i < chunks.size(); i++)
+			firsts[i] = firsts[i - 1] + chunks[i - 1].chunk->size;
+
+		jobSystem.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					function(chunks[i].chunk->entities(), chunks[i].chunk->size, firsts[i], chunks[i].archetype->template getArray<Components>(*chunks[i].chunk)...);
+			}, name);
+	}
+
+	// calls function(EntityId, Components&...) for every entity with all of the components
+	template<typename... Components, typename Function>
+	void each(Function&& function)
+	{
+		eachChunk<Components...>([&function](const EntityId* entities, size_t count, size_t, Components*... arrays)
+			{
+				for (size_t i = 0; i < count; i++)
+					function(entities[i], arrays[i]...);
+			});
+	}
+
+private:
+	struct ComponentType
+	{
+		size_t size;
+		size_t alignment;
+	};
+
+	struct Chunk
+	{
+		std::unique_ptr<std::byte[]> data;
+		size_t size = 0;
+
+		// the entity array starts every chunk
+		EntityId* entities()
+		{
+			return reinterpret_cast<EntityId*>(data.get());
+		}
+	};
+
+	struct Archetype
+	{
+		uint32_t mask = 0;
+		// entities per chunk
+		size_t capacity = 0;
+		size_t size = 0;
+		// byte offset of every component's array in a chunk, by component id
+		size_t offsets[maxComponentTypes] = {};
+		std::vector<std::unique_ptr<Chunk>> chunks;
+
+		template<typename Component>
+		Component* getArray(Chunk& chunk) const
+		{
+			return reinterpret_cast<Component*>(chunk.data.get() + offsets[getId<Component>()]);
+		}
+	};
+
+	struct ChunkRef
+	{
+		Archetype* archetype;
+		Chunk* chunk;
+	};
+
+	// where an entity lives; archetype is nullptr while the slot is free
+	struct Slot
+	{
+		Archetype* archetype = nullptr;
+		uint32_t chunk = 0;
+		uint32_t row = 0;
+		uint32_t generation = 0;
+	};
+
+	std::vector<std::unique_ptr<Archetype>> archetypes;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeIndices;
+
+	// sizes of the component types by id, shared by every world
+	static std::vector<ComponentType>& getComponentTypes()
+	{
+		static std::vector<ComponentType> types;
+		return types;
+	}
+
+	// ids are handed out on first use; queries may ask for const components
+	template<typename Component>
+	static unsigned int getId()
+	{
+		return getTypeId<std::remove_cv_t<Component>>();
+	}
+
+	template<typename Component>
+	static unsigned int getTypeId()
+	{
+		static_assert(std::is_trivially_copyable_v<Component>, "components are moved with memcpy");
+		static const unsigned int id = []
+			{
+				std::vector<ComponentType>& types = getComponentTypes();
+				assert(types.size() < maxComponentTypes);
+				types.push_back({ sizeof(Component), alignof(Component) });
+				return static_cast<unsigned int>(types.size() - 1);
+			}();
+		return id;
+	}
+
+	template<typename Component>
+	static uint32_t getBit()
+	{
+		return 1u << getId<Component>();
+	}
+
+	template<typename... Components>
+	static uint32_t getMask()
+	{
+		return (0u | ... | getBit<Components>());
+	}
+
+	Archetype& getArchetype(uint32_t mask)
+	{
+		for (const auto& archetype : archetypes)
+		{
+			if (archetype->mask == mask)
+				return *archetype;
+		}
+
+		// entities first, then the component arrays in id order, each aligned to its type
+		auto archetype = std::make_unique<Archetype>();
+		archetype->mask = mask;
+		const std::vector<ComponentType>& types = getComponentTypes();
+		auto layout = [&](size_t capacity)
+			{
+				size_t offset = sizeof(EntityId) * capacity;
+				for (unsigned int id = 0; id < types.size(); id++)
+				{
+					if (!(mask & (1u << id)))
+						continue;
+					offset = (offset + types[id].alignment - 1) / types[id].alignment * types[id].alignment;
+					archetype->offsets[id] = offset;
+					offset += types[id].size * capacity;
+				}
+				return offset;
+			};
+		size_t entitySize = sizeof(EntityId);
+		for (unsigned int id = 0; id < types.size(); id++)
+			entitySize += mask & (1u << id) ? types[id].size : 0;
+		archetype->capacity = std::max<size_t>(1, chunkSize / entitySize);
+		// alignment padding may not fit any more
+		while (archetype->capacity > 1 && layout(archetype->capacity) > chunkSize)
+			archetype->capacity--;
+		layout(archetype->capacity);
+
+		archetypes.push_back(std::move(archetype));
+		return *archetypes.back();
+	}
+
+	EntityId allocateEntity()
+	{
+		if (freeIndices.empty())
+		{
+			slots.push_back(Slot());
+			return { static_cast<uint32_t>(slots.size() - 1), 0 };
+		}
+		const uint32_t index = freeIndices.back();
+		freeIndices.pop_back();
+		return { index, slots[index].generation };
+	}
+
+	// appends the entity to the last chunk of the archetype; its components are left uninitialized
+	void place(EntityId entity, Archetype& archetype)
+	{
+		if (archetype.chunks.empty() || archetype.chunks.back()->size == archetype.capacity)
+		{
+			auto chunk = std::make_unique<Chunk>();
+			chunk->data = std::make_unique<std::byte[]>(std::max(chunkSize, layoutSize(archetype)));
+			archetype.chunks.push_back(std::move(chunk));
+		}
+		Chunk& chunk = *archetype.chunks.back();
+		chunk.entities()[chunk.size] = entity;
+		slots[entity.index] = { &archetype, static_cast<uint32_t>(archetype.chunks.size() - 1), static_cast<uint32_t>(chunk.size), entity.generation };
+		chunk.size++;
+		archetype.size++;
+	}
+
+	// bytes the arrays of a chunk take, more than chunkSize when a single entity does not fit
+	static size_t layoutSize(const Archetype& archetype)
+	{
+		const std::vector<ComponentType>& types = getComponentTypes();
+		size_t end = sizeof(EntityId) * archetype.capacity;
+		for (unsigned int id = 0; id < types.size(); id++)
+		{
+			if (archetype.mask & (1u << id))
+				end = std::max(end, archetype.offsets[id] + types[id].size * archetype.capacity);
+		}
+		return end;
+	}
+
+	template<typename Component>
+	void write(EntityId entity, const Component& component)
+	{
+		*get<Component>(entity) = component;
+	}
+
+	// fills the entity's row with the last entity of the archetype
+	void removeFromArchetype(EntityId entity)
+	{
+		const Slot slot = slots[entity.index];
+		Archetype& archetype = *slot.archetype;
+		Chunk& last = *archetype.chunks.back();
+		const uint32_t lastRow = static_cast<uint32_t>(last.size - 1);
+		Chunk& chunk = *archetype.chunks[slot.chunk];
+		if (&chunk != &last || slot.row != lastRow)
+		{
+			const EntityId moved = last.entities()[lastRow];
+			chunk.entities()[slot.row] = moved;
+			copyComponents(archetype, last, lastRow, archetype, chunk, slot.row);
+			slots[moved.index].chunk = slot.chunk;
+			slots[moved.index].row = slot.row;
+		}
+		last.size--;
+		archetype.size--;
+		if (last.size == 0)
+			archetype.chunks.pop_back();
+	}
+
+	// copies the components both archetypes have
+	static void copyComponents(const Archetype& from, Chunk& fromChunk, uint32_t fromRow, const Archetype& to, Chunk& toChunk, uint32_t toRow)
+	{
+		const std::vector<ComponentType>& types = getComponentTypes();
+		const uint32_t shared = from.mask & to.mask;
+		for (unsigned int id = 0; id < types.size(); id++)
+		{
+			if (shared & (1u << id))
+				std::memcpy(toChunk.data.get() + to.offsets[id] + types[id].size * toRow, fromChunk.data.get() + from.offsets[id] + types[id].size * fromRow, types[id].size);
+		}
+	}
+
+	void moveToArchetype(EntityId entity, Archetype& target)
+	{
+		const Slot slot = slots[entity.index];
+		place(entity, target);
+		const Slot placed = slots[entity.index];
+		copyComponents(*slot.archetype, *slot.archetype->chunks[slot.chunk], slot.row, target, *target.chunks[placed.chunk], placed.row);
+		slots[entity.index] = slot;
+		removeFromArchetype(entity);
+		slots[entity.index] = placed;
+	}
+
+	std::vector<ChunkRef> getChunks(uint32_t mask) const
+	{
+		std::vector<ChunkRef> chunks;
+		for (const auto& archetype : archetypes)
+		{
+			if ((archetype->mask & mask) != mask)
+				continue;
+			for (const auto& chunk : archetype->chunks)
+				chunks.push_back({ archetype.get(), chunk.get() });
+		}
+		return chunks;
+	}
+};
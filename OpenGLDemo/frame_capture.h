@@ -0,0 +1,304 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image_writer.h"
+
+enum class CaptureFormat
+{
+	Png,
+	Qoi,
+	// top-down RGBA frames appended to one file or named pipe, e.g. for
+	// ffmpeg -f rawvideo -pix_fmt rgba -s WIDTHxHEIGHT -i PATH
+	Raw,
+};
+
+// Captures rendered frames without stalling the pipeline. glReadPixels goes
+// into one of a ring of persistently mapped pixel-pack buffers and returns
+// immediately; update polls the fences of earlier captures and hands the
+// finished ones to an encoder thread, which reads the mapped memory directly
+// and returns the slot when the file is written. When every slot is busy the
+// frame is dropped instead of waiting, so capturing never adds a stall.
+class FrameCapture
+{
+public:
+	FrameCapture(unsigned int ringSize = 4)
+		: slots(std::max(1u, ringSize))
+	{
+		encoder = std::thread(&FrameCapture::run, this);
+	}
+
+	// needs the GL context still current, see finish
+	~FrameCapture()
+	{
+		finish();
+	}
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// starts reading the color buffer of the framebuffer (0 = back buffer); the
+	// image is written to path once the GPU has produced it. Returns false when
+	// the frame had to be dropped because no slot was free.
+	bool capture(unsigned int framebuffer, int width, int height, const std::string& path, CaptureFormat format)
+	{
+		auto it = std::find_if(slots.begin(), slots.end(), [](const Slot& slot) { return slot.state == SlotState::Free; });
+		if (it == slots.end() || finished)
+		{
+			droppedCount++;
+			return false;
+		}
+		Slot& slot = *it;
+
+		const size_t size = static_cast<size_t>(width) * height * 4;
+		if (slot.size < size)
+			allocate(slot, size);
+
+		GLint readFramebuffer = 0;
+		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.state = SlotState::Reading;
+		slot.job = { width, height, path, format };
+		reading.push_back(static_cast<size_t>(it - slots.begin()));
+		return true;
+	}
+
+	// call once per frame; passes every finished readback to the encoder without waiting
+	void update()
+	{
+		while (!reading.empty())
+		{
+			if (reading.front() == endOfStream)
+			{
+				encode(endOfStream);
+				continue;
+			}
+			Slot& slot = slots[reading.front()];
+			const GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+				break;
+			encode(reading.front());
+		}
+	}
+
+	// closes the raw stream once the frames captured so far are written, so that a
+	// recording is complete on disk when it stops; the next raw capture opens it again
+	void endRecording()
+	{
+		if (!finished)
+			reading.push_back(endOfStream);
+	}
+
+	// writes every pending capture and releases the GL objects; needs the context
+	void finish()
+	{
+		if (finished)
+			return;
+		finished = true;
+
+		while (!reading.empty())
+		{
+			while (reading.front() != endOfStream && glClientWaitSync(slots[reading.front()].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+				;
+			encode(reading.front());
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		queued.notify_one();
+		if (encoder.joinable())
+			encoder.join();
+
+		for (Slot& slot : slots)
+		{
+			if (slot.buffer)
+			{
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+				glDeleteBuffers(1, &slot.buffer);
+			}
+			slot.buffer = 0;
+		}
+	}
+
+	// frames written so far
+	uint64_t getCapturedCount() const
+	{
+		return capturedCount;
+	}
+
+	// frames skipped because every slot was still being read or encoded
+	uint64_t getDroppedCount() const
+	{
+		return droppedCount;
+	}
+
+private:
+	enum class SlotState
+	{
+		Free,
+		// the GPU is writing the buffer
+		Reading,
+		// owned by the encoder thread
+		Encoding,
+	};
+
+	struct Job
+	{
+		int width = 0;
+		int height = 0;
+		std::string path;
+		CaptureFormat format = CaptureFormat::Qoi;
+	};
+
+	struct Slot
+	{
+		unsigned int buffer = 0;
+		size_t size = 0;
+		const uint8_t* mapped = nullptr;
+		GLsync fence = nullptr;
+		Job job;
+		std::atomic<SlotState> state = SlotState::Free;
+	};
+
+	// queued in place of a slot index by endRecording
+	static constexpr size_t endOfStream = SIZE_MAX;
+
+	std::vector<Slot> slots;
+	// slots in Reading state, oldest first
+	std::deque<size_t> reading;
+	bool finished = false;
+
+	std::thread encoder;
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::deque<size_t> encodeQueue;
+	bool stopping = false;
+	// raw frames of consecutive captures go into the same stream
+	std::ofstream rawStream;
+	std::string rawPath;
+
+	std::atomic<uint64_t> capturedCount = 0;
+	uint64_t droppedCount = 0;
+
+	// buffers are immutable and mapped for their lifetime; GL_CLIENT_STORAGE_BIT
+	// asks for cached system memory, which the encoder reads fastest
+	void allocate(Slot& slot, size_t size)
+	{
+		if (slot.buffer)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glDeleteBuffers(1, &slot.buffer);
+		}
+
+		const GLbitfield access = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, access | GL_CLIENT_STORAGE_BIT);
+		slot.mapped = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, access));
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot.size = size;
+	}
+
+	void encode(size_t index)
+	{
+		if (index != endOfStream)
+		{
+			Slot& slot = slots[index];
+			glDeleteSync(slot.fence);
+			slot.fence = nullptr;
+			slot.state = SlotState::Encoding;
+		}
+		reading.pop_front();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			encodeQueue.push_back(index);
+		}
+		queued.notify_one();
+	}
+
+	// encoder thread: writes queued slots until stopped and the queue is empty
+	void run()
+	{
+		while (true)
+		{
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queued.wait(lock, [this] { return stopping || !encodeQueue.empty(); });
+				if (encodeQueue.empty())
+					break;
+				index = encodeQueue.front();
+				encodeQueue.pop_front();
+			}
+
+			if (index == endOfStream)
+			{
+				closeRawStream();
+				continue;
+			}
+
+			Slot& slot = slots[index];
+			const Job& job = slot.job;
+			// glReadPixels rows are bottom-up, the files want them top-down
+			const ptrdiff_t stride = static_cast<ptrdiff_t>(job.width) * 4;
+			const uint8_t* topRow = slot.mapped + (job.height - 1) * stride;
+
+			switch (job.format)
+			{
+			case CaptureFormat::Png:
+				writePng(job.path, topRow, job.width, job.height, -stride);
+				break;
+			case CaptureFormat::Qoi:
+				writeQoi(job.path, topRow, job.width, job.height, -stride);
+				break;
+			case CaptureFormat::Raw:
+				if (job.path != rawPath)
+				{
+					rawStream = std::ofstream(job.path, std::ios::binary);
+					rawPath = job.path;
+				}
+				if (!writeRaw(rawStream, topRow, job.width, job.height, -stride))
+					std::cout << "ERROR::FRAME_CAPTURE::CANNOT_WRITE: " << job.path << std::endl;
+				break;
+			}
+
+			capturedCount++;
+			slot.state = SlotState::Free;
+		}
+		closeRawStream();
+	}
+
+	void closeRawStream()
+	{
+		if (!rawStream.is_open())
+			return;
+		rawStream.close();
+		if (rawStream.fail())
+			std::cout << "ERROR::FRAME_CAPTURE::CANNOT_WRITE: " << rawPath << std::endl;
+		rawStream.clear();
+		rawPath.clear();
+	}
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+enum class SwapMode
+{
+	// wait for vertical blank
+	VSync,
+	// wait for vertical blank unless the frame is late, then tear instead of stalling a whole refresh
+	Adaptive,
+	// present immediately
+	Off,
+};
+
+// Smoothness of the recent frames, from the intervals between frame ends
+struct FramePacingStats
+{
+	double mean = 0.0;
+	double variance = 0.0;
+	double standardDeviation = 0.0;
+	// mean difference between consecutive frame times, what the eye notices as stutter
+	double jitter = 0.0;
+	double max = 0.0;
+};
+
+// Keeps the render loop from running ahead of the GPU and delivers frames at an
+// even rate. Every frame ends with a fence; beginFrame waits for the fence of
+// the frame maxFramesInFlight back, which bounds latency independently of how
+// deep the driver queues. An optional frame-rate limit sleeps for most of the
+// remaining time and spins for the last stretch, since sleeping alone is only
+// accurate to the scheduler tick.
+class FramePacer
+{
+public:
+	FramePacer(unsigned int maxFramesInFlight = 2, SwapMode swapMode = SwapMode::VSync, double frameRateLimit = 0.0, size_t historySize = 240)
+		: fences(std::max(1u, maxFramesInFlight), nullptr), history(historySize, 0.0)
+	{
+		setSwapMode(swapMode);
+		setFrameRateLimit(frameRateLimit);
+	}
+
+	// needs the context still current; the fences of the last frames are still alive
+	~FramePacer()
+	{
+		for (GLsync fence : fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+	}
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// needs the context current; falls back to VSync when tearing is not supported
+	void setSwapMode(SwapMode mode)
+	{
+		if (mode == SwapMode::Adaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+			mode = SwapMode::VSync;
+
+		swapMode = mode;
+		glfwSwapInterval(mode == SwapMode::VSync ? 1 : mode == SwapMode::Adaptive ? -1 : 0);
+	}
+
+	SwapMode getSwapMode() const
+	{
+		return swapMode;
+	}
+
+	// frames per second, 0 = unlimited
+	void setFrameRateLimit(double framesPerSecond)
+	{
+		framePeriod = framesPerSecond > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond)) : Clock::duration::zero();
+		nextFrame = Clock::now();
+	}
+
+	unsigned int getMaxFramesInFlight() const
+	{
+		return static_cast<unsigned int>(fences.size());
+	}
+
+	// call before issuing any GL work for the frame; blocks while too many frames are queued
+	void beginFrame()
+	{
+		GLsync& fence = fences[frame % fences.size()];
+		if (!fence)
+			return;
+
+		const auto start = Clock::now();
+		GLenum result;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		fence = nullptr;
+		lastGpuWait = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// call right after swapping buffers
+	void endFrame()
+	{
+		fences[frame % fences.size()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame++;
+
+		if (framePeriod != Clock::duration::zero())
+			waitForNextFrame();
+
+		const auto now = Clock::now();
+		if (lastFrameEnd != Clock::time_point())
+		{
+			history[historyIndex % history.size()] = std::chrono::duration<double, std::milli>(now - lastFrameEnd).count();
+			historyIndex++;
+		}
+		lastFrameEnd = now;
+	}
+
+	// call instead of endFrame for a frame that was not rendered, so the time
+	// spent idle does not count as one long frame
+	void skipFrame()
+	{
+		lastFrameEnd = Clock::now();
+		nextFrame = lastFrameEnd;
+	}
+
+	// milliseconds between the end of the last two frames
+	double getLastFrameTime() const
+	{
+		return historyIndex > 0 ? history[(historyIndex - 1) % history.size()] : 0.0;
+	}
+
+	// milliseconds the last beginFrame spent waiting for the GPU
+	double getLastGpuWait() const
+	{
+		return lastGpuWait;
+	}
+
+	// statistics over the last historySize frames, in milliseconds
+	FramePacingStats getStats() const
+	{
+		FramePacingStats stats;
+		const size_t count = std::min(historyIndex, history.size());
+		if (count == 0)
+			return stats;
+
+		// oldest first, so consecutive samples are consecutive frames
+		const size_t first = historyIndex - count;
+		double sum = 0.0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const double frameTime = history[(first + i) % history.size()];
+			sum += frameTime;
+			stats.max = std::max(stats.max, frameTime);
+		}
+		stats.mean = sum / count;
+
+		double squaredDeviations = 0.0;
+		double differences = 0.0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const double frameTime = history[(first + i) % history.size()];
+			squaredDeviations += (frameTime - stats.mean) * (frameTime - stats.mean);
+			if (i > 0)
+				differences += std::abs(frameTime - history[(first + i - 1) % history.size()]);
+		}
+		stats.variance = squaredDeviations / count;
+		stats.standardDeviation = std::sqrt(stats.variance);
+		stats.jitter = count > 1 ? differences / (count - 1) : 0.0;
+		return stats;
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+	// below this the limiter spins instead of sleeping
+	static constexpr std::chrono::microseconds spinThreshold = std::chrono::microseconds(2000);
+
+	std::vector<GLsync> fences;
+	uint64_t frame = 0;
+	SwapMode swapMode = SwapMode::VSync;
+
+	Clock::duration framePeriod = Clock::duration::zero();
+	Clock::time_point nextFrame;
+
+	std::vector<double> history;
+	size_t historyIndex = 0;
+	Clock::time_point lastFrameEnd;
+	double lastGpuWait = 0.0;
+
+	void waitForNextFrame()
+	{
+		nextFrame += framePeriod;
+		auto now = Clock::now();
+
+		// more than a frame behind: start a new schedule instead of rushing to catch up
+		if (now > nextFrame + framePeriod)
+		{
+			nextFrame = now;
+			return;
+		}
+
+		if (nextFrame - now > spinThreshold)
+			std::this_thread::sleep_for(nextFrame - now - spinThreshold);
+		while (Clock::now() < nextFrame)
+			std::this_thread::yield();
+	}
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "frame_state.h"
+
+// Runs the simulation of upcoming frames on a worker thread while the render
+// thread submits the current one. The two threads only exchange InputState
+// (render -> simulation) and FrameSnapshot (simulation -> render) through a
+// ring of depth + 1 slots, so the simulation can run at most `depth` frames
+// ahead of rendering. A depth of 0 simulates synchronously on the render thread.
+class FramePipeline
+{
+public:
+	using SimulateFunction = std::function<void(const InputState&, FrameSnapshot&)>;
+
+	FramePipeline(unsigned int depth, SimulateFunction simulate)
+		: depth(depth), slots(depth + 1), simulate(std::move(simulate))
+	{
+		if (depth > 0)
+			worker = std::thread(&FramePipeline::run, this);
+	}
+
+	~FramePipeline()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		simulated.notify_all();
+		submitted.notify_all();
+		if (worker.joinable())
+			worker.join();
+	}
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	unsigned int getDepth() const
+	{
+		return depth;
+	}
+
+	// fills the pipeline before the first frame so the render thread never waits
+	// for a simulation it could have overlapped with
+	void prime(const InputState& input)
+	{
+		for (unsigned int i = 0; i < depth; i++)
+			submit(input);
+	}
+
+	// queues the input for the next frame to simulate; blocks only while every
+	// slot is still waiting to be rendered
+	void submit(const InputState& input)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		released.wait(lock, [this] { return submitCount - releaseCount < slots.size(); });
+		slots[submitCount % slots.size()].input = input;
+		submitCount++;
+		lock.unlock();
+		submitted.notify_one();
+	}
+
+	// returns the oldest simulated frame, waiting for the simulation if needed
+	const FrameSnapshot& acquire()
+	{
+		if (depth == 0)
+		{
+			Slot& slot = slots[releaseCount % slots.size()];
+			simulate(slot.input, slot.snapshot);
+			simulateCount++;
+			return slot.snapshot;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		simulated.wait(lock, [this] { return simulateCount > releaseCount; });
+		return slots[releaseCount % slots.size()].snapshot;
+	}
+
+	// hands the slot of the acquired frame back to the simulation
+	void release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			releaseCount++;
+		}
+		released.notify_one();
+	}
+
+private:
+	struct Slot
+	{
+		InputState input;
+		FrameSnapshot snapshot;
+	};
+
+	unsigned int depth;
+	std::vector<Slot> slots;
+	SimulateFunction simulate;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable submitted;
+	std::condition_variable simulated;
+	std::condition_variable released;
+
+	// running frame counters; slot of frame n is n % slots.size()
+	size_t submitCount = 0;
+	size_t simulateCount = 0;
+	size_t releaseCount = 0;
+	bool stopping = false;
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			submitted.wait(lock, [this] { return stopping || simulateCount < submitCount; });
+			if (stopping)
+				return;
+
+			Slot& slot = slots[simulateCount % slots.size()];
+			// the slot belongs to the simulation until simulateCount moves past it
+			lock.unlock();
+			simulate(slot.input, slot.snapshot);
+			lock.lock();
+
+			simulateCount++;
+			simulated.notify_one();
+		}
+	}
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "aabb_tree.h"
+#include "lights.h"
+
+class RenderMesh;
+class Camera;
+struct OccluderMesh;
+
+// Everything the simulation needs from the window system for one frame.
+// Captured on the GLFW thread, consumed by the simulation thread.
+struct InputState
+{
+	float time = 0.0f;
+	float aspect = 1.0f;
+	// framebuffer height in pixels, for the screen size of the level of detail errors
+	float viewportHeight = 1.0f;
+	glm::vec2 mouseOffset = glm::vec2(0.0f);
+	float scrollOffset = 0.0f;
+	std::array<bool, GLFW_KEY_LAST + 1> keys{};
+
+	bool isPressed(int key) const
+	{
+		return keys[key];
+	}
+};
+
+// views a draw item is visible in, see DemoScene::cullFrame
+enum ViewMask : unsigned int
+{
+	VIEW_MAIN = 1 << 0,
+	VIEW_REFLECTED = 1 << 1,
+};
+
+// One entity to draw with the matrices it had when the frame was simulated
+struct DrawItem
+{
+	RenderMesh* mesh;
+	glm::mat4 model;
+	glm::mat3 normalModel;
+	// views the material draws the item in
+	unsigned int views = VIEW_MAIN | VIEW_REFLECTED;
+	// set when the item hides others from the occlusion culler
+	const OccluderMesh* occluder = nullptr;
+	// world bounds for model, see DemoScene::cullFrame
+	BoundingBox bounds;
+	unsigned int visibleViews = VIEW_MAIN | VIEW_REFLECTED;
+	// level of detail per view, see DemoScene::selectLods
+	unsigned int mainLod = 0;
+	unsigned int reflectedLod = 0;
+};
+
+struct ViewState
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 position = glm::vec3(0.0f);
+
+	bool operator==(const ViewState&) const = default;
+};
+
+// Result of simulating one frame. Written only by the simulation thread and
+// treated as immutable by the render thread until it is released.
+struct FrameSnapshot
+{
+	float time = 0.0f;
+
+	ViewState mainView;
+	ViewState reflectedView;
+
+	PointLight pointLight{};
+	SpotLight spotLight{};
+
+	unsigned int shaderFeatures = 0;
+	bool isDay = true;
+	bool useBlinn = false;
+	float fogIntensity = 0.0f;
+	float viewportHeight = 1.0f;
+	const char* cameraName = "";
+	bool paused = false;
+	float timeScale = 1.0f;
+	// ChangeCounter value the frame was recorded at; equal counts render the same image
+	uint64_t changeCount = 0;
+
+	std::vector<DrawItem> drawList;
+};
+
+// What the simulation looked like after a tick. The display blends the last
+// two of them, so motion stays smooth when ticks and frames do not line up.
+struct TickState
+{
+	const Camera* camera = nullptr;
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+	glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	float cameraZoom = 45.0f;
+
+	SpotLight spotLight{};
+	// model matrix of every entity, in draw list order
+	std::vector<glm::mat4> models;
+};
+
+// What rendering the last frame took, counted while drawing
+struct RenderStats
+{
+	unsigned int drawCalls = 0;
+	uint64_t triangles = 0;
+	// object draws over all passes
+	unsigned int objects = 0;
+	// object draws skipped because they were outside the view or hidden behind an occluder
+	unsigned int culledObjects = 0;
+	// meshes of drawn objects skipped because their own bounds were outside the view
+	unsigned int culledMeshes = 0;
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <iostream>
+
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+// OpenGL 4.6 core context that needs no window system, for build servers and
+// automated runs. Uses a surfaceless EGL display (Mesa llvmpipe works) and
+// falls back to a hidden GLFW window on Windows, where EGL is not available.
+// There is no default framebuffer to draw to, so everything goes into FBOs.
+class HeadlessContext
+{
+public:
+	HeadlessContext()
+	{
+#ifdef _WIN32
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		window = glfwCreateWindow(1, 1, "Headless", NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "ERROR::HEADLESS_CONTEXT::WINDOW_NOT_CREATED" << std::endl;
+			return;
+		}
+		glfwMakeContextCurrent(window);
+		valid = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+#else
+		display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+		{
+			std::cout << "ERROR::HEADLESS_CONTEXT::NO_SURFACELESS_DISPLAY" << std::endl;
+			return;
+		}
+
+		// the default surface type is EGL_WINDOW_BIT, which a surfaceless display has no configs for
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+		{
+			std::cout << "ERROR::HEADLESS_CONTEXT::NO_CONFIG" << std::endl;
+			return;
+		}
+
+		eglBindAPI(EGL_OPENGL_API);
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 6,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			// llvmpipe stops at 4.5 unless told otherwise, see the README
+			std::cout << "ERROR::HEADLESS_CONTEXT::CONTEXT_NOT_CREATED no OpenGL 4.6 core context, on Mesa llvmpipe set MESA_GL_VERSION_OVERRIDE=4.6 MESA_GLSL_VERSION_OVERRIDE=460" << std::endl;
+			return;
+		}
+		valid = gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+#endif
+		if (!valid)
+			std::cout << "Failed to initialize GLAD" << std::endl;
+	}
+
+	~HeadlessContext()
+	{
+#ifdef _WIN32
+		glfwTerminate();
+#else
+		if (display != EGL_NO_DISPLAY)
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT)
+				eglDestroyContext(display, context);
+			eglTerminate(display);
+		}
+#endif
+	}
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	bool isValid() const
+	{
+		return valid;
+	}
+
+	// same loader gladLoadGLLoader was given, for extension entry points
+	static GLADloadproc getLoader()
+	{
+#ifdef _WIN32
+		return (GLADloadproc)glfwGetProcAddress;
+#else
+		return (GLADloadproc)eglGetProcAddress;
+#endif
+	}
+
+private:
+	bool valid = false;
+#ifdef _WIN32
+	GLFWwindow* window = NULL;
+#else
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Writers for captured frames. Pixels are RGBA8 rows of `stride` bytes
+// starting at `pixels`; a negative stride walks bottom-up data, e.g. straight
+// from glReadPixels, top down. Alpha is dropped, captures are opaque.
+
+inline void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool writeImageFile(const std::string& path, const std::vector<uint8_t>& data)
+{
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!file)
+	{
+		std::cout << "ERROR::IMAGE_WRITER::CANNOT_WRITE: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+inline uint32_t pngCrc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static const std::array<uint32_t, 256> table = []
+		{
+			std::array<uint32_t, 256> table{};
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+			return table;
+		}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+// QOI, "the Quite OK Image format": lossless, a fraction of the size of raw
+// pixels and encodes many times faster than deflate
+inline bool writeQoi(const std::string& path, const uint8_t* pixels, int width, int height, ptrdiff_t stride)
+{
+	struct Pixel
+	{
+		uint8_t r, g, b, a;
+
+		bool operator==(const Pixel&) const = default;
+	};
+
+	std::vector<uint8_t> out;
+	out.reserve(14 + static_cast<size_t>(width) * height * 4 / 3 + 8);
+	out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+	appendBigEndian(out, width);
+	appendBigEndian(out, height);
+	// RGB, sRGB color space
+	out.push_back(3);
+	out.push_back(0);
+
+	std::array<Pixel, 64> index{};
+	Pixel previous = { 0, 0, 0, 255 };
+	unsigned int run = 0;
+
+	for (int y = 0; y < height; y++)
+	{
+		const uint8_t* row = pixels + y * stride;
+		for (int x = 0; x < width; x++)
+		{
+			const Pixel pixel = { row[x * 4], row[x * 4 + 1], row[x * 4 + 2], 255 };
+			if (pixel == previous)
+			{
+				if (++run == 62)
+				{
+					out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			const unsigned int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+			if (index[hash] == pixel)
+				out.push_back(static_cast<uint8_t>(hash));
+			else
+			{
+				index[hash] = pixel;
+
+				const int8_t dr = static_cast<int8_t>(pixel.r - previous.r);
+				const int8_t dg = static_cast<int8_t>(pixel.g - previous.g);
+				const int8_t db = static_cast<int8_t>(pixel.b - previous.b);
+				const int drg = dr - dg;
+				const int dbg = db - dg;
+
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					out.push_back(static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+				else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+				{
+					out.push_back(static_cast<uint8_t>(0x80 | (dg + 32)));
+					out.push_back(static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)));
+				}
+				else
+					out.insert(out.end(), { 0xFE, pixel.r, pixel.g, pixel.b });
+			}
+			previous = pixel;
+		}
+	}
+	if (run > 0)
+		out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+	out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+	return writeImageFile(path, out);
+}
+
+// PNG with stored (uncompressed) deflate blocks, readable everywhere but as
+// large as raw pixels; prefer QOI when size matters
+inline bool writePng(const std::string& path, const uint8_t* pixels, int width, int height, ptrdiff_t stride)
+{
+	// zlib stream of the filtered rows: a filter type byte (0 = none) and RGB per row
+	std::vector<uint8_t> raw;
+	raw.reserve(static_cast<size_t>(height) * (1 + width * 3));
+	for (int y = 0; y < height; y++)
+	{
+		const uint8_t* row = pixels + y * stride;
+		raw.push_back(0);
+		for (int x = 0; x < width; x++)
+			raw.insert(raw.end(), { row[x * 4], row[x * 4 + 1], row[x * 4 + 2] });
+	}
+
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	uint32_t adlerA = 1, adlerB = 0;
+	for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+	{
+		const size_t length = std::min<size_t>(65535, raw.size() - offset);
+		const bool last = offset + length >= raw.size();
+		zlib.insert(zlib.end(), { static_cast<uint8_t>(last ? 1 : 0),
+			static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+			static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8) });
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+		for (size_t i = offset; i < offset + length; i++)
+		{
+			adlerA = (adlerA + raw[i]) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+		if (last)
+			break;
+	}
+	appendBigEndian(zlib, adlerB << 16 | adlerA);
+
+	std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	auto chunk = [&out](const char* type, const std::vector<uint8_t>& data)
+		{
+			appendBigEndian(out, static_cast<uint32_t>(data.size()));
+			const size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			appendBigEndian(out, pngCrc32(out.data() + start, out.size() - start));
+		};
+
+	std::vector<uint8_t> header;
+	appendBigEndian(header, width);
+	appendBigEndian(header, height);
+	// 8 bit RGB, deflate, adaptive filtering, no interlace
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+	chunk("IHDR", header);
+	chunk("IDAT", zlib);
+	chunk("IEND", {});
+
+	return writeImageFile(path, out);
+}
+
+// appends the frame as top-down RGBA rows, e.g. to a pipe into a video encoder
+inline bool writeRaw(std::ostream& stream, const uint8_t* pixels, int width, int height, ptrdiff_t stride)
+{
+	for (int y = 0; y < height; y++)
+		stream.write(reinterpret_cast<const char*>(pixels + y * stride), static_cast<std::streamsize>(width) * 4);
+	return static_cast<bool>(stream);
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Counts unfinished jobs. A job submitted with a counter increments it and
+// decrements it when done; jobs that depend on a counter only start once it
+// has dropped back to zero.
+class JobCounter
+{
+	friend class JobSystem;
+
+	std::atomic<int> value{ 0 };
+	std::mutex mutex;
+	std::vector<std::function<void()>> continuations;
+
+public:
+	bool isDone() const
+	{
+		return value.load(std::memory_order_acquire) == 0;
+	}
+};
+
+// Timing of one finished job, reported to the timing hook
+struct JobTiming
+{
+	const char* name;
+	// 0 for the thread that owns the job system, 1..N for the workers
+	unsigned int thread;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point end;
+};
+
+// Work-stealing job scheduler. Every worker owns a deque: it pushes and pops
+// its own jobs at the back and steals from the front of the others when it
+// runs dry. Threads waiting on a counter help by running jobs instead of
+// blocking, so jobs may wait on jobs they spawned.
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+	using TimingHook = std::function<void(const JobTiming&)>;
+
+	// threadCount workers in addition to the calling thread; 0 picks one less than the hardware threads
+	JobSystem(unsigned int threadCount = 0)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+		// queue 0 belongs to the threads outside the pool
+		for (unsigned int i = 0; i <= threadCount; i++)
+			queues.push_back(std::make_unique<Queue>());
+		for (unsigned int i = 1; i <= threadCount; i++)
+			workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int getThreadCount() const
+	{
+		return static_cast<unsigned int>(workers.size()) + 1;
+	}
+
+	// called on the executing thread after every job; set before submitting work
+	void setTimingHook(TimingHook hook)
+	{
+		timingHook = std::move(hook);
+	}
+
+	// schedules a job; counter (optional) tracks its completion and the job is held
+	// back until dependency (optional) is done
+	void run(Job job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr, const char* name = "job")
+	{
+		if (counter)
+			counter->value.fetch_add(1, std::memory_order_relaxed);
+
+		Task task{ std::move(job), counter, name };
+		if (dependency)
+		{
+			std::unique_lock<std::mutex> lock(dependency->mutex);
+			if (!dependency->isDone())
+			{
+				dependency->continuations.push_back([this, task = std::move(task)]() mutable { push(std::move(task)); });
+				return;
+			}
+		}
+		push(std::move(task));
+	}
+
+	// runs other jobs until the counter reaches zero; only after this returns may the counter be destroyed
+	void wait(JobCounter& counter)
+	{
+		while (!counter.isDone())
+		{
+			Task task;
+			if (tryPop(task))
+				execute(task);
+			else
+				std::this_thread::yield();
+		}
+		// the last job decrements under the lock, so once we own it nobody touches the counter anymore
+		std::lock_guard<std::mutex> lock(counter.mutex);
+	}
+
+	// calls body(begin, end) over [0, count) in chunks of at most grainSize and waits for all of them;
+	// small ranges run inline on the calling thread
+	template<typename Body>
+	void parallel_for(size_t count, size_t grainSize, const Body& body, const char* name = "parallel_for")
+	{
+		grainSize = std::max<size_t>(grainSize, 1);
+		if (count <= grainSize || workers.empty())
+		{
+			if (count > 0)
+				body(size_t(0), count);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t begin = grainSize; begin < count; begin += grainSize)
+		{
+			const size_t end = std::min(begin + grainSize, count);
+			run([&body, begin, end] { body(begin, end); }, &counter, nullptr, name);
+		}
+		// the calling thread takes the first chunk itself
+		body(size_t(0), grainSize);
+		wait(counter);
+	}
+
+private:
+	struct Task
+	{
+		Job job;
+		JobCounter* counter = nullptr;
+		const char* name = "job";
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	TimingHook timingHook;
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	std::atomic<int> queuedTasks{ 0 };
+	bool stopping = false;
+
+	// index of the calling thread's queue: workers own 1..N, everyone else shares 0
+	static unsigned int& threadIndex()
+	{
+		static thread_local unsigned int index = 0;
+		return index;
+	}
+
+	void push(Task task)
+	{
+		Queue& queue = *queues[threadIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(std::move(task));
+		}
+		queuedTasks.fetch_add(1, std::memory_order_release);
+		{
+			// taking the lock orders this notify after a worker's check of queuedTasks
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wakeUp.notify_one();
+	}
+
+	bool tryPop(Task& task)
+	{
+		const unsigned int own = threadIndex();
+		{
+			// newest job of our own queue first, it is the most likely to be in cache
+			Queue& queue = *queues[own];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// steal the oldest job of another queue
+		const size_t count = queues.size();
+		for (size_t offset = 1; offset < count; offset++)
+		{
+			Queue& victim = *queues[(own + offset) % count];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty())
+			{
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void execute(Task& task)
+	{
+		if (timingHook)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			task.job();
+			timingHook({ task.name, threadIndex(), start, std::chrono::steady_clock::now() });
+		}
+		else
+			task.job();
+
+		if (task.counter)
+			finish(*task.counter);
+	}
+
+	void finish(JobCounter& counter)
+	{
+		std::vector<std::function<void()>> ready;
+		{
+			std::lock_guard<std::mutex> lock(counter.mutex);
+			if (counter.value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+			ready.swap(counter.continuations);
+		}
+		for (auto& continuation : ready)
+			continuation();
+	}
+
+	void workerLoop(unsigned int index)
+	{
+		threadIndex() = index;
+		while (true)
+		{
+			Task task;
+			if (tryPop(task))
+			{
+				execute(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wakeUp.wait(lock, [this] { return stopping || queuedTasks.load(std::memory_order_acquire) > 0; });
+			if (stopping)
+				return;
+		}
+	}
+};
@@ -0,0 +1,363 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "aabb_tree.h"
+#include "job_system.h"
+
+// Loose octree over static boxes, built in one go instead of insert by insert.
+// A box goes into the deepest cell that holds its center and is at least as
+// large as the box, which is enough because every cell reaches half a cell
+// beyond its edges. The cells are sorted by their Morton code and depth, which
+// puts the nodes in depth first order in one array, each with the index of the
+// node after its subtree and the range of the subtree's boxes. Queries walk
+// that array front to back and skip rejected subtrees, and a subtree completely
+// inside the frustum reports its boxes without testing them. Node boxes are the
+// tight bounds of the subtree, not the loose cell.
+class LooseOctree
+{
+public:
+	// 3 bits per level of the Morton code have to fit in 64 bits next to the depth
+	static constexpr unsigned int maxDepth = 10;
+
+	// the depth is limited so a cell at the deepest level holds about objectsPerCell small boxes
+	LooseOctree(unsigned int objectsPerCell = 4)
+		: objectsPerCell(std::max(1u, objectsPerCell))
+	{
+	}
+
+	// replaces the contents with boxes; the index of a box is its user data in the queries
+	void build(const std::vector<BoundingBox>& boxes, JobSystem& jobSystem)
+	{
+		nodes.clear();
+		objectBoxes.clear();
+		objectIds.clear();
+		const uint32_t count = static_cast<uint32_t>(boxes.size());
+		if (count == 0)
+			return;
+
+		const size_t chunkCount = std::max<size_t>(1, jobSystem.getThreadCount() * 4);
+		const size_t grainSize = std::max<size_t>(minGrainSize, (count + chunkCount - 1) / chunkCount);
+
+		// bounds of all centers, one box per chunk
+		std::vector<BoundingBox> chunkBounds((count + grainSize - 1) / grainSize);
+		jobSystem.parallel_for(count, grainSize, [&](size_t begin, size_t end)
+			{
+				BoundingBox bounds;
+				for (size_t i = begin; i < end; i++)
+				{
+					const glm::vec3 center = (boxes[i].min + boxes[i].max) * 0.5f;
+					bounds.min = glm::min(bounds.min, center);
+					bounds.max = glm::max(bounds.max, center);
+				}
+				chunkBounds[begin / grainSize] = bounds;
+			}, "octree bounds");
+		BoundingBox bounds;
+		for (const BoundingBox& chunk : chunkBounds)
+			bounds = BoundingBox::merge(bounds, chunk);
+		origin = bounds.min;
+		const glm::vec3 size = bounds.max - bounds.min;
+		rootSize = std::max(std::max(std::max(size.x, size.y), size.z), 1e-6f);
+
+		depth = 0;
+		while (depth < maxDepth && (uint64_t(1) << (3 * depth)) * objectsPerCell < count)
+			depth++;
+
+		std::vector<Entry> entries(count);
+		jobSystem.parallel_for(count, grainSize, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					entries[i] = { getKey(boxes[i]), static_cast<uint32_t>(i) };
+			}, "octree keys");
+
+		// sort the chunks in parallel, then merge pairs of sorted runs until one is left
+		auto less = [](const Entry& a, const Entry& b) { return a.key < b.key || (a.key == b.key && a.index < b.index); };
+		jobSystem.parallel_for(count, grainSize, [&](size_t begin, size_t end)
+			{
+				std::sort(entries.begin() + begin, entries.begin() + end, less);
+			}, "octree sort");
+		std::vector<Entry> merged(count);
+		for (size_t width = grainSize; width < count; width *= 2)
+		{
+			jobSystem.parallel_for(count, 2 * width, [&](size_t begin, size_t end)
+				{
+					const size_t middle = std::min(begin + width, end);
+					std::merge(entries.begin() + begin, entries.begin() + middle, entries.begin() + middle, entries.begin() + end, merged.begin() + begin, less);
+				}, "octree merge");
+			entries.swap(merged);
+		}
+
+		objectBoxes.resize(count);
+		objectIds.resize(count);
+		jobSystem.parallel_for(count, grainSize, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					objectBoxes[i] = boxes[entries[i].index];
+					objectIds[i] = entries[i].index;
+				}
+			}, "octree objects");
+
+		// the path from the root to the current node, one node per depth
+		std::vector<uint32_t> parents;
+		std::vector<uint64_t> codes;
+		std::array<uint32_t, maxDepth + 1> path;
+		unsigned int pathLength = 0;
+		auto close = [&](uint32_t node, uint32_t objectEnd)
+			{
+				nodes[node].next = static_cast<uint32_t>(nodes.size());
+				nodes[node].objectEnd = objectEnd;
+			};
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const unsigned int objectDepth = static_cast<unsigned int>(entries[i].key & depthMask);
+			const uint64_t code = entries[i].key >> depthBits;
+
+			// leave the nodes that are not ancestors of the object's cell
+			while (pathLength > 0 && (pathLength - 1 > objectDepth || codes[path[pathLength - 1]] != getCellCode(code, pathLength - 1)))
+			{
+				pathLength--;
+				close(path[pathLength], i);
+			}
+			while (pathLength <= objectDepth)
+			{
+				Node node;
+				node.objectBegin = i;
+				node.ownEnd = i;
+				node.depth = pathLength;
+				parents.push_back(pathLength > 0 ? path[pathLength - 1] : 0);
+				codes.push_back(getCellCode(code, pathLength));
+				path[pathLength++] = static_cast<uint32_t>(nodes.size());
+				nodes.push_back(node);
+			}
+			nodes[path[objectDepth]].ownEnd = i + 1;
+		}
+		while (pathLength > 0)
+		{
+			pathLength--;
+			close(path[pathLength], count);
+		}
+
+		// own boxes in parallel, then children into parents, which always come first
+		jobSystem.parallel_for(nodes.size(), std::max<size_t>(minGrainSize / 8, (nodes.size() + chunkCount - 1) / chunkCount), [&](size_t begin, size_t end)
+			{
+				for (size_t n = begin; n < end; n++)
+				{
+					BoundingBox box;
+					for (uint32_t i = nodes[n].objectBegin; i < nodes[n].ownEnd; i++)
+						box = BoundingBox::merge(box, objectBoxes[i]);
+					nodes[n].box = box;
+				}
+			}, "octree bounds");
+		for (size_t n = nodes.size() - 1; n > 0; n--)
+			nodes[parents[n]].box = BoundingBox::merge(nodes[parents[n]].box, nodes[n].box);
+	}
+
+	size_t size() const
+	{
+		return objectIds.size();
+	}
+
+	size_t getNodeCount() const
+	{
+		return nodes.size();
+	}
+
+	// deepest level boxes can be placed at, 0 when everything is in the root
+	unsigned int getDepth() const
+	{
+		return depth;
+	}
+
+	// calls callback(userData) for every box overlapping the box until it returns false
+	template<typename Callback>
+	void query(const BoundingBox& box, Callback&& callback) const
+	{
+		traverse([&box](const BoundingBox& nodeBox) { return nodeBox.overlaps(box); }, callback);
+	}
+
+	// calls callback(userData) for every box overlapping the sphere until it returns false
+	template<typename Callback>
+	void querySphere(const glm::vec3& center, float radius, Callback&& callback) const
+	{
+		traverse([&center, radius](const BoundingBox& nodeBox)
+			{
+				const glm::vec3 offset = center - glm::clamp(center, nodeBox.min, nodeBox.max);
+				return glm::dot(offset, offset) <= radius * radius;
+			}, callback);
+	}
+
+	// calls callback(userData, maxDistance) for every box the ray hits before maxDistance;
+	// the callback returns the new maxDistance, e.g. the distance of its own hit to find
+	// the closest one, or 0 to stop. direction has to be normalized.
+	template<typename Callback>
+	void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const
+	{
+		const glm::vec3 inverse = 1.0f / direction;
+		auto hit = [&](const BoundingBox& box)
+			{
+				// slab test
+				const glm::vec3 t0 = (box.min - origin) * inverse;
+				const glm::vec3 t1 = (box.max - origin) * inverse;
+				const glm::vec3 tMin = glm::min(t0, t1);
+				const glm::vec3 tMax = glm::max(t0, t1);
+				const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+				const float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+				return enter <= exit;
+			};
+
+		uint32_t index = 0;
+		while (index < nodes.size() && maxDistance > 0.0f)
+		{
+			const Node& node = nodes[index];
+			if (!hit(node.box))
+			{
+				index = node.next;
+				continue;
+			}
+			for (uint32_t i = node.objectBegin; i < node.ownEnd && maxDistance > 0.0f; i++)
+			{
+				if (hit(objectBoxes[i]))
+					maxDistance = callback(objectIds[i], maxDistance);
+			}
+			index++;
+		}
+	}
+
+	// calls callback(userData) for every box at least partly in the frustum; returns how
+	// many nodes were visited
+	template<typename Callback>
+	unsigned int cull(const ViewFrustum& frustum, Callback&& callback) const
+	{
+		// planes the last visited node of each depth was not completely inside of
+		std::array<unsigned int, maxDepth + 2> masks;
+		masks[0] = ViewFrustum::allPlanes;
+		unsigned int visited = 0;
+		uint32_t index = 0;
+		while (index < nodes.size())
+		{
+			const Node& node = nodes[index];
+			visited++;
+			unsigned int mask = masks[node.depth];
+			if (!frustum.test(node.box, mask))
+			{
+				index = node.next;
+				continue;
+			}
+
+			// once inside all planes the whole subtree is accepted without further tests
+			if (mask == 0)
+			{
+				for (uint32_t i = node.objectBegin; i < node.objectEnd; i++)
+					callback(objectIds[i]);
+				index = node.next;
+				continue;
+			}
+
+			for (uint32_t i = node.objectBegin; i < node.ownEnd; i++)
+			{
+				unsigned int objectMask = mask;
+				if (frustum.test(objectBoxes[i], objectMask))
+					callback(objectIds[i]);
+			}
+			masks[node.depth + 1] = mask;
+			index++;
+		}
+		return visited;
+	}
+
+private:
+	static constexpr unsigned int depthBits = 4;
+	static constexpr uint64_t depthMask = (1u << depthBits) - 1;
+	static constexpr size_t minGrainSize = 4096;
+
+	struct Node
+	{
+		BoundingBox box;
+		// the node's own boxes are [objectBegin, ownEnd), its subtree's [objectBegin, objectEnd)
+		uint32_t objectBegin = 0;
+		uint32_t ownEnd = 0;
+		uint32_t objectEnd = 0;
+		// the first node after the subtree
+		uint32_t next = 0;
+		uint32_t depth = 0;
+	};
+
+	struct Entry
+	{
+		// Morton code of the cell at the deepest level above the depth of the cell
+		uint64_t key;
+		uint32_t index;
+	};
+
+	std::vector<Node> nodes;
+	// sorted like the nodes that own them
+	std::vector<BoundingBox> objectBoxes;
+	std::vector<uint32_t> objectIds;
+	unsigned int objectsPerCell;
+	unsigned int depth = 0;
+	glm::vec3 origin = glm::vec3(0.0f);
+	float rootSize = 1.0f;
+
+	// spreads the lower 10 bits so two zero bits follow each of them
+	static uint64_t spreadBits(uint32_t value)
+	{
+		uint64_t bits = value & 0x3FF;
+		bits = (bits | (bits << 16)) & 0x030000FF;
+		bits = (bits | (bits << 8)) & 0x0300F00F;
+		bits = (bits | (bits << 4)) & 0x030C30C3;
+		bits = (bits | (bits << 2)) & 0x09249249;
+		return bits;
+	}
+
+	// code of the cell at cellDepth that contains the cell with code at the deepest level
+	uint64_t getCellCode(uint64_t code, unsigned int cellDepth) const
+	{
+		return code >> (3 * (depth - cellDepth));
+	}
+
+	uint64_t getKey(const BoundingBox& box) const
+	{
+		// the deepest cell that is as large as the box
+		const glm::vec3 extents = box.max - box.min;
+		const float size = std::max(std::max(extents.x, extents.y), extents.z);
+		unsigned int boxDepth = 0;
+		float cellSize = rootSize * 0.5f;
+		while (boxDepth < depth && size <= cellSize)
+		{
+			boxDepth++;
+			cellSize *= 0.5f;
+		}
+
+		const float cells = static_cast<float>(1u << boxDepth);
+		const glm::vec3 cell = glm::clamp(glm::floor(((box.min + box.max) * 0.5f - origin) / rootSize * cells), glm::vec3(0.0f), glm::vec3(cells - 1.0f));
+		const uint64_t code = spreadBits(static_cast<uint32_t>(cell.x)) | (spreadBits(static_cast<uint32_t>(cell.y)) << 1) | (spreadBits(static_cast<uint32_t>(cell.z)) << 2);
+		return (code << (3 * (depth - boxDepth)) << depthBits) | boxDepth;
+	}
+
+	// depth first through every node accepted by overlaps until callback returns false
+	template<typename Overlaps, typename Callback>
+	void traverse(Overlaps&& overlaps, Callback&& callback) const
+	{
+		uint32_t index = 0;
+		while (index < nodes.size())
+		{
+			const Node& node = nodes[index];
+			if (!overlaps(node.box))
+			{
+				index = node.next;
+				continue;
+			}
+			for (uint32_t i = node.objectBegin; i < node.ownEnd; i++)
+			{
+				if (overlaps(objectBoxes[i]) && !callback(objectIds[i]))
+					return;
+			}
+			index++;
+		}
+	}
+};
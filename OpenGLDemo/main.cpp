@@ -13,56 +13,104 @@
 #include <learnopengl/model.h>
 #pragma warning(pop)
 
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include <optional>
 
-#include "objects.h"
-#include "skybox.h"
-#include "mirror.h"
-#include "lights.h"
+#include "scene.h"
+#include "frame_pipeline.h"
+#include "simulation_clock.h"
+#include "frame_pacer.h"
+#include "stats_overlay.h"
+#include "render_target.h"
+#include "resolution_scaler.h"
+#include "anti_aliasing.h"
+#include "frame_capture.h"
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
+InputState captureInput(GLFWwindow* window, float time);
+void processInput(const InputState& input);
+void updateSimulation(const InputState& input, DemoScene& scene, float tickDuration, float time);
+void captureTickState(DemoScene& scene, TickState& state);
 unsigned int loadTexture(const char* path);
-unsigned int loadCubemap(const std::vector<std::string>& faces);
-void setWindowTitle(GLFWwindow* window);
-void drawSkybox(Skybox& skybox, Shader& shader, unsigned int cubemapTexture, glm::mat4 view, glm::mat4 projection);
-glm::vec3 calculateFlashlightPositionAndAngle(float time, float& angle);
-void setCameras(const glm::mat4& flashLightModel);
-void drawObjects(Shader& shader, const std::vector<Object*>& objects);
-
-void drawScene(Shader& lightingShader, Shader& skyboxShader, Skybox& skybox, const vector<Object*>& objects, const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPos, unsigned int cubemapTexture);
-glm::mat4 setFlashlight(SpotlightObject& flashlight, SpotLight& spotlight, float currentFrame);
+void setWindowTitle(GLFWwindow* window, const FrameSnapshot& frame);
+unsigned int getShaderFeatures();
+void simulateFrame(const InputState& input, DemoScene& scene, FrameSnapshot& frame);
+std::string getCapturePath(bool recording);
 
 // settings
 unsigned int SCR_WIDTH = 1600;
 unsigned int SCR_HEIGHT = 1200;
+// how many frames the simulation thread may run ahead of rendering (0 = no simulation thread)
+unsigned int simulationPipelineDepth = 1;
+// CPU/GPU timings of the last frames are written here on exit (nullptr = no trace)
+const char* profileTracePath = "profile_trace.json";
+// how many frames the GPU may queue before the render loop waits for it; lower means less input latency
+unsigned int maxFramesInFlight = 2;
+SwapMode swapMode = SwapMode::VSync;
+// frames per second, 0 = unlimited
+double frameRateLimit = 0.0;
+// frame time graph, draw counts and pass timings on screen, toggled with F3
+bool showStats = true;
+// the scene is rendered offscreen and scaled to the window, which has no multisampling itself;
+// selectable with --aa none|msaa2|msaa4|msaa8|fxaa
+AntiAliasing antiAliasing = AntiAliasing::Msaa4;
+// lower the render resolution while the GPU needs more than gpuFrameBudget milliseconds per frame
+bool dynamicResolution = true;
+double gpuFrameBudget = 12.0;
+float minResolutionScale = 0.5f;
+// skip rendering and swapping while nothing on screen would change, see ChangeCounter
+bool idleFrameElision = true;
+// longest sleep of an idle frame in seconds; input wakes the loop earlier
+double idleWaitTimeout = 0.1;
+// F12 saves a screenshot, F11 starts and stops recording every frame; selectable with --capture png|qoi|raw
+CaptureFormat captureFormat = CaptureFormat::Qoi;
+const char* captureDirectory = "Captures";
+bool screenshotRequested = false;
+bool recordingFrames = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 0.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+// mouse movement accumulated by the callbacks since the last captured input
+glm::vec2 pendingMouseOffset = glm::vec2(0.0f);
+float pendingScrollOffset = 0.0f;
+
+// worker threads shared by everything that runs in parallel
+JobSystem jobSystem;
+
+// profiling
+Profiler profiler;
 
 // timing
-float deltaTime = 0.0f;
+// the simulation runs in fixed ticks; rendering blends the last two of them
+SimulationClock simulationClock(60.0);
+// advance exactly one tick per frame instead of following real time, for reproducible profiling runs
+bool lockstepSimulation = false;
 float lastFrame = 0.0f;
+TickState previousTick;
+TickState currentTick;
 
 
 // planes
 float nearPlane = 0.1f;
 float farPlane = 100.0f;
 
+// cameras, placed by the scene file
 // free camera
 Camera freeCamera;
 // still camera
-Camera stillCamera(glm::vec3(-10.0f, 4.0f, 12.0f));
+Camera stillCamera;
 // still following camera
-Camera pointedCamera(glm::vec3(8.0f, 4.0f, 9.0f));
+Camera pointedCamera;
 // attached camera
-Camera attachedCamera(glm::vec3(0.0f, 0.0f, 0.0f));
+Camera attachedCamera;
 
 Camera* activeCamera = &stillCamera;
 std::vector<Camera*> cameras = { &stillCamera, &pointedCamera, &attachedCamera, &freeCamera };
@@ -71,22 +119,59 @@ size_t activeCameraIndex = 0;
 bool isDay = true;
 bool useBlinn = false;
 float fogIntensity = 0.0f;
-glm::vec3 fogColor = glm::vec3(0.8f);
 float relativeReflectorAngleX = 0.0f;
 float relativeReflectorAngleY = 0.0f;
 
 
 
 
-int main()
+int main(int argc, char* argv[])
 {
+	std::string scenePath = FileSystem::getPath("Resources/scenes/demo.scene");
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--scene" && i + 1 < argc)
+		{
+			scenePath = argv[++i];
+			continue;
+		}
+		// compiles a text scene into the binary form and exits
+		if (std::string(argv[i]) == "--compile-scene" && i + 2 < argc)
+			return SceneFile::compile(argv[i + 1], argv[i + 2]) ? 0 : -1;
+		if (std::string(argv[i]) == "--aa" && i + 1 < argc && parseAntiAliasing(argv[i + 1], antiAliasing))
+		{
+			i++;
+			continue;
+		}
+		if (std::string(argv[i]) == "--capture" && i + 1 < argc)
+		{
+			const std::string format = argv[++i];
+			if (format == "png")
+				captureFormat = CaptureFormat::Png;
+			else if (format == "qoi")
+				captureFormat = CaptureFormat::Qoi;
+			else if (format == "raw")
+				captureFormat = CaptureFormat::Raw;
+			else
+				i = argc;
+			if (i < argc)
+				continue;
+		}
+		std::cout << "Usage: OpenGLDemo [--aa none|msaa2|msaa4|msaa8|fxaa] [--capture png|qoi|raw] [--scene FILE]\n"
+			"       OpenGLDemo --compile-scene TEXT_FILE BINARY_FILE" << std::endl;
+		return -1;
+	}
+
+	SceneFile sceneFile;
+	if (!sceneFile.load(scenePath))
+		return -1;
+
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_SAMPLES, 4);
 
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -107,6 +192,12 @@ int main()
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
 
+	// the framebuffer can be larger than the window on high DPI displays
+	int framebufferWidth, framebufferHeight;
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	SCR_WIDTH = framebufferWidth;
+	SCR_HEIGHT = framebufferHeight;
+
 	// tell GLFW to capture our mouse
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -117,243 +208,208 @@ int main()
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	ProgramBuild::enableParallelCompile((GLADloadproc)glfwGetProcAddress);
 
-	// configure global opengl state
-	// -----------------------------
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_MULTISAMPLE);
-	glEnable(GL_STENCIL_TEST);
-	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-
-	// build and compile shaders
-	// -------------------------
-	Shader skyboxShader("Shaders/skybox_shader.vert", "Shaders/skybox_shader.frag");
-	Shader lightingShader("Shaders/lighting_shader.vert", "Shaders/lighting_shader.frag");
-	Shader constantShader("Shaders/constant_shader.vert", "Shaders/constant_shader.frag");
-
-	// load models
-	// -----------
-	Model sphereModel(FileSystem::getPath("Resources/objects/sphere/sphere.obj"));
-	Model lanternModel(FileSystem::getPath("Resources/objects/lantern/lantern.obj"));
-	Model flashlightModel(FileSystem::getPath("Resources/objects/flashlight/flashlight.obj"));
-	Model floorModel(FileSystem::getPath("Resources/objects/floor/floor.obj"));
-	Model houseModel(FileSystem::getPath("Resources/objects/house/house.obj"));
-
-	Object sphere(sphereModel);
-	Object floor(floorModel);
-	Object house(houseModel);
-
-
-	LightObject lantern(lanternModel);
-	//lantern.position = glm::vec3(1.0f, 0.0f, 5.0f);
-	lantern.lightPositionOffset = glm::vec3(0.0f, 460.0f, 0.0f);
-	constexpr glm::vec3 lanternPosition = glm::vec3(1.0f, 0.0f, 5.0f);
-
-	SpotlightObject flashlight(flashlightModel);
-	flashlight.lightPositionOffset = glm::vec3(0.0f, -0.004f, 0.08f);
-	flashlight.lightDirection = glm::vec3(0.0f, 0.0f, 1.0f);
-
-	std::vector<Object*> objects = { &flashlight, &sphere, &lantern, &house, &floor };
-
-
-	// load skybox
-	// -----------
-	Skybox skybox;
-
-	vector<std::string> dayFaces
-	{
-		FileSystem::getPath("Resources/textures/skybox/right.jpg"),
-		FileSystem::getPath("Resources/textures/skybox/left.jpg"),
-		FileSystem::getPath("Resources/textures/skybox/top.jpg"),
-		FileSystem::getPath("Resources/textures/skybox/bottom.jpg"),
-		FileSystem::getPath("Resources/textures/skybox/front.jpg"),
-		FileSystem::getPath("Resources/textures/skybox/back.jpg")
-	};
-
-	vector<std::string> nightFaces
-	{
-		FileSystem::getPath("Resources/textures/night_skybox/right.png"),
-		FileSystem::getPath("Resources/textures/night_skybox/left.png"),
-		FileSystem::getPath("Resources/textures/night_skybox/top.png"),
-		FileSystem::getPath("Resources/textures/night_skybox/bottom.png"),
-		FileSystem::getPath("Resources/textures/night_skybox/front.png"),
-		FileSystem::getPath("Resources/textures/night_skybox/back.png")
-	};
-
-	unsigned int cubemapDayTexture = loadCubemap(dayFaces);
-	unsigned int cubemapNightTexture = loadCubemap(nightFaces);
-
-
-
-	// mirror vertex data
-	float mirrorVertices[] = {
-		// positions        
-		-1.4f, -1.0f, 0.0f,
-		-1.4f, 1.0f, 0.0f,
-		 1.4f,  1.0f, 0.0f,
-
-		 1.4f,  1.0f, 0.0f,
-		 1.4f, -1.0f, 0.0f,
-		 -1.4f, -1.0f, 0.0f,
-	};
-
-	Mirror mirror(mirrorVertices, sizeof(mirrorVertices));
-
-
-	// draw in wireframe
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-	glm::mat4 model, view, projection, reflectedProjection;
-	projection = glm::perspective(glm::radians(activeCamera->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, nearPlane, farPlane);
-	reflectedProjection = glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f)) * projection;
-
-
-	DirLight dirLight;
-	dirLight.direction = glm::vec3(0.0f, -1.0f, 0.0f);
-	dirLight.color = glm::vec3(0.5);
-
-	PointLight pointLight;
-	glm::mat4 pointLightMatrix = glm::translate(glm::mat4(1), lanternPosition);
-	pointLightMatrix = glm::scale(pointLightMatrix, glm::vec3(0.005f));
-	pointLight.position = glm::vec3(pointLightMatrix * glm::vec4(lantern.lightPositionOffset, 1.0f));
-	pointLight.color = glm::vec3(1.0f);
-
-	SpotLight spotLight;
-	spotLight.color = glm::vec3(1.0f);
-	spotLight.edgeCoeff = 50;
-
-
-	// sphere model	
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(-2.0f, 1.0f, 9.5f));
-	sphere.SetModelMatrix(model);
-
-	// lantern model
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, lanternPosition);
-	model = glm::scale(model, glm::vec3(0.005f));
-	lantern.SetModelMatrix(model);
-
-	// floor model
-	floor.SetModelMatrix(glm::mat4(1.0f));
-
-	// house model
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(7.0f, 0.0f, 10.0f));
-	model = glm::rotate(model, glm::radians(225.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.2f));
-	house.SetModelMatrix(model);
-
-
-	// mirror model
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(3.0f));
-	mirror.modelMatrix = model;
-
-
-	// set light properties
-	lightingShader.use();
-	lightingShader.setVec3("dirLight.direction", dirLight.direction);
-	lightingShader.setVec3("dirLight.color", dirLight.color);
-	lightingShader.setVec3("pointLights[0].position", pointLight.position);
-	lightingShader.setVec3("pointLights[0].color", pointLight.color);
-	lightingShader.setFloat("spotLights[0].edgeCoeff", spotLight.edgeCoeff);
-	lightingShader.setVec3("spotLights[0].color", spotLight.color);
-
-	// set cameras
-	stillCamera.SetFront(glm::normalize(glm::vec3(0.8f, -0.2f, -0.5f)));
-	freeCamera = stillCamera;
-
-
-	// render loop
-	// -----------
-	while (!glfwWindowShouldClose(window))
+	// everything that owns GL objects lives in this block, so that it is released while
+	// the context still exists
 	{
-		// per-frame time logic
-		// --------------------
-		float currentFrame = static_cast<float>(glfwGetTime());
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		// input
-		// -----
-		processInput(window);
-
-		projection = glm::perspective(glm::radians(activeCamera->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		reflectedProjection = glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f)) * projection;
-
-
-		// set flashlight
-		model = setFlashlight(flashlight, spotLight, currentFrame);		
-
-		// set cameras
-		setCameras(model);
-
-
-		// render
-		// ------
-		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		glStencilMask(0x00);
-
-		lightingShader.use();
-
-		// set global uniforms
-		lightingShader.setVec3("spotLights[0].position", spotLight.position);
-		lightingShader.setVec3("spotLights[0].direction", spotLight.direction);
-		lightingShader.setBool("isDay", isDay);
-		lightingShader.setBool("useBlinn", useBlinn);
-		lightingShader.setFloat("fogIntensity", fogIntensity);
-		lightingShader.setVec3("fogColor", fogColor);
-
-		view = activeCamera->GetViewMatrix();
-
-		unsigned int cubemapTexture = isDay ? cubemapDayTexture : cubemapNightTexture;
-		drawScene(lightingShader, skyboxShader, skybox, objects, view, projection, activeCamera->Position, cubemapTexture);
-
-
-		// RENDER MIRROR
-		// -------------
-		glStencilFunc(GL_ALWAYS, 1, 0xFF);
-		glStencilMask(0xFF);
-
-		constantShader.use();
-		constantShader.setMat4("projection", projection);
-		constantShader.setMat4("view", view);
-
-		mirror.Draw(constantShader);
-
-		glStencilFunc(GL_EQUAL, 1, 0xFF);
-		glStencilMask(0x00);
-		glClear(GL_DEPTH_BUFFER_BIT);
-		// -------------
-
-
-
-		// RENDER REFLECTED OBJECTS
-		// ------------------------
-		glm::mat4 reflectorMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, -1.0f));
-		glm::vec3 viewPos = glm::vec3(reflectorMatrix * glm::vec4(activeCamera->Position, 1.0f));
-		glm::vec3 viewDir = glm::vec3(reflectorMatrix * glm::vec4(activeCamera->Front, 0.0f));
-		glm::vec3 viewUp = glm::vec3(reflectorMatrix * glm::vec4(activeCamera->Up, 0.0f));
-
-		view = glm::lookAt(viewPos, viewPos + viewDir, viewUp);
-
-		lightingShader.use();
-		drawScene(lightingShader, skyboxShader, skybox, objects, view, reflectedProjection, viewPos, cubemapTexture);
+		// profiling
+		// ---------
+		profiler.setThreadName("Render");
+		jobSystem.setTimingHook([](const JobTiming& timing) { profiler.recordJob(timing); });
+		GpuProfiler gpuProfiler(profiler);
+
+		// frame pacing
+		// ------------
+		FramePacer framePacer(maxFramesInFlight, swapMode, frameRateLimit);
+
+		// load the scene
+		// --------------
+		ProgramCache programCache("ShaderCache");
+		DemoScene scene(programCache, jobSystem, profiler, sceneFile);
+		StatsOverlay statsOverlay(programCache);
+
+		// offscreen targets
+		// -----------------
+		// allocated at the full window size; a lower resolution only uses their lower left part
+		RenderTarget sceneTarget(SCR_WIDTH, SCR_HEIGHT, getSampleCount(antiAliasing));
+		RenderTarget resolveTarget(SCR_WIDTH, SCR_HEIGHT);
+		FxaaPass fxaaPass(programCache);
+		ResolutionScaler resolutionScaler(gpuFrameBudget, minResolutionScale, 1.0f, GpuProfiler::latency + 1);
+		uint64_t lastGpuFrame = 0;
+
+		// screenshots and recordings are read back and encoded asynchronously
+		FrameCapture frameCapture;
+		bool wasRecording = false;
+
+		// set cameras; the free camera starts where the still one is
+		scene.placeCamera(stillCamera, SceneCameraRole::Still);
+		freeCamera = stillCamera;
+		scene.placeCamera(pointedCamera, SceneCameraRole::Pointed);
+		scene.placeCamera(attachedCamera, SceneCameraRole::Attached);
+
+
+		// simulation runs ahead on its own thread and hands finished frames to the render loop
+		FramePipeline pipeline(simulationPipelineDepth, [&](const InputState& input, FrameSnapshot& frame)
+			{
+				profiler.setThreadName("Simulation");
+				simulateFrame(input, scene, frame);
+			});
+		pipeline.prime(captureInput(window, static_cast<float>(glfwGetTime())));
+
+
+		// render loop
+		// -----------
+		// everything the presented image depends on
+		struct PresentState
+		{
+			uint64_t changeCount;
+			unsigned int width;
+			unsigned int height;
+			bool showStats;
+
+			bool operator==(const PresentState&) const = default;
+		};
+		std::optional<PresentState> presentedState;
+		// frames to poll for after waking up before waiting again; the first frames after
+		// a wake-up were still simulated from the input before it
+		unsigned int idlePolls = 0;
+
+		while (!glfwWindowShouldClose(window))
+		{
+			// input
+			// -----
+			// start simulating the next frame while this one is rendered
+			pipeline.submit(captureInput(window, static_cast<float>(glfwGetTime())));
+
+			const FrameSnapshot& frame = pipeline.acquire();
+
+			// set windows title with options
+			setWindowTitle(window, frame);
+
+			// a stopped recording is closed once its last frames are written
+			if (wasRecording && !recordingFrames)
+				frameCapture.endRecording();
+			wasRecording = recordingFrames;
+
+
+			// idle
+			// ----
+			// the frame would look exactly like the one on screen: keep showing it, skip the swap and sleep until input arrives
+			const PresentState presentState = { frame.changeCount, SCR_WIDTH, SCR_HEIGHT, showStats };
+			if (idleFrameElision && !recordingFrames && !screenshotRequested && presentedState == presentState)
+			{
+				pipeline.release();
+				framePacer.skipFrame();
+				// readbacks still in flight are written while idle as well
+				frameCapture.update();
+				if (idlePolls > 0)
+				{
+					idlePolls--;
+					glfwPollEvents();
+				}
+				else
+				{
+					glfwWaitEventsTimeout(idleWaitTimeout);
+					idlePolls = simulationPipelineDepth;
+				}
+				continue;
+			}
+			presentedState = presentState;
+			idlePolls = 0;
+
+			profiler.beginFrame();
+			{
+				ProfileScope waitScope(profiler, "waitForGpu");
+				framePacer.beginFrame();
+			}
+			gpuProfiler.beginFrame();
+			ProfileScope frameScope(profiler, "frame");
+
+
+			// resolution
+			// ----------
+			// feed the controller every GPU frame once, as soon as its timings are read back
+			if (gpuProfiler.getLatestFrame() != lastGpuFrame)
+			{
+				lastGpuFrame = gpuProfiler.getLatestFrame();
+				double gpuTime = 0.0;
+				for (const GpuPassTiming& pass : gpuProfiler.getLatest())
+					gpuTime += pass.milliseconds;
+				resolutionScaler.update(gpuTime);
+			}
+
+			const int windowWidth = std::max(1, static_cast<int>(SCR_WIDTH));
+			const int windowHeight = std::max(1, static_cast<int>(SCR_HEIGHT));
+			sceneTarget.resize(windowWidth, windowHeight);
+			resolveTarget.resize(windowWidth, windowHeight);
+			const float resolutionScale = dynamicResolution ? resolutionScaler.getScale() : 1.0f;
+			const int renderWidth = std::max(1, static_cast<int>(windowWidth * resolutionScale + 0.5f));
+			const int renderHeight = std::max(1, static_cast<int>(windowHeight * resolutionScale + 0.5f));
+
+
+			// render
+			// ------
+			sceneTarget.bind(renderWidth, renderHeight);
+			scene.render(frame, gpuProfiler);
+
+			// anti-alias at the render resolution, then scale to the window
+			const RenderTarget* presented = &sceneTarget;
+			if (antiAliasing == AntiAliasing::Fxaa)
+			{
+				gpuProfiler.begin("fxaa");
+				resolveTarget.bind(renderWidth, renderHeight);
+				fxaaPass.apply(sceneTarget.getColorTexture(), renderWidth, renderHeight, windowWidth, windowHeight);
+				presented = &resolveTarget;
+			}
+			else if (sceneTarget.getSamples() > 0)
+			{
+				gpuProfiler.begin("resolve");
+				sceneTarget.blitTo(resolveTarget.getFramebuffer(), renderWidth, renderHeight, renderWidth, renderHeight, GL_NEAREST);
+				presented = &resolveTarget;
+			}
+			gpuProfiler.begin("upscale");
+			presented->blitTo(0, renderWidth, renderHeight, windowWidth, windowHeight, GL_LINEAR);
+			gpuProfiler.end();
+			glViewport(0, 0, windowWidth, windowHeight);
+
+			// capture the presented image before the overlay is drawn over it
+			if (screenshotRequested || recordingFrames)
+			{
+				const std::string path = getCapturePath(recordingFrames);
+				if (frameCapture.capture(0, windowWidth, windowHeight, path, captureFormat) && screenshotRequested)
+					std::cout << "Screenshot: " << path << std::endl;
+				screenshotRequested = false;
+			}
+			frameCapture.update();
+
+			statsOverlay.addFrameTime(framePacer.getLastFrameTime());
+			if (showStats)
+			{
+				ProfileScope scope(profiler, "statsOverlay");
+				statsOverlay.draw(windowWidth, windowHeight, renderWidth, renderHeight, framePacer.getStats(), scene.getStats(), gpuProfiler.getLatest());
+			}
+
+			pipeline.release();
+			profiler.collect();
+
+			// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+			// -------------------------------------------------------------------------------
+			glfwSwapBuffers(window);
+			framePacer.endFrame();
+			glfwPollEvents();
+		}
 
-		glStencilMask(0xFF);
-		glStencilFunc(GL_ALWAYS, 1, 0xFF);
-		// ------------------------
+		if (profileTracePath)
+			profiler.writeChromeTrace(profileTracePath);
 
-		// set windows title with options
-		setWindowTitle(window);
+		frameCapture.finish();
+		if (frameCapture.getDroppedCount() > 0)
+			std::cout << "Frame capture: " << frameCapture.getDroppedCount() << " frames dropped" << std::endl;
 
-		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		// -------------------------------------------------------------------------------
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		const FramePacingStats pacing = framePacer.getStats();
+		std::cout << "Frame time (ms): mean " << pacing.mean << ", std dev " << pacing.standardDeviation
+			<< ", jitter " << pacing.jitter << ", max " << pacing.max << std::endl;
 	}
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
@@ -362,58 +418,81 @@ int main()
 	return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-// ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+// capture the window input for the next simulated frame; runs on the GLFW thread
+// ---------------------------------------------------------------------------------
+InputState captureInput(GLFWwindow* window, float time)
 {
-	static bool isPressed = false;
 	// close application
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
-	// move camera
-	if (activeCamera == &freeCamera)
+	// toggle the stats overlay; handled here because the overlay is drawn on this thread
+	static bool statsKeyPressed = false;
+	const bool statsKey = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+	if (statsKey && !statsKeyPressed)
+		showStats = !showStats;
+	statsKeyPressed = statsKey;
+
+	// screenshot and recording; the read back happens on this thread as well
+	static bool screenshotKeyPressed = false;
+	const bool screenshotKey = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+	if (screenshotKey && !screenshotKeyPressed)
+		screenshotRequested = true;
+	screenshotKeyPressed = screenshotKey;
+
+	static bool recordKeyPressed = false;
+	const bool recordKey = glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS;
+	if (recordKey && !recordKeyPressed)
 	{
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-			freeCamera.ProcessKeyboard(FORWARD, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-			freeCamera.ProcessKeyboard(BACKWARD, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-			freeCamera.ProcessKeyboard(LEFT, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-			freeCamera.ProcessKeyboard(RIGHT, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
-			freeCamera.ProcessKeyboard(UP, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
-			freeCamera.ProcessKeyboard(DOWN, deltaTime);
+		recordingFrames = !recordingFrames;
+		std::cout << (recordingFrames ? "Recording started" : "Recording stopped") << std::endl;
 	}
+	recordKeyPressed = recordKey;
 
-	freeCamera.Position.z = glm::max(freeCamera.Position.z, 0.05f);
+	static constexpr int usedKeys[] = {
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_LEFT_SHIFT, GLFW_KEY_LEFT_CONTROL,
+		GLFW_KEY_F, GLFW_KEY_G, GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_LEFT, GLFW_KEY_RIGHT,
+		GLFW_KEY_J, GLFW_KEY_K, GLFW_KEY_N, GLFW_KEY_B,
+		GLFW_KEY_P, GLFW_KEY_O, GLFW_KEY_LEFT_BRACKET, GLFW_KEY_RIGHT_BRACKET
+	};
 
-	// change fog intensity
-	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
-		fogIntensity = glm::max(0.0f, fogIntensity - 0.01f);
-	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)
-		fogIntensity = glm::min(1.0f, fogIntensity + 0.01f);
+	InputState input;
+	input.time = time;
+	input.aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+	input.viewportHeight = (float)SCR_HEIGHT;
+	for (int key : usedKeys)
+		input.keys[key] = glfwGetKey(window, key) == GLFW_PRESS;
+
+	input.mouseOffset = pendingMouseOffset;
+	input.scrollOffset = pendingScrollOffset;
+	pendingMouseOffset = glm::vec2(0.0f);
+	pendingScrollOffset = 0.0f;
+	return input;
+}
 
-	// change reflector angle
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-		relativeReflectorAngleY = glm::max(-1.0f, relativeReflectorAngleY - 0.01f);
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
-		relativeReflectorAngleY = glm::min(1.0f, relativeReflectorAngleY + 0.01f);
-	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
-		relativeReflectorAngleX = glm::min(1.0f, relativeReflectorAngleX + 0.01f);
-	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
-		relativeReflectorAngleX = glm::max(-1.0f, relativeReflectorAngleX - 0.01f);
+// process the per-frame input: mouse, scroll and the toggles; runs on the simulation thread
+// ----------------------------------------------------------------------------------------
+void processInput(const InputState& input)
+{
+	ProfileScope scope(profiler, "processInput");
+
+	static bool isPressed = false;
+
+	// look around; follows the mouse every frame instead of every tick
+	if (activeCamera == &freeCamera && input.mouseOffset != glm::vec2(0.0f))
+		freeCamera.ProcessMouseMovement(input.mouseOffset.x, input.mouseOffset.y);
+
+	if (input.scrollOffset != 0.0f)
+		activeCamera->ProcessMouseScroll(input.scrollOffset);
 
 	// change camera
-	if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS && !isPressed)
+	if (input.isPressed(GLFW_KEY_J) && !isPressed)
 	{
 		activeCameraIndex = activeCameraIndex == 0 ? cameras.size() - 1 : activeCameraIndex - 1;
 		activeCamera = cameras[activeCameraIndex];
 		isPressed = true;
 	}
-	if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !isPressed)
+	if (input.isPressed(GLFW_KEY_K) && !isPressed)
 	{
 		activeCameraIndex = (activeCameraIndex + 1) % cameras.size();
 		activeCamera = cameras[activeCameraIndex];
@@ -421,23 +500,211 @@ void processInput(GLFWwindow* window)
 	}
 
 	// change day/night
-	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && !isPressed)
+	if (input.isPressed(GLFW_KEY_N) && !isPressed)
 	{
 		isDay = !isDay;
 		isPressed = true;
 	}
 
 	// change lighting model
-	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !isPressed)
+	if (input.isPressed(GLFW_KEY_B) && !isPressed)
 	{
 		useBlinn = !useBlinn;
 		isPressed = true;
 	}
-	if (glfwGetKey(window, GLFW_KEY_J) == GLFW_RELEASE && glfwGetKey(window, GLFW_KEY_K) == GLFW_RELEASE &&
-		glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE && glfwGetKey(window, GLFW_KEY_B) == GLFW_RELEASE)
+
+	// pause, step a single tick, slow down or speed up the simulation
+	if (input.isPressed(GLFW_KEY_P) && !isPressed)
+	{
+		if (simulationClock.isPaused())
+			simulationClock.resume();
+		else
+			simulationClock.pause();
+		isPressed = true;
+	}
+	if (input.isPressed(GLFW_KEY_O) && !isPressed)
+	{
+		simulationClock.step();
+		isPressed = true;
+	}
+	if (input.isPressed(GLFW_KEY_LEFT_BRACKET) && !isPressed)
+	{
+		simulationClock.setTimeScale(glm::max(0.125, simulationClock.getTimeScale() * 0.5));
+		isPressed = true;
+	}
+	if (input.isPressed(GLFW_KEY_RIGHT_BRACKET) && !isPressed)
+	{
+		simulationClock.setTimeScale(glm::min(8.0, simulationClock.getTimeScale() * 2.0));
+		isPressed = true;
+	}
+
+	if (!input.isPressed(GLFW_KEY_J) && !input.isPressed(GLFW_KEY_K) &&
+		!input.isPressed(GLFW_KEY_N) && !input.isPressed(GLFW_KEY_B) &&
+		!input.isPressed(GLFW_KEY_P) && !input.isPressed(GLFW_KEY_O) &&
+		!input.isPressed(GLFW_KEY_LEFT_BRACKET) && !input.isPressed(GLFW_KEY_RIGHT_BRACKET))
 		isPressed = false;
 }
 
+// advance the simulation by one fixed tick; held keys act per tick so the result does not depend on the frame rate
+// ---------------------------------------------------------------------------------------------------------------
+void updateSimulation(const InputState& input, DemoScene& scene, float tickDuration, float time)
+{
+	// how fast the held keys change the settings, per second
+	constexpr float fogSpeed = 0.6f;
+	constexpr float reflectorSpeed = 0.6f;
+
+	// move camera
+	if (activeCamera == &freeCamera)
+	{
+		if (input.isPressed(GLFW_KEY_W))
+			freeCamera.ProcessKeyboard(FORWARD, tickDuration);
+		if (input.isPressed(GLFW_KEY_S))
+			freeCamera.ProcessKeyboard(BACKWARD, tickDuration);
+		if (input.isPressed(GLFW_KEY_A))
+			freeCamera.ProcessKeyboard(LEFT, tickDuration);
+		if (input.isPressed(GLFW_KEY_D))
+			freeCamera.ProcessKeyboard(RIGHT, tickDuration);
+		if (input.isPressed(GLFW_KEY_LEFT_SHIFT))
+			freeCamera.ProcessKeyboard(UP, tickDuration);
+		if (input.isPressed(GLFW_KEY_LEFT_CONTROL))
+			freeCamera.ProcessKeyboard(DOWN, tickDuration);
+	}
+
+	freeCamera.Position.z = glm::max(freeCamera.Position.z, 0.05f);
+
+	// change fog intensity
+	if (input.isPressed(GLFW_KEY_F))
+		fogIntensity = glm::max(0.0f, fogIntensity - fogSpeed * tickDuration);
+	if (input.isPressed(GLFW_KEY_G))
+		fogIntensity = glm::min(1.0f, fogIntensity + fogSpeed * tickDuration);
+
+	// change reflector angle
+	if (input.isPressed(GLFW_KEY_UP))
+		relativeReflectorAngleY = glm::max(-1.0f, relativeReflectorAngleY - reflectorSpeed * tickDuration);
+	if (input.isPressed(GLFW_KEY_DOWN))
+		relativeReflectorAngleY = glm::min(1.0f, relativeReflectorAngleY + reflectorSpeed * tickDuration);
+	if (input.isPressed(GLFW_KEY_LEFT))
+		relativeReflectorAngleX = glm::min(1.0f, relativeReflectorAngleX + reflectorSpeed * tickDuration);
+	if (input.isPressed(GLFW_KEY_RIGHT))
+		relativeReflectorAngleX = glm::max(-1.0f, relativeReflectorAngleX - reflectorSpeed * tickDuration);
+
+	// move the flashlight and everything attached to it
+	scene.update(time, relativeReflectorAngleX, relativeReflectorAngleY);
+}
+
+void captureTickState(DemoScene& scene, TickState& state)
+{
+	state.camera = activeCamera;
+	state.cameraPosition = activeCamera->Position;
+	state.cameraFront = activeCamera->Front;
+	state.cameraUp = activeCamera->Up;
+	state.cameraZoom = activeCamera->Zoom;
+	state.spotLight = scene.spotLight;
+
+	scene.captureModels(state.models);
+}
+
+// simulate one frame from the captured input and record everything rendering needs; runs on the simulation thread
+// ----------------------------------------------------------------------------------------------------------------
+void simulateFrame(const InputState& input, DemoScene& scene, FrameSnapshot& frame)
+{
+	ProfileScope scope(profiler, "simulateFrame");
+
+	// per-frame time logic
+	// --------------------
+	float currentFrame = input.time;
+	float realDeltaTime = currentFrame - lastFrame;
+	lastFrame = currentFrame;
+
+	processInput(input);
+
+	const float tickDuration = static_cast<float>(simulationClock.getTickDuration());
+	if (currentTick.camera == nullptr)
+	{
+		// first frame: start from the state at time zero
+		updateSimulation(input, scene, 0.0f, 0.0f);
+		captureTickState(scene, currentTick);
+		previousTick = currentTick;
+	}
+
+	simulationClock.advance(lockstepSimulation ? simulationClock.getTickDuration() : realDeltaTime);
+	while (simulationClock.consumeTick())
+	{
+		ProfileScope tickScope(profiler, "simulationTick");
+		std::swap(previousTick, currentTick);
+		updateSimulation(input, scene, tickDuration, static_cast<float>(simulationClock.getTime()));
+		captureTickState(scene, currentTick);
+	}
+
+	// blend the last two ticks for display
+	// ------------------------------------
+	// a new blend factor shows a different image even without a tick
+	static double lastInterpolatedTime = -1.0;
+	if (simulationClock.getInterpolatedTime() != lastInterpolatedTime)
+	{
+		lastInterpolatedTime = simulationClock.getInterpolatedTime();
+		scene.changes.touch();
+	}
+
+	const float alpha = static_cast<float>(simulationClock.getAlpha());
+	frame.time = static_cast<float>(simulationClock.getInterpolatedTime());
+
+	Camera view = *activeCamera;
+	if (currentTick.camera == activeCamera && previousTick.camera == activeCamera)
+	{
+		view.Position = glm::mix(previousTick.cameraPosition, currentTick.cameraPosition, alpha);
+		view.Front = glm::normalize(glm::mix(previousTick.cameraFront, currentTick.cameraFront, alpha));
+		view.Up = glm::normalize(glm::mix(previousTick.cameraUp, currentTick.cameraUp, alpha));
+		view.Zoom = glm::mix(previousTick.cameraZoom, currentTick.cameraZoom, alpha);
+	}
+	// the mouse turns the free camera directly, without waiting for a tick
+	if (activeCamera == &freeCamera)
+	{
+		view.Front = freeCamera.Front;
+		view.Up = freeCamera.Up;
+		view.Zoom = freeCamera.Zoom;
+	}
+
+	// main and reflected view
+	scene.setViews(frame, view, input.aspect, nearPlane, farPlane);
+
+	// settings
+	frame.shaderFeatures = getShaderFeatures();
+	frame.isDay = isDay;
+	frame.useBlinn = useBlinn;
+	frame.fogIntensity = fogIntensity;
+	frame.viewportHeight = input.viewportHeight;
+	frame.cameraName = activeCamera == &stillCamera ? "Still" : activeCamera == &pointedCamera ? "Pointed" : activeCamera == &attachedCamera ? "Attached" : "Free";
+	frame.paused = simulationClock.isPaused();
+	frame.timeScale = static_cast<float>(simulationClock.getTimeScale());
+
+	// lights and draw list
+	scene.recordFrame(frame);
+	frame.spotLight.position = glm::mix(previousTick.spotLight.position, currentTick.spotLight.position, alpha);
+	frame.spotLight.direction = glm::normalize(glm::mix(previousTick.spotLight.direction, currentTick.spotLight.direction, alpha));
+	// the normal matrices of the items that moved are computed in one batch
+	std::vector<size_t> moved;
+	std::vector<glm::mat4> movedModels;
+	for (size_t i = 0; i < frame.drawList.size(); i++)
+	{
+		if (previousTick.models[i] == currentTick.models[i])
+			continue;
+		moved.push_back(i);
+		movedModels.push_back(interpolateTransform(previousTick.models[i], currentTick.models[i], alpha));
+	}
+	std::vector<glm::mat3> movedNormals(moved.size());
+	selectNormalMatrices(movedModels.data(), movedNormals.data(), moved.size());
+	for (size_t i = 0; i < moved.size(); i++)
+	{
+		frame.drawList[moved[i]].model = movedModels[i];
+		frame.drawList[moved[i]].normalModel = movedNormals[i];
+	}
+
+	// frustum and occlusion culling and levels of detail for the interpolated matrices
+	scene.cullFrame(frame);
+	scene.selectLods(frame);
+}
+
 unsigned int loadTexture(const char* path)
 {
 	unsigned int textureID;
@@ -475,140 +742,99 @@ unsigned int loadTexture(const char* path)
 	return textureID;
 }
 
-unsigned int loadCubemap(const std::vector<std::string>& faces)
+void setWindowTitle(GLFWwindow* window, const FrameSnapshot& frame)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-	int width, height, nrChannels;
-	for (unsigned int i = 0; i < faces.size(); i++)
+	// the title is a window system round trip, so only touch it when a shown setting changed
+	struct TitleState
 	{
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data)
-		{
-			GLenum format = 0;
-			if (nrChannels == 1)
-				format = GL_RED;
-			else if (nrChannels == 3)
-				format = GL_RGB;
-			else if (nrChannels == 4)
-				format = GL_RGBA;
-
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-		}
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	return textureID;
-}
+		bool isDay;
+		bool useBlinn;
+		float fogIntensity;
+		const char* cameraName;
+		bool paused;
+		float timeScale;
+
+		bool operator==(const TitleState&) const = default;
+	};
+	static std::optional<TitleState> shown;
+	const TitleState state = { frame.isDay, frame.useBlinn, frame.fogIntensity, frame.cameraName, frame.paused, frame.timeScale };
+	if (shown == state)
+		return;
+	shown = state;
 
-void setWindowTitle(GLFWwindow* window)
-{
 	std::string title = "Lab 4 - ";
-	title += isDay ? "Day" : "Night";
+	title += frame.isDay ? "Day" : "Night";
 	title += " - ";
-	title += useBlinn ? "Blinn-Phong" : "Phong";
+	title += frame.useBlinn ? "Blinn-Phong" : "Phong";
 	title += " - Fog: ";
-	title += std::format("{:.2f}", fogIntensity);
+	title += std::format("{:.2f}", frame.fogIntensity);
 	title += " - Camera: ";
-	title += activeCamera == &stillCamera ? "Still" : activeCamera == &pointedCamera ? "Pointed" : activeCamera == &attachedCamera ? "Attached" : "Free";
+	title += frame.cameraName;
+	if (frame.paused)
+		title += " - Paused";
+	if (frame.timeScale != 1.0f)
+		title += std::format(" - Time x{:.3g}", frame.timeScale);
 	glfwSetWindowTitle(window, title.c_str());
 }
 
-void drawSkybox(Skybox& skybox, Shader& shader, unsigned int cubemapTexture, glm::mat4 view, glm::mat4 projection)
+// file for the next captured frame; numbers continue after existing captures,
+// recorded frames are numbered per recording and raw recordings go into one stream
+// -------------------------------------------------------------------------------
+std::string getCapturePath(bool recording)
 {
-	shader.use();
-	shader.setBool("isFoggy", fogIntensity > 0.0f);
-	shader.setVec3("fogColor", fogColor);
-	shader.setMat4("view", view);
-	shader.setMat4("projection", projection);
-	skybox.Draw(shader, cubemapTexture);
-}
-
-glm::vec3 calculateFlashlightPositionAndAngle(float time, float& angle)
-{
-	constexpr float A = 5.0f;
-	float x = A * glm::sin(time);
-	float z = x * glm::cos(time);
+	static unsigned int screenshotCount = 0;
+	static unsigned int recordingCount = 0;
+	static unsigned int recordedFrames = 0;
+	static bool wasRecording = false;
 
+	std::error_code error;
+	std::filesystem::create_directories(captureDirectory, error);
 
-	float dx = A * glm::cos(time);
-	float dz = A * glm::cos(2 * time);
-
-	angle = glm::atan(dx, dz);
-	return glm::vec3(x, 0.0f, z);
-}
-
-void setCameras(const glm::mat4& flashLightModel)
-{
-	// set attached camera position
-	constexpr glm::vec3 attachedCameraOffset = glm::vec3(0.0f, 0.3f, -0.5f);
-
-	const glm::vec3& flashLightPosition = glm::vec3(flashLightModel * glm::vec4(glm::vec3(0.0f), 1.0f));
-
-	attachedCamera.Position = glm::vec3(flashLightModel * glm::vec4(attachedCameraOffset, 1.0f));
-	attachedCamera.Front = glm::normalize(flashLightPosition - attachedCamera.Position);
-
-
-	// set observing camera target
-	pointedCamera.Front = glm::normalize(flashLightPosition - pointedCamera.Position);
-}
-
-void drawObjects(Shader& shader, const std::vector<Object*>& objects)
-{
-	for (Object* object : objects)
-		object->Draw(shader);
-}
-
-void drawScene(Shader& lightingShader, Shader& skyboxShader, Skybox& skybox, const vector<Object*>& objects, const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPos, unsigned int cubemapTexture)
-{
-	// set observer position
-	lightingShader.setVec3("viewPos", viewPos);
-
-	// view/projection transformations
-	lightingShader.setMat4("projection", projection);
-	lightingShader.setMat4("view", view);
-
-	// render objects
-	drawObjects(lightingShader, objects);
-
-	// draw skybox as last
-	drawSkybox(skybox, skyboxShader, cubemapTexture, glm::mat4(glm::mat3(view)), projection);
+	const char* extension = captureFormat == CaptureFormat::Png ? "png" : captureFormat == CaptureFormat::Qoi ? "qoi" : "rgba";
+	char path[256];
+	auto format = [&]()
+		{
+			if (!recording)
+				std::snprintf(path, sizeof(path), "%s/screenshot_%04u.%s", captureDirectory, screenshotCount, extension);
+			else if (captureFormat == CaptureFormat::Raw)
+				std::snprintf(path, sizeof(path), "%s/recording_%02u.%s", captureDirectory, recordingCount, extension);
+			else
+				std::snprintf(path, sizeof(path), "%s/recording_%02u_%06u.%s", captureDirectory, recordingCount, recordedFrames, extension);
+			return std::filesystem::exists(path, error);
+		};
+
+	if (!recording)
+	{
+		do
+			screenshotCount++;
+		while (format());
+	}
+	else if (!wasRecording)
+	{
+		recordedFrames = 0;
+		do
+			recordingCount++;
+		while (format());
+	}
+	else
+	{
+		recordedFrames++;
+		format();
+	}
+	wasRecording = recording;
+	return path;
 }
 
-glm::mat4 setFlashlight(SpotlightObject& flashlight, SpotLight& spotlight, float currentFrame)
+unsigned int getShaderFeatures()
 {
-	// calculate moving objects positions
-	float angle;
-	glm::vec3 flashLightPosition = calculateFlashlightPositionAndAngle(currentFrame * 0.5f, angle);
-
-	// flashLight model
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(-2.0f, 0.5f, 6.0f));
-	model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, flashLightPosition);
-	model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, relativeReflectorAngleX, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, relativeReflectorAngleY, glm::vec3(1.0f, 0.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(2.0f));
-	flashlight.SetModelMatrix(model);
-
-	// set spotlight properties
-	spotlight.position = glm::vec3(model * glm::vec4(flashlight.lightPositionOffset, 1.0f));
-	spotlight.direction = glm::vec3(model * glm::vec4(flashlight.lightDirection, 0.0f));
-
-	return model;
+	unsigned int features = 0;
+	if (useBlinn)
+		features |= FEATURE_BLINN;
+	if (isDay)
+		features |= FEATURE_DAY;
+	if (fogIntensity > 0.0f)
+		features |= FEATURE_FOG;
+	return features;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -627,9 +853,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
-	if (activeCamera != &freeCamera)
-		return;
-
 	float xpos = static_cast<float>(xposIn);
 	float ypos = static_cast<float>(yposIn);
 
@@ -646,14 +869,15 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 	lastX = xpos;
 	lastY = ypos;
 
-	freeCamera.ProcessMouseMovement(xoffset, yoffset);
+	// applied to the free camera by the simulation thread
+	pendingMouseOffset += glm::vec2(xoffset, yoffset);
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-	activeCamera->ProcessMouseScroll(static_cast<float>(yoffset));
+	pendingScrollOffset += static_cast<float>(yoffset);
 }
 
 
@@ -5,7 +5,7 @@ class Mirror
 	unsigned int VAO;
 public:
 	glm::mat4 modelMatrix = glm::mat4(1.0f);
-	Mirror(float vertices[], int size)
+	Mirror(const float vertices[], int size)
 	{
 		unsigned int VBO;
 		glGenVertexArrays(1, &VAO);
@@ -1,40 +1,122 @@
 #pragma once
 #include <learnopengl/model.h>
 
-class Object
+#include <algorithm>
+#include <array>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "aabb_tree.h"
+#include "occlusion_culler.h"
+
+// what drawing a RenderMesh issued
+struct MeshDrawCounts
+{
+	unsigned int drawCalls = 0;
+	uint64_t triangles = 0;
+};
+
+// A loaded model with what culling and level of detail selection need to know
+// about it. Shared by every entity that draws it through a MeshRef; where and
+// how often it is drawn is up to the entities.
+class RenderMesh
 {
 	Model model;
-	glm::mat4 modelMatrix = glm::mat4(1.0f);
-	glm::mat3 normalModelMatrix = glm::mat3(1.0f);
+	// triangles and largest simplification error of all meshes per level of detail
+	std::vector<uint64_t> lodTriangleCounts;
+	std::vector<float> lodErrors;
+	BoundingBox localBounds;
+	OccluderMesh occluder;
 
 public:
-	Object(Model model) : model(model) {}
+	RenderMesh(Model model) : model(std::move(model)), localBounds{ this->model.bounds.min, this->model.bounds.max }
+	{
+		for (const Mesh& mesh : this->model.meshes)
+		{
+			lodTriangleCounts.resize(std::max(lodTriangleCounts.size(), mesh.lods.size()));
+			lodErrors.resize(lodTriangleCounts.size());
+			for (size_t lod = 0; lod < lodTriangleCounts.size(); lod++)
+			{
+				// meshes with fewer levels draw their coarsest one
+				const MeshLod& level = mesh.lods[std::min(lod, mesh.lods.size() - 1)];
+				lodTriangleCounts[lod] += level.indexCount / 3;
+				lodErrors[lod] = std::max(lodErrors[lod], level.error);
+			}
+		}
+	}
 
-	void SetModelMatrix(glm::mat4 model)
+	// one draw call per mesh
+	size_t GetMeshCount() const
+	{
+		return model.meshes.size();
+	}
+	uint64_t GetTriangleCount(unsigned int lod = 0) const
+	{
+		return lodTriangleCounts.empty() ? 0 : lodTriangleCounts[std::min<size_t>(lod, lodTriangleCounts.size() - 1)];
+	}
+	// levels of detail including the full model, at least one
+	unsigned int GetLodCount() const
+	{
+		return static_cast<unsigned int>(std::max<size_t>(1, lodErrors.size()));
+	}
+	// largest distance of a level of detail to the full model, in model units
+	float GetLodError(unsigned int lod) const
+	{
+		return lod < lodErrors.size() ? lodErrors[lod] : 0.0f;
+	}
+	// bounds of all meshes in model space
+	const BoundingBox& GetLocalBounds() const
 	{
-		modelMatrix = model;
-		normalModelMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+		return localBounds;
 	}
-	void Draw(Shader& shader)
+	// merges the triangles of all meshes at shared positions for the occlusion culler; once
+	// built, GetOccluder returns them
+	void BuildOccluder()
+	{
+		occluder = OccluderMesh();
+		std::map<std::tuple<float, float, float>, uint32_t> welded;
+		for (const Mesh& mesh : model.meshes)
+		{
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+			{
+				uint32_t triangle[3];
+				for (int j = 0; j < 3; j++)
+				{
+					const glm::vec3& position = mesh.vertices[mesh.indices[i + j]].Position;
+					auto [it, inserted] = welded.try_emplace({ position.x, position.y, position.z }, static_cast<uint32_t>(occluder.positions.size()));
+					if (inserted)
+						occluder.positions.push_back(position);
+					triangle[j] = it->second;
+				}
+				if (triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[2] != triangle[0])
+					occluder.indices.insert(occluder.indices.end(), { triangle[0], triangle[1], triangle[2] });
+			}
+		}
+	}
+	// nullptr until BuildOccluder was called
+	const OccluderMesh* GetOccluder() const
+	{
+		return occluder.indices.empty() ? nullptr : &occluder;
+	}
+	// draws the meshes whose bounds are in the view with matrices captured earlier, e.g. in a
+	// frame snapshot; modelViewProjection is projection * view * modelMatrix, the view is
+	// tested in model space, so the bounds are not transformed
+	MeshDrawCounts Draw(Shader& shader, const glm::mat4& modelMatrix, const glm::mat3& normalModelMatrix, const glm::mat4& modelViewProjection, unsigned int lod = 0)
 	{
 		shader.setMat4("model", modelMatrix);
 		shader.setMat3("normalModel", normalModelMatrix);
-		model.Draw(shader);
-	}
-};
-
 
-class LightObject : public Object
-{
-public:
-	LightObject(Model model) : Object(model) {}
-	glm::vec3 lightPositionOffset = glm::vec3(0.0f);
+		MeshDrawCounts counts;
+		const std::array<glm::vec4, 6> planes = getClipPlanes(modelViewProjection);
+		for (Mesh& mesh : model.meshes)
+		{
+			if (!mesh.bounds.isInside(planes))
+				continue;
+			mesh.Draw(shader, lod);
+			counts.drawCalls++;
+			counts.triangles += mesh.lods[std::min<size_t>(lod, mesh.lods.size() - 1)].indexCount / 3;
+		}
+		return counts;
+	}
 };
-
-
-class SpotlightObject : public LightObject
-{
-public:
-	SpotlightObject(Model model) : LightObject(model) {}
-	glm::vec3 lightDirection = glm::vec3(0.0f);
-};
\ No newline at end of file
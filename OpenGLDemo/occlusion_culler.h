@@ -0,0 +1,342 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2
+#endif
+
+#include "aabb_tree.h"
+#include "job_system.h"
+
+// triangles of an occluder in model space, positions only
+struct OccluderMesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+};
+
+// Software occlusion culling on the CPU. A few large occluders are rasterized
+// into a small depth buffer, four pixels at a time and in horizontal bands on
+// the job system, and reduced to a hierarchical-Z pyramid whose texels hold
+// the farthest depth below them. A box is hidden when its nearest point is
+// behind every texel its screen rectangle touches. Occluders only mark pixels
+// they cover completely and store the farthest depth within them, so the
+// low resolution can only make the culler keep objects, never lose them.
+class OcclusionCuller
+{
+public:
+	// rows rasterized by one job; the pyramid levels below a band are built by the same job
+	static constexpr int bandHeight = 16;
+
+	OcclusionCuller(int width = 256, int height = 144)
+	{
+		int levelWidth = width;
+		int levelHeight = height;
+		while (true)
+		{
+			Level level;
+			level.width = levelWidth;
+			level.height = levelHeight;
+			// four pixels per SIMD store, the padding is never read
+			level.stride = levels.empty() ? (levelWidth + 3) & ~3 : levelWidth;
+			level.depth.resize(static_cast<size_t>(level.stride) * levelHeight, 1.0f);
+			levels.push_back(std::move(level));
+			if (levelWidth == 1 && levelHeight == 1)
+				break;
+			levelWidth = (levelWidth + 1) / 2;
+			levelHeight = (levelHeight + 1) / 2;
+		}
+	}
+
+	// starts a new view; depth is cleared to the far plane
+	void begin(const glm::mat4& viewProjection)
+	{
+		this->viewProjection = viewProjection;
+		triangles.clear();
+	}
+
+	// clips the occluder against the near plane and sets up its triangles
+	void addOccluder(const OccluderMesh& mesh, const glm::mat4& model)
+	{
+		const glm::mat4 matrix = viewProjection * model;
+		clipVertices.resize(mesh.positions.size());
+		for (size_t i = 0; i < mesh.positions.size(); i++)
+			clipVertices[i] = matrix * glm::vec4(mesh.positions[i], 1.0f);
+
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			const std::array<glm::vec4, 3> triangle = { clipVertices[mesh.indices[i]], clipVertices[mesh.indices[i + 1]], clipVertices[mesh.indices[i + 2]] };
+			const bool inFront[3] = { triangle[0].z >= -triangle[0].w, triangle[1].z >= -triangle[1].w, triangle[2].z >= -triangle[2].w };
+			if (inFront[0] && inFront[1] && inFront[2])
+			{
+				setupTriangle(triangle[0], triangle[1], triangle[2]);
+				continue;
+			}
+
+			// Sutherland-Hodgman against z = -w, leaves a triangle or a quad
+			std::array<glm::vec4, 4> polygon;
+			int count = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				const int k = (j + 1) % 3;
+				if (inFront[j])
+					polygon[count++] = triangle[j];
+				if (inFront[j] != inFront[k])
+				{
+					const float dj = triangle[j].z + triangle[j].w;
+					const float dk = triangle[k].z + triangle[k].w;
+					polygon[count++] = glm::mix(triangle[j], triangle[k], dj / (dj - dk));
+				}
+			}
+			for (int j = 2; j < count; j++)
+				setupTriangle(polygon[0], polygon[j - 1], polygon[j]);
+		}
+	}
+
+	// rasterizes the occluders added since begin and builds the pyramid; waits for the jobs
+	void rasterize(JobSystem& jobSystem)
+	{
+		const int bandCount = (levels[0].height + bandHeight - 1) / bandHeight;
+		jobSystem.parallel_for(bandCount, 1, [this](size_t begin, size_t end)
+			{
+				for (size_t band = begin; band < end; band++)
+					rasterizeBand(static_cast<int>(band) * bandHeight, std::min(static_cast<int>(band + 1) * bandHeight, levels[0].height));
+			}, "rasterizeOccluders");
+
+		// the levels coarser than a band are only a few texels
+		for (size_t level = bandLevels + 1; level < levels.size(); level++)
+			reduceRows(level, 0, levels[level].height);
+	}
+
+	// false when the box is certainly hidden behind the occluders; call after rasterize
+	bool isVisible(const BoundingBox& box) const
+	{
+		glm::vec2 screenMin = glm::vec2(std::numeric_limits<float>::max());
+		glm::vec2 screenMax = glm::vec2(-std::numeric_limits<float>::max());
+		float nearest = 1.0f;
+		// the corners from one transformed corner and the transformed edges
+		const glm::vec4 origin = viewProjection * glm::vec4(box.min, 1.0f);
+		const glm::vec3 size = box.max - box.min;
+		const glm::vec4 edges[3] = { viewProjection[0] * size.x, viewProjection[1] * size.y, viewProjection[2] * size.z };
+		for (int i = 0; i < 8; i++)
+		{
+			const glm::vec4 clip = origin + (i & 1 ? edges[0] : glm::vec4(0.0f)) + (i & 2 ? edges[1] : glm::vec4(0.0f)) + (i & 4 ? edges[2] : glm::vec4(0.0f));
+			// reaches in front of the near plane, the projection says nothing about it
+			if (clip.w <= 0.0f || clip.z < -clip.w)
+				return true;
+			const glm::vec3 screen = toScreen(clip);
+			screenMin = glm::min(screenMin, glm::vec2(screen));
+			screenMax = glm::max(screenMax, glm::vec2(screen));
+			nearest = std::min(nearest, screen.z);
+		}
+
+		const Level& base = levels[0];
+		int x0 = std::max(0, static_cast<int>(std::floor(screenMin.x)));
+		int y0 = std::max(0, static_cast<int>(std::floor(screenMin.y)));
+		int x1 = std::min(base.width - 1, static_cast<int>(std::floor(screenMax.x)));
+		int y1 = std::min(base.height - 1, static_cast<int>(std::floor(screenMax.y)));
+		// off screen, left to frustum culling
+		if (x0 > x1 || y0 > y1)
+			return true;
+
+		// the finest level that covers the rectangle with at most 4x4 texels
+		size_t level = 0;
+		while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4))
+			level++;
+		const Level& hiZ = levels[level];
+		for (int y = y0 >> level; y <= y1 >> level; y++)
+			for (int x = x0 >> level; x <= x1 >> level; x++)
+				if (nearest <= hiZ.depth[static_cast<size_t>(y) * hiZ.stride + x])
+					return true;
+		return false;
+	}
+
+	// triangles left after near plane clipping in the current view
+	size_t getTriangleCount() const
+	{
+		return triangles.size();
+	}
+
+	int getWidth() const
+	{
+		return levels[0].width;
+	}
+
+	int getHeight() const
+	{
+		return levels[0].height;
+	}
+
+private:
+	struct Level
+	{
+		int width = 0;
+		int height = 0;
+		int stride = 0;
+		std::vector<float> depth;
+	};
+
+	// edge functions and depth plane over integer pixel coordinates. An edge is
+	// >= 0 where the whole pixel lies on its inner side; depth is the farthest
+	// value of the plane within the pixel.
+	struct Triangle
+	{
+		std::array<float, 3> edgeX, edgeY, edgeConstant;
+		float depthX, depthY, depthConstant, depthMax;
+		int minX, maxX, minY, maxY;
+	};
+
+	// log2(bandHeight)
+	static constexpr size_t bandLevels = 4;
+
+	std::vector<Level> levels;
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	std::vector<Triangle> triangles;
+	std::vector<glm::vec4> clipVertices;
+
+	// pixel coordinates with y up, like the framebuffer, and depth in [0, 1]
+	glm::vec3 toScreen(const glm::vec4& clip) const
+	{
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		return glm::vec3((ndc.x * 0.5f + 0.5f) * levels[0].width, (ndc.y * 0.5f + 0.5f) * levels[0].height, ndc.z * 0.5f + 0.5f);
+	}
+
+	void setupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+	{
+		glm::vec3 v0 = toScreen(clip0);
+		glm::vec3 v1 = toScreen(clip1);
+		glm::vec3 v2 = toScreen(clip2);
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		// no back face culling, the mirrored view flips the winding
+		if (area < 0.0f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+		if (!(area > 1e-6f))
+			return;
+
+		Triangle triangle;
+		triangle.minX = std::max(0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+		triangle.maxX = std::min(levels[0].width - 1, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+		triangle.minY = std::max(0, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+		triangle.maxY = std::min(levels[0].height - 1, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			return;
+
+		const std::array<glm::vec3, 3> vertices = { v0, v1, v2 };
+		for (int i = 0; i < 3; i++)
+		{
+			const glm::vec3& a = vertices[i];
+			const glm::vec3& b = vertices[(i + 1) % 3];
+			const float x = a.y - b.y;
+			const float y = b.x - a.x;
+			// evaluated at pixel centers, minus the distance to the farthest pixel corner
+			triangle.edgeX[i] = x;
+			triangle.edgeY[i] = y;
+			triangle.edgeConstant[i] = -(x * a.x + y * a.y) + 0.5f * (x + y) - 0.5f * (std::abs(x) + std::abs(y));
+		}
+
+		triangle.depthX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+		triangle.depthY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+		triangle.depthConstant = v0.z - triangle.depthX * v0.x - triangle.depthY * v0.y
+			+ 0.5f * (triangle.depthX + triangle.depthY) + 0.5f * (std::abs(triangle.depthX) + std::abs(triangle.depthY));
+		triangle.depthMax = std::min(1.0f, std::max({ v0.z, v1.z, v2.z }));
+		triangles.push_back(triangle);
+	}
+
+	// clears and rasterizes the rows [y0, y1) of the base level, then reduces them into the band levels
+	void rasterizeBand(int y0, int y1)
+	{
+		Level& base = levels[0];
+		std::fill(base.depth.begin() + static_cast<size_t>(y0) * base.stride, base.depth.begin() + static_cast<size_t>(y1) * base.stride, 1.0f);
+
+		for (const Triangle& triangle : triangles)
+		{
+			if (triangle.maxY < y0 || triangle.minY >= y1)
+				continue;
+			const int rowBegin = std::max(triangle.minY, y0);
+			const int rowEnd = std::min(triangle.maxY + 1, y1);
+			for (int y = rowBegin; y < rowEnd; y++)
+				rasterizeRow(triangle, y, base.depth.data() + static_cast<size_t>(y) * base.stride);
+		}
+
+		for (size_t level = 1; level <= bandLevels && level < levels.size(); level++)
+			reduceRows(level, y0 >> level, std::min(levels[level].height, (y1 + (1 << level) - 1) >> level));
+	}
+
+	static void rasterizeRow(const Triangle& triangle, int y, float* row)
+	{
+		const float fy = static_cast<float>(y);
+		const float edgeRow[3] = {
+			triangle.edgeY[0] * fy + triangle.edgeConstant[0],
+			triangle.edgeY[1] * fy + triangle.edgeConstant[1],
+			triangle.edgeY[2] * fy + triangle.edgeConstant[2] };
+		const float depthRow = triangle.depthY * fy + triangle.depthConstant;
+
+#ifdef OCCLUSION_CULLER_SSE2
+		const int xBegin = triangle.minX & ~3;
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 depthMax = _mm_set1_ps(triangle.depthMax);
+		__m128 edges[3];
+		__m128 edgeSteps[3];
+		for (int i = 0; i < 3; i++)
+		{
+			const __m128 x = _mm_set1_ps(triangle.edgeX[i]);
+			edges[i] = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_set1_ps(static_cast<float>(xBegin)), lanes)), _mm_set1_ps(edgeRow[i]));
+			edgeSteps[i] = _mm_mul_ps(x, _mm_set1_ps(4.0f));
+		}
+		__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthX), _mm_add_ps(_mm_set1_ps(static_cast<float>(xBegin)), lanes)), _mm_set1_ps(depthRow));
+		const __m128 depthStep = _mm_set1_ps(triangle.depthX * 4.0f);
+
+		for (int x = xBegin; x <= triangle.maxX; x += 4)
+		{
+			const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edges[0], zero), _mm_cmpge_ps(edges[1], zero)), _mm_cmpge_ps(edges[2], zero));
+			if (_mm_movemask_ps(inside))
+			{
+				const __m128 current = _mm_loadu_ps(row + x);
+				const __m128 nearer = _mm_min_ps(current, _mm_min_ps(depth, depthMax));
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+			}
+			for (int i = 0; i < 3; i++)
+				edges[i] = _mm_add_ps(edges[i], edgeSteps[i]);
+			depth = _mm_add_ps(depth, depthStep);
+		}
+#else
+		for (int x = triangle.minX; x <= triangle.maxX; x++)
+		{
+			const float fx = static_cast<float>(x);
+			if (triangle.edgeX[0] * fx + edgeRow[0] >= 0.0f && triangle.edgeX[1] * fx + edgeRow[1] >= 0.0f && triangle.edgeX[2] * fx + edgeRow[2] >= 0.0f)
+				row[x] = std::min(row[x], std::min(triangle.depthX * fx + depthRow, triangle.depthMax));
+		}
+#endif
+	}
+
+	// every texel of the rows [y0, y1) gets the farthest depth of the 2x2 texels below it
+	void reduceRows(size_t level, int y0, int y1)
+	{
+		const Level& source = levels[level - 1];
+		Level& target = levels[level];
+		for (int y = y0; y < y1; y++)
+		{
+			const float* row0 = source.depth.data() + static_cast<size_t>(2 * y) * source.stride;
+			const float* row1 = source.depth.data() + static_cast<size_t>(std::min(2 * y + 1, source.height - 1)) * source.stride;
+			float* out = target.depth.data() + static_cast<size_t>(y) * target.stride;
+			for (int x = 0; x < target.width; x++)
+			{
+				const int x0 = 2 * x;
+				const int x1 = std::min(2 * x + 1, source.width - 1);
+				out[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+			}
+		}
+	}
+};
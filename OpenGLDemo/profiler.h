@@ -0,0 +1,480 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "concurrent_ring.h"
+#include "job_system.h"
+
+enum class ProfileEventType : uint8_t
+{
+	Cpu,
+	Gpu,
+	Job,
+};
+
+// Counters of one GPU pass from pipeline statistics queries
+struct PipelineStatistics
+{
+	uint64_t verticesSubmitted = 0;
+	uint64_t primitivesSubmitted = 0;
+	uint64_t clippingInputPrimitives = 0;
+	uint64_t fragmentShaderInvocations = 0;
+};
+
+struct ProfileEvent
+{
+	const char* name = "";
+	ProfileEventType type = ProfileEventType::Cpu;
+	uint32_t thread = 0;
+	uint64_t frame = 0;
+	// nanoseconds since the profiler was created
+	int64_t start = 0;
+	int64_t duration = 0;
+	bool hasStatistics = false;
+	PipelineStatistics statistics;
+};
+
+// Collects timed events from any thread. Producers push into a lock-free ring;
+// the thread that owns the profiler moves them into a bounded history with
+// collect(), from which a Chrome trace (chrome://tracing, Perfetto) is written.
+// Event names are not copied and have to outlive the profiler.
+class Profiler
+{
+public:
+	std::atomic<bool> enabled{ true };
+
+	Profiler(size_t capacity = 1 << 16, size_t historySize = 1 << 18)
+		: events(capacity), historySize(historySize), epoch(std::chrono::steady_clock::now())
+	{
+	}
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	int64_t now() const
+	{
+		return toTime(std::chrono::steady_clock::now());
+	}
+
+	int64_t toTime(std::chrono::steady_clock::time_point time) const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch).count();
+	}
+
+	// called by the render thread once per frame; events are tagged with the current frame
+	void beginFrame()
+	{
+		frame.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint64_t getFrame() const
+	{
+		return frame.load(std::memory_order_relaxed);
+	}
+
+	void record(const ProfileEvent& event)
+	{
+		if (!events.push(event))
+			dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void recordCpu(const char* name, int64_t start, int64_t end)
+	{
+		ProfileEvent event;
+		event.name = name;
+		event.type = ProfileEventType::Cpu;
+		event.thread = threadId();
+		event.frame = getFrame();
+		event.start = start;
+		event.duration = end - start;
+		record(event);
+	}
+
+	// suitable as JobSystem timing hook
+	void recordJob(const JobTiming& timing)
+	{
+		if (!enabled.load(std::memory_order_relaxed))
+			return;
+
+		if (timing.thread != 0 && !threadNamed())
+			setThreadName("Job worker " + std::to_string(timing.thread));
+
+		ProfileEvent event;
+		event.name = timing.name;
+		event.type = ProfileEventType::Job;
+		event.thread = threadId();
+		event.frame = getFrame();
+		event.start = toTime(timing.start);
+		event.duration = toTime(timing.end) - event.start;
+		record(event);
+	}
+
+	// names the calling thread in the trace; the first name a thread gets is kept
+	void setThreadName(const std::string& name)
+	{
+		if (threadNamed())
+			return;
+		threadNamed() = true;
+
+		std::lock_guard<std::mutex> lock(threadNamesMutex);
+		threadNames.emplace_back(threadId(), name);
+	}
+
+	// small id of the calling thread, stable for its lifetime
+	static uint32_t threadId()
+	{
+		static std::atomic<uint32_t> nextId{ 1 };
+		static thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+		return id;
+	}
+
+	// moves pending events from the ring into the history; call from one thread only
+	void collect()
+	{
+		ProfileEvent event;
+		while (events.pop(event))
+		{
+			history.push_back(event);
+			if (history.size() > historySize)
+				history.pop_front();
+		}
+	}
+
+	const std::deque<ProfileEvent>& getHistory() const
+	{
+		return history;
+	}
+
+	// events lost because the ring was full between two collect() calls
+	size_t getDroppedCount() const
+	{
+		return dropped.load(std::memory_order_relaxed);
+	}
+
+	// writes the history in the Chrome trace event format
+	bool writeChromeTrace(const std::string& path)
+	{
+		collect();
+
+		std::ofstream file(path);
+		if (!file)
+		{
+			std::cout << "ERROR::PROFILER::FILE_NOT_WRITTEN: " << path << std::endl;
+			return false;
+		}
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << cpuProcess << ",\"args\":{\"name\":\"CPU\"}},\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << gpuProcess << ",\"args\":{\"name\":\"GPU\"}}";
+		{
+			std::lock_guard<std::mutex> lock(threadNamesMutex);
+			for (const auto& [thread, name] : threadNames)
+			{
+				file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << cpuProcess << ",\"tid\":" << thread
+					<< ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+			}
+		}
+
+		for (const ProfileEvent& event : history)
+		{
+			const bool gpu = event.type == ProfileEventType::Gpu;
+			const char* category = gpu ? "gpu" : event.type == ProfileEventType::Job ? "job" : "cpu";
+
+			file << ",\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << category << "\",\"ph\":\"X\""
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0
+				<< ",\"pid\":" << (gpu ? gpuProcess : cpuProcess) << ",\"tid\":" << event.thread
+				<< ",\"args\":{\"frame\":" << event.frame;
+			if (event.hasStatistics)
+			{
+				file << ",\"verticesSubmitted\":" << event.statistics.verticesSubmitted
+					<< ",\"primitivesSubmitted\":" << event.statistics.primitivesSubmitted
+					<< ",\"clippingInputPrimitives\":" << event.statistics.clippingInputPrimitives
+					<< ",\"fragmentShaderInvocations\":" << event.statistics.fragmentShaderInvocations;
+			}
+			file << "}}";
+		}
+		file << "\n]}\n";
+		return true;
+	}
+
+private:
+	static constexpr int cpuProcess = 1;
+	static constexpr int gpuProcess = 2;
+
+	ConcurrentRing<ProfileEvent> events;
+	std::deque<ProfileEvent> history;
+	size_t historySize;
+
+	std::chrono::steady_clock::time_point epoch;
+	std::atomic<uint64_t> frame{ 0 };
+	std::atomic<size_t> dropped{ 0 };
+
+	std::mutex threadNamesMutex;
+	std::vector<std::pair<uint32_t, std::string>> threadNames;
+
+	static bool& threadNamed()
+	{
+		static thread_local bool named = false;
+		return named;
+	}
+
+	static std::string escape(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+};
+
+// Times the enclosing block on the CPU
+class ProfileScope
+{
+	Profiler& profiler;
+	const char* name;
+	int64_t start;
+
+public:
+	ProfileScope(Profiler& profiler, const char* name)
+		: profiler(profiler), name(name), start(profiler.enabled.load(std::memory_order_relaxed) ? profiler.now() : -1)
+	{
+	}
+
+	~ProfileScope()
+	{
+		if (start >= 0)
+			profiler.recordCpu(name, start, profiler.now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+// GPU time and pipeline statistics of one pass, as read back from the queries
+struct GpuPassTiming
+{
+	const char* name;
+	double milliseconds;
+	bool hasStatistics;
+	PipelineStatistics statistics;
+};
+
+// Times render passes with GL_TIME_ELAPSED queries. Passes are sequential:
+// beginning a pass ends the open one, since only one query per target can be
+// active. Results are read back `latency` frames later without waiting for
+// the GPU and forwarded to the profiler; a frame whose queries are still not
+// available by then is dropped rather than stalling the pipeline.
+class GpuProfiler
+{
+public:
+	static constexpr unsigned int latency = 4;
+
+	GpuProfiler(Profiler& profiler) : profiler(profiler)
+	{
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		statisticsSupported = major > 4 || (major == 4 && minor >= 6);
+
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (GLint i = 0; i < extensionCount && !statisticsSupported; i++)
+		{
+			const std::string extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			statisticsSupported = extension == "GL_ARB_pipeline_statistics_query";
+		}
+
+		calibrate();
+	}
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	bool hasPipelineStatistics() const
+	{
+		return statisticsSupported;
+	}
+
+	// call once per frame after Profiler::beginFrame, before the first pass
+	void beginFrame()
+	{
+		end();
+		enabled = profiler.enabled.load(std::memory_order_relaxed);
+
+		const uint64_t frame = profiler.getFrame();
+		FrameQueries& queries = frames[frame % latency];
+		if (queries.used > 0)
+			readBack(queries);
+		queries.frame = frame;
+		queries.used = 0;
+
+		// keep the GPU and CPU clocks aligned despite drift
+		if (frame % 256 == 0)
+			calibrate();
+	}
+
+	void begin(const char* name)
+	{
+		end();
+		if (!enabled)
+			return;
+
+		FrameQueries& queries = frames[profiler.getFrame() % latency];
+		if (queries.used == queries.passes.size())
+			queries.passes.push_back(createPass());
+
+		Pass& pass = queries.passes[queries.used++];
+		pass.name = name;
+		glQueryCounter(pass.timestampQuery, GL_TIMESTAMP);
+		glBeginQuery(GL_TIME_ELAPSED, pass.elapsedQuery);
+		if (statisticsSupported)
+		{
+			for (int i = 0; i < statisticsCount; i++)
+				glBeginQuery(statisticsTargets[i], pass.statisticsQueries[i]);
+		}
+		open = true;
+	}
+
+	void end()
+	{
+		if (!open)
+			return;
+
+		glEndQuery(GL_TIME_ELAPSED);
+		if (statisticsSupported)
+		{
+			for (int i = 0; i < statisticsCount; i++)
+				glEndQuery(statisticsTargets[i]);
+		}
+		open = false;
+	}
+
+	// passes of the most recent frame that was read back
+	const std::vector<GpuPassTiming>& getLatest() const
+	{
+		return latest;
+	}
+
+	// profiler frame the passes of getLatest belong to
+	uint64_t getLatestFrame() const
+	{
+		return latestFrame;
+	}
+
+	// frames whose results were not available in time
+	size_t getDroppedCount() const
+	{
+		return dropped;
+	}
+
+private:
+	static constexpr int statisticsCount = 4;
+	static constexpr GLenum statisticsTargets[statisticsCount] = {
+		GL_VERTICES_SUBMITTED, GL_PRIMITIVES_SUBMITTED, GL_CLIPPING_INPUT_PRIMITIVES, GL_FRAGMENT_SHADER_INVOCATIONS
+	};
+
+	struct Pass
+	{
+		const char* name = "";
+		GLuint timestampQuery = 0;
+		GLuint elapsedQuery = 0;
+		GLuint statisticsQueries[statisticsCount] = {};
+	};
+
+	struct FrameQueries
+	{
+		uint64_t frame = 0;
+		std::vector<Pass> passes;
+		size_t used = 0;
+	};
+
+	Profiler& profiler;
+	bool statisticsSupported = false;
+	bool enabled = true;
+	bool open = false;
+
+	FrameQueries frames[latency];
+	std::vector<GpuPassTiming> latest;
+	uint64_t latestFrame = 0;
+	size_t dropped = 0;
+	// profiler time minus GPU time
+	int64_t clockOffset = 0;
+
+	Pass createPass()
+	{
+		Pass pass;
+		glGenQueries(1, &pass.timestampQuery);
+		glGenQueries(1, &pass.elapsedQuery);
+		if (statisticsSupported)
+			glGenQueries(statisticsCount, pass.statisticsQueries);
+		return pass;
+	}
+
+	void calibrate()
+	{
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		clockOffset = profiler.now() - gpuTime;
+	}
+
+	bool isAvailable(GLuint query) const
+	{
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		return available == GL_TRUE;
+	}
+
+	void readBack(const FrameQueries& queries)
+	{
+		// queries complete in order, so the last one of the frame decides
+		const Pass& last = queries.passes[queries.used - 1];
+		if (!isAvailable(last.elapsedQuery) || (statisticsSupported && !isAvailable(last.statisticsQueries[statisticsCount - 1])))
+		{
+			dropped++;
+			return;
+		}
+
+		latest.clear();
+		latestFrame = queries.frame;
+		for (size_t i = 0; i < queries.used; i++)
+		{
+			const Pass& pass = queries.passes[i];
+			GLuint64 start = 0, elapsed = 0;
+			glGetQueryObjectui64v(pass.timestampQuery, GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(pass.elapsedQuery, GL_QUERY_RESULT, &elapsed);
+
+			ProfileEvent event;
+			event.name = pass.name;
+			event.type = ProfileEventType::Gpu;
+			event.frame = queries.frame;
+			event.start = static_cast<int64_t>(start) + clockOffset;
+			event.duration = static_cast<int64_t>(elapsed);
+			if (statisticsSupported)
+			{
+				GLuint64 values[statisticsCount] = {};
+				for (int s = 0; s < statisticsCount; s++)
+					glGetQueryObjectui64v(pass.statisticsQueries[s], GL_QUERY_RESULT, &values[s]);
+				event.hasStatistics = true;
+				event.statistics = { values[0], values[1], values[2], values[3] };
+			}
+			profiler.record(event);
+			latest.push_back({ event.name, elapsed / 1e6, event.hasStatistics, event.statistics });
+		}
+	}
+};
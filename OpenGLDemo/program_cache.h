@@ -0,0 +1,193 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by the shader sources, the injected #define set and the
+// GL_RENDERER/GL_VERSION strings, so a driver update or an edited shader never
+// picks up a stale binary. Requires a current GL context.
+class ProgramCache
+{
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint64_t driverHash;
+		uint32_t binaryFormat;
+		uint32_t length;
+	};
+
+	static constexpr uint32_t MAGIC = 0x42504C47; // "GLPB"
+	static constexpr uint32_t VERSION = 1;
+
+	std::filesystem::path directory;
+	uint64_t driverHash = 0;
+	bool enabled = false;
+
+public:
+	ProgramCache(const std::filesystem::path& directory) : directory(directory)
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats == 0)
+			return;
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (error)
+		{
+			std::cout << "ERROR::PROGRAM_CACHE::CANNOT_CREATE_DIRECTORY: " << directory.string() << std::endl;
+			return;
+		}
+
+		const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		driverHash = hash(std::string(renderer ? renderer : ""));
+		driverHash = hash(std::string(version ? version : ""), driverHash);
+		enabled = true;
+	}
+
+	bool isEnabled() const
+	{
+		return enabled;
+	}
+
+	// key for a program built from the given sources with the given #define block
+	uint64_t makeKey(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines) const
+	{
+		uint64_t key = hash(vertexCode);
+		key = hash(fragmentCode, key);
+		key = hash(defines, key);
+		return hash(&driverHash, sizeof(driverHash), key);
+	}
+
+	// returns a linked program restored from disk, or 0 when there is no usable binary;
+	// entries the driver rejects are removed so they get rebuilt from source
+	unsigned int load(uint64_t key) const
+	{
+		if (!enabled)
+			return 0;
+
+		const std::filesystem::path path = entryPath(key);
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return 0;
+
+		Header header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != MAGIC || header.version != VERSION || header.key != key || header.driverHash != driverHash)
+		{
+			file.close();
+			discard(path);
+			return 0;
+		}
+
+		std::vector<char> binary(header.length);
+		file.read(binary.data(), binary.size());
+		if (!file)
+		{
+			file.close();
+			discard(path);
+			return 0;
+		}
+		file.close();
+
+		unsigned int program = glCreateProgram();
+		glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glDeleteProgram(program);
+			discard(path);
+			return 0;
+		}
+		return program;
+	}
+
+	// writes the binary of a successfully linked program; the program has to be
+	// linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	void store(uint64_t key, unsigned int program) const
+	{
+		if (!enabled)
+			return;
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+			return;
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		std::vector<char> binary(length);
+		GLenum binaryFormat = 0;
+		glGetProgramBinary(program, length, nullptr, &binaryFormat, binary.data());
+
+		const Header header{ MAGIC, VERSION, key, driverHash, binaryFormat, static_cast<uint32_t>(length) };
+
+		// write to a temporary file first so a crash never leaves a truncated entry behind
+		const std::filesystem::path path = entryPath(key);
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file)
+			{
+				std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE: " << tempPath.string() << std::endl;
+				return;
+			}
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(binary.data(), binary.size());
+		}
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+			std::filesystem::remove(tempPath, error);
+	}
+
+	// 64-bit FNV-1a
+	static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t result = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			result ^= bytes[i];
+			result *= 1099511628211ull;
+		}
+		return result;
+	}
+
+	static uint64_t hash(const std::string& text, uint64_t seed = 14695981039346656037ull)
+	{
+		// include the length so adjacent strings cannot shift into each other
+		const uint64_t length = text.size();
+		return hash(text.data(), text.size(), hash(&length, sizeof(length), seed));
+	}
+
+private:
+	std::filesystem::path entryPath(uint64_t key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+		return directory / name;
+	}
+
+	static void discard(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		std::filesystem::remove(path, error);
+	}
+};
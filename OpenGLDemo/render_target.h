@@ -0,0 +1,145 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <iostream>
+
+// Offscreen framebuffer with a color and a depth/stencil attachment. With more
+// than one sample both are multisampled renderbuffers that have to be resolved
+// with blitTo; otherwise the color is a texture that later passes can sample.
+class RenderTarget
+{
+public:
+	RenderTarget(int width, int height, int samples = 0)
+	{
+		create(width, height, samples);
+	}
+
+	~RenderTarget()
+	{
+		destroy();
+	}
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	int getWidth() const
+	{
+		return width;
+	}
+
+	int getHeight() const
+	{
+		return height;
+	}
+
+	int getSamples() const
+	{
+		return samples;
+	}
+
+	unsigned int getFramebuffer() const
+	{
+		return framebuffer;
+	}
+
+	// 0 for multisampled targets
+	unsigned int getColorTexture() const
+	{
+		return colorTexture;
+	}
+
+	void resize(int newWidth, int newHeight)
+	{
+		if (newWidth == width && newHeight == height)
+			return;
+		const int currentSamples = samples;
+		destroy();
+		create(newWidth, newHeight, currentSamples);
+	}
+
+	// binds the target for drawing and sets the viewport to cover it
+	void bind() const
+	{
+		bind(width, height);
+	}
+
+	// binds the target for drawing into its lower left corner only, e.g. at a
+	// reduced resolution without reallocating the attachments
+	void bind(int viewportWidth, int viewportHeight) const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, viewportWidth, viewportHeight);
+	}
+
+	// resolves or scales the color attachment into another framebuffer (0 = default)
+	void blitTo(unsigned int target, int targetWidth, int targetHeight, GLenum filter = GL_NEAREST) const
+	{
+		blitTo(target, width, height, targetWidth, targetHeight, filter);
+	}
+
+	// same for the lower left sourceWidth x sourceHeight region; multisampled
+	// targets can only be resolved at the same size, not scaled
+	void blitTo(unsigned int target, int sourceWidth, int sourceHeight, int targetWidth, int targetHeight, GLenum filter) const
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+		glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, filter);
+		glBindFramebuffer(GL_FRAMEBUFFER, target);
+	}
+
+private:
+	int width = 0;
+	int height = 0;
+	int samples = 0;
+	unsigned int framebuffer = 0;
+	unsigned int colorTexture = 0;
+	unsigned int colorBuffer = 0;
+	unsigned int depthStencilBuffer = 0;
+
+	void create(int newWidth, int newHeight, int newSamples)
+	{
+		width = newWidth;
+		height = newHeight;
+		samples = newSamples > 1 ? newSamples : 0;
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+		if (samples > 0)
+		{
+			glGenRenderbuffers(1, &colorBuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+			glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		}
+		else
+		{
+			glGenTextures(1, &colorTexture);
+			glBindTexture(GL_TEXTURE_2D, colorTexture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+		}
+
+		glGenRenderbuffers(1, &depthStencilBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthStencilBuffer);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencilBuffer);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::RENDER_TARGET::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void destroy()
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &colorTexture);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthStencilBuffer);
+		framebuffer = colorTexture = colorBuffer = depthStencilBuffer = 0;
+	}
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Picks the scale of the render resolution from measured GPU frame time.
+// Fragment cost is roughly proportional to the pixel count, so the scale
+// moves by the square root of budget / time. The measured time is smoothed
+// and changes are limited per step. While the GPU time stays inside the
+// headroom band below the budget nothing changes, so the scale does not
+// oscillate. Timer results arrive a few frames late. After every change the
+// samples of frames still rendered at the old scale are ignored.
+class ResolutionScaler
+{
+public:
+	ResolutionScaler(double gpuBudget, float minScale = 0.5f, float maxScale = 1.0f, unsigned int settleFrames = 5)
+		: gpuBudget(gpuBudget), minScale(minScale), maxScale(maxScale), settleFrames(settleFrames), scale(maxScale)
+	{
+	}
+
+	float getScale() const
+	{
+		return scale;
+	}
+
+	// milliseconds of GPU time per frame to stay under
+	void setBudget(double milliseconds)
+	{
+		gpuBudget = milliseconds;
+	}
+
+	double getBudget() const
+	{
+		return gpuBudget;
+	}
+
+	// feeds the GPU time of one finished frame
+	void update(double gpuMilliseconds)
+	{
+		if (samplesSinceChange < settleFrames)
+		{
+			samplesSinceChange++;
+			return;
+		}
+
+		smoothedTime = smoothedTime > 0.0 ? smoothedTime + smoothing * (gpuMilliseconds - smoothedTime) : gpuMilliseconds;
+		if (smoothedTime <= 0.0)
+			return;
+
+		// grow only when there is clearly room, shrink as soon as the budget is exceeded
+		const double ratio = gpuBudget / smoothedTime;
+		if (ratio >= 1.0 && ratio <= 1.0 / headroom)
+			return;
+
+		const float change = std::clamp(static_cast<float>(std::sqrt(ratio * (ratio > 1.0 ? headroom : 1.0))), 1.0f - maxStep, 1.0f + maxStep);
+		const float newScale = std::clamp(scale * change, minScale, maxScale);
+		if (std::abs(newScale - scale) < minChange)
+			return;
+
+		scale = newScale;
+		samplesSinceChange = 0;
+		smoothedTime = 0.0;
+	}
+
+private:
+	// growing aims for this fraction of the budget
+	static constexpr double headroom = 0.85;
+	static constexpr double smoothing = 0.2;
+	static constexpr float maxStep = 0.1f;
+	static constexpr float minChange = 0.02f;
+
+	double gpuBudget;
+	float minScale;
+	float maxScale;
+	unsigned int settleFrames;
+
+	float scale;
+	double smoothedTime = 0.0;
+	unsigned int samplesSinceChange = 0;
+};
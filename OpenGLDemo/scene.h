@@ -0,0 +1,722 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#pragma warning(push, 0)
+#include <learnopengl/filesystem.h>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/camera.h>
+#include <learnopengl/model.h>
+#pragma warning(pop)
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ecs.h"
+#include "components.h"
+#include "scene_file.h"
+#include "skybox.h"
+#include "mirror.h"
+#include "lights.h"
+#include "shader_permutations.h"
+#include "frame_state.h"
+#include "job_system.h"
+#include "occlusion_culler.h"
+#include "profiler.h"
+#include "change_counter.h"
+
+// The demo scene: models, lights, mirror and skybox together with the shaders
+// that render them. Shared by the interactive demo and the headless benchmark,
+// which only differ in where the FrameSnapshots come from. What the scene
+// contains comes from a SceneFile. The models, lights and cameras that move
+// with them are entities of an archetype World; the methods below are the
+// systems that update them and turn them into frames.
+class DemoScene
+{
+	// all shader variants, submitted to the driver before the first model starts loading
+	struct Shaders
+	{
+		ShaderPermutations skybox;
+		ShaderPermutations lighting;
+		ShaderPermutations constant;
+
+		Shaders(ProgramCache& programCache)
+			: skybox("Shaders/skybox_shader.vert", "Shaders/skybox_shader.frag"),
+			lighting("Shaders/lighting_shader.vert", "Shaders/lighting_shader.frag"),
+			constant("Shaders/constant_shader.vert", "Shaders/constant_shader.frag")
+		{
+			skybox.programCache = &programCache;
+			skybox.addFeature(FEATURE_FOG, "USE_FOG");
+
+			lighting.programCache = &programCache;
+			lighting.addFeature(FEATURE_BLINN, "USE_BLINN");
+			lighting.addFeature(FEATURE_DAY, "IS_DAY");
+			lighting.addFeature(FEATURE_FOG, "USE_FOG");
+			lighting.setConstant("NR_POINT_LIGHTS", 1);
+			lighting.setConstant("NR_SPOT_LIGHTS", 1);
+
+			constant.programCache = &programCache;
+
+			skybox.submitAll();
+			lighting.submitAll();
+			constant.submitAll();
+		}
+	};
+
+	JobSystem& jobSystem;
+	Profiler& profiler;
+	Shaders shaders;
+
+	// the meshes of the scene file, in its order
+	std::vector<std::unique_ptr<RenderMesh>> meshes;
+	// the entity of every entity index of the scene file
+	std::vector<EntityId> sceneEntities;
+	std::vector<SceneCamera> sceneCameras;
+
+	Skybox skybox;
+	unsigned int cubemapDayTexture;
+	unsigned int cubemapNightTexture;
+	Mirror mirror;
+	// reflects points at the plane of the mirror
+	glm::mat4 mirrorReflection;
+
+	DirLight dirLight;
+
+	RenderStats stats;
+
+	// world bounds of the draw items, user data is the index in the draw list
+	DynamicAabbTree visibilityTree;
+	std::vector<int32_t> visibilityProxies;
+
+	OcclusionCuller mainOcclusion;
+	OcclusionCuller reflectedOcclusion;
+
+	// level of detail every draw item was drawn at last in the main and the reflected view
+	std::vector<std::array<unsigned int, 2>> selectedLods;
+
+	// what the last recorded frame showed, to notice view and setting changes
+	ViewState recordedView;
+	unsigned int recordedFeatures = 0;
+	float recordedFogIntensity = 0.0f;
+
+public:
+	World world;
+
+	// the lighting shader takes one light of each kind, from the first entity with such a source; see updateLights
+	PointLight pointLight;
+	SpotLight spotLight;
+	glm::vec3 fogColor = glm::vec3(0.8f);
+	// touched by every edit that changes the rendered image
+	ChangeCounter changes;
+	// items are drawn at the coarsest level of detail whose error covers at most this many pixels
+	float lodErrorPixels = 1.0f;
+	// a coarser level is only taken once its error is below this fraction of the limit,
+	// so items near the limit do not switch back and forth
+	float lodHysteresis = 0.75f;
+	// the mirror shows a small part of the scene at a distance; its pass accepts this much more error
+	float reflectedLodBias = 2.0f;
+
+	// needs a current GL context; the shaders compile while the models load
+	DemoScene(ProgramCache& programCache, JobSystem& jobSystem, Profiler& profiler, const SceneFile& sceneFile)
+		: jobSystem(jobSystem),
+		profiler(profiler),
+		shaders(programCache),
+		cubemapDayTexture(loadCubemap(jobSystem, {
+			FileSystem::getPath("Resources/textures/skybox/right.jpg"),
+			FileSystem::getPath("Resources/textures/skybox/left.jpg"),
+			FileSystem::getPath("Resources/textures/skybox/top.jpg"),
+			FileSystem::getPath("Resources/textures/skybox/bottom.jpg"),
+			FileSystem::getPath("Resources/textures/skybox/front.jpg"),
+			FileSystem::getPath("Resources/textures/skybox/back.jpg")
+			})),
+		cubemapNightTexture(loadCubemap(jobSystem, {
+			FileSystem::getPath("Resources/textures/night_skybox/right.png"),
+			FileSystem::getPath("Resources/textures/night_skybox/left.png"),
+			FileSystem::getPath("Resources/textures/night_skybox/top.png"),
+			FileSystem::getPath("Resources/textures/night_skybox/bottom.png"),
+			FileSystem::getPath("Resources/textures/night_skybox/front.png"),
+			FileSystem::getPath("Resources/textures/night_skybox/back.png")
+			})),
+		mirror(getMirrorVertices(sceneFile.getSettings().mirrorHalfSize).data(), sizeof(float) * 18),
+		mirrorReflection(getReflection(sceneFile.getSettings().mirrorModel))
+	{
+		// configure global opengl state
+		// -----------------------------
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_MULTISAMPLE);
+		glEnable(GL_STENCIL_TEST);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+		const SceneSettings& settings = sceneFile.getSettings();
+		dirLight.direction = settings.sunDirection;
+		dirLight.color = settings.sunColor;
+		mirror.modelMatrix = settings.mirrorModel;
+
+		for (uint32_t i = 0; i < sceneFile.getMeshes().size(); i++)
+			meshes.push_back(std::make_unique<RenderMesh>(Model(FileSystem::getPath(std::string(sceneFile.getMeshPath(i))))));
+
+		// entities with a mesh are drawn; lights and paths are added to the entities they belong to
+		const SceneArray<glm::mat4> transforms = sceneFile.getTransforms();
+		const SceneArray<uint32_t> entityMeshes = sceneFile.getEntityMeshes();
+		const SceneArray<uint32_t> entityFlags = sceneFile.getEntityFlags();
+		std::vector<ModelTransform> modelTransforms(transforms.size());
+		setModelTransforms(modelTransforms.data(), transforms.data, transforms.size());
+		sceneEntities.resize(sceneFile.getEntityCount());
+		for (uint32_t i = 0; i < sceneFile.getEntityCount(); i++)
+		{
+			if (entityMeshes[i] == sceneNone)
+			{
+				sceneEntities[i] = world.create(modelTransforms[i]);
+				continue;
+			}
+			const Material material = { (entityFlags[i] & SCENE_OCCLUDER) != 0, (entityFlags[i] & SCENE_HIDDEN_IN_MIRROR) == 0 };
+			sceneEntities[i] = world.create(modelTransforms[i], MeshRef{ meshes[entityMeshes[i]].get() }, material);
+		}
+		for (const ScenePointLight& light : sceneFile.getPointLights())
+			world.add(sceneEntities[light.entity], PointLightSource{ light.offset, light.color });
+		for (const SceneSpotLight& light : sceneFile.getSpotLights())
+			world.add(sceneEntities[light.entity], SpotLightSource{ light.offset, light.direction, light.edgeCoeff, light.color });
+		for (const ScenePath& path : sceneFile.getPaths())
+			world.add(sceneEntities[path.entity], FlashlightPath{ path.origin, path.heading, path.amplitude, path.speed, path.scale });
+		sceneCameras.assign(sceneFile.getCameras().begin(), sceneFile.getCameras().end());
+
+		world.each<const MeshRef, const Material>([](EntityId, const MeshRef& mesh, const Material& material)
+			{
+				if (material.occluder && !mesh.mesh->GetOccluder())
+					mesh.mesh->BuildOccluder();
+			});
+
+		moveFlashlights(0.0f, 0.0f, 0.0f);
+		updateLights();
+
+		// set the light properties that do not change once for every lighting shader variant
+		shaders.lighting.onCompile = [this](Shader& shader)
+			{
+				shader.setVec3("dirLight.direction", dirLight.direction);
+				shader.setVec3("dirLight.color", dirLight.color);
+				shader.setVec3("pointLights[0].color", pointLight.color);
+				shader.setFloat("spotLights[0].edgeCoeff", spotLight.edgeCoeff);
+				shader.setVec3("spotLights[0].color", spotLight.color);
+			};
+	}
+
+	DemoScene(const DemoScene&) = delete;
+	DemoScene& operator=(const DemoScene&) = delete;
+
+	// runs the systems of one simulation tick; the lights and cameras follow the entities moved first
+	void update(float time, float reflectorAngleX, float reflectorAngleY)
+	{
+		ProfileScope scope(profiler, "updateScene");
+
+		moveFlashlights(time, reflectorAngleX, reflectorAngleY);
+		updateLights();
+		updateCameraAttachments();
+	}
+
+	// moves every entity with a FlashlightPath along it at the time; the reflector angles turn it away from the path
+	void moveFlashlights(float time, float reflectorAngleX, float reflectorAngleY)
+	{
+		// the matrices of a chunk first, then their normal matrices in one batch
+		std::vector<glm::mat4> models;
+		world.eachChunk<ModelTransform, const FlashlightPath>([&](const EntityId*, size_t count, size_t, ModelTransform* transforms, const FlashlightPath* paths)
+			{
+				models.resize(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					const FlashlightPath& path = paths[i];
+					float angle;
+					const glm::vec3 position = calculateFlashlightPositionAndAngle(path.amplitude, time * path.speed, angle);
+
+					glm::mat4 model = glm::mat4(1.0f);
+					model = glm::translate(model, path.origin);
+					model = glm::rotate(model, glm::radians(path.heading), glm::vec3(0.0f, 1.0f, 0.0f));
+					model = glm::translate(model, position);
+					model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+					model = glm::rotate(model, reflectorAngleX, glm::vec3(0.0f, 1.0f, 0.0f));
+					model = glm::rotate(model, reflectorAngleY, glm::vec3(1.0f, 0.0f, 0.0f));
+					models[i] = glm::scale(model, glm::vec3(path.scale));
+				}
+				if (setModelTransforms(transforms, models.data(), count) > 0)
+					changes.touch();
+			});
+	}
+
+	// places pointLight and spotLight at their entities
+	void updateLights()
+	{
+		bool foundPointLight = false;
+		world.each<const ModelTransform, const PointLightSource>([&](EntityId, const ModelTransform& transform, const PointLightSource& source)
+			{
+				if (foundPointLight)
+					return;
+				foundPointLight = true;
+				const glm::vec3 position = glm::vec3(transform.model * glm::vec4(source.offset, 1.0f));
+				if (position != pointLight.position || source.color != pointLight.color)
+					changes.touch();
+				pointLight.position = position;
+				pointLight.color = source.color;
+			});
+
+		bool foundSpotLight = false;
+		world.each<const ModelTransform, const SpotLightSource>([&](EntityId, const ModelTransform& transform, const SpotLightSource& source)
+			{
+				if (foundSpotLight)
+					return;
+				foundSpotLight = true;
+				const glm::vec3 position = glm::vec3(transform.model * glm::vec4(source.offset, 1.0f));
+				const glm::vec3 direction = glm::vec3(transform.model * glm::vec4(source.direction, 0.0f));
+				if (position != spotLight.position || direction != spotLight.direction || source.color != spotLight.color || source.edgeCoeff != spotLight.edgeCoeff)
+					changes.touch();
+				spotLight = { position, direction, source.edgeCoeff, source.color };
+			});
+	}
+
+	// moves and turns the attached cameras with their targets
+	void updateCameraAttachments()
+	{
+		world.each<const CameraAttachment>([this](EntityId, const CameraAttachment& attachment)
+			{
+				const ModelTransform* target = world.get<ModelTransform>(attachment.target);
+				if (!target)
+					return;
+
+				Camera& camera = *attachment.camera;
+				if (attachment.mode == CameraAttachment::Mode::Follow)
+					camera.Position = glm::vec3(target->model * glm::vec4(attachment.offset, 1.0f));
+				camera.Front = glm::normalize(glm::vec3(target->model[3]) - camera.Position);
+			});
+	}
+
+	// places the camera like the scene file's camera of that role and attaches it to its
+	// target; returns false when the scene file has no such camera
+	bool placeCamera(Camera& camera, SceneCameraRole role)
+	{
+		for (const SceneCamera& record : sceneCameras)
+		{
+			if (record.role != role)
+				continue;
+			camera.Position = record.position;
+			camera.SetFront(glm::normalize(record.front));
+			if (record.attachment != SceneCameraAttachment::None)
+			{
+				const CameraAttachment::Mode mode = record.attachment == SceneCameraAttachment::Follow ? CameraAttachment::Mode::Follow : CameraAttachment::Mode::Watch;
+				attachCamera(camera, sceneEntities[record.target], mode, record.offset);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// makes camera follow or watch the target entity from now on, see CameraAttachment
+	EntityId attachCamera(Camera& camera, EntityId target, CameraAttachment::Mode mode, const glm::vec3& offset = glm::vec3(0.0f))
+	{
+		const EntityId attachment = world.create(CameraAttachment{ &camera, target, mode, offset });
+		updateCameraAttachments();
+		return attachment;
+	}
+
+	// model matrix of every entity that is drawn, in draw list order
+	void captureModels(std::vector<glm::mat4>& models)
+	{
+		models.resize(world.count<ModelTransform, MeshRef, Material>());
+		world.eachChunk<const ModelTransform, const MeshRef, const Material>([&models](const EntityId*, size_t count, size_t first, const ModelTransform* transforms, const MeshRef*, const Material*)
+			{
+				for (size_t i = 0; i < count; i++)
+					models[first + i] = transforms[i].model;
+			});
+	}
+
+	// records the main view of the camera and its reflection in the mirror
+	void setViews(FrameSnapshot& frame, Camera& camera, float aspect, float nearPlane, float farPlane) const
+	{
+		// main view
+		frame.mainView.projection = glm::perspective(glm::radians(camera.Zoom), aspect, nearPlane, farPlane);
+		frame.mainView.view = camera.GetViewMatrix();
+		frame.mainView.position = camera.Position;
+
+		// reflected view
+		glm::vec3 viewPos = glm::vec3(mirrorReflection * glm::vec4(camera.Position, 1.0f));
+		glm::vec3 viewDir = glm::vec3(mirrorReflection * glm::vec4(camera.Front, 0.0f));
+		glm::vec3 viewUp = glm::vec3(mirrorReflection * glm::vec4(camera.Up, 0.0f));
+
+		frame.reflectedView.projection = glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f)) * frame.mainView.projection;
+		frame.reflectedView.view = glm::lookAt(viewPos, viewPos + viewDir, viewUp);
+		frame.reflectedView.position = viewPos;
+	}
+
+	// records the spotlight and the draw list of the current object state; views and
+	// settings have to be set on the frame already, they count as changes too
+	void recordFrame(FrameSnapshot& frame)
+	{
+		if (frame.mainView != recordedView || frame.shaderFeatures != recordedFeatures || frame.fogIntensity != recordedFogIntensity)
+		{
+			changes.touch();
+			recordedView = frame.mainView;
+			recordedFeatures = frame.shaderFeatures;
+			recordedFogIntensity = frame.fogIntensity;
+		}
+		frame.changeCount = changes.get();
+
+		frame.pointLight = pointLight;
+		frame.spotLight = spotLight;
+
+		// one item for every entity with a ModelTransform, MeshRef and Material, chunk by chunk
+		frame.drawList.resize(world.count<ModelTransform, MeshRef, Material>());
+		world.parallelEachChunk<const ModelTransform, const MeshRef, const Material>(jobSystem, [&frame](const EntityId*, size_t count, size_t first, const ModelTransform* transforms, const MeshRef* meshes, const Material* materials)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					DrawItem& item = frame.drawList[first + i];
+					item = DrawItem();
+					item.mesh = meshes[i].mesh;
+					item.model = transforms[i].model;
+					item.normalModel = transforms[i].normalModel;
+					item.views = materials[i].reflected ? VIEW_MAIN | VIEW_REFLECTED : VIEW_MAIN;
+					item.occluder = materials[i].occluder ? meshes[i].mesh->GetOccluder() : nullptr;
+				}
+			}, "recordDrawList");
+	}
+
+	// computes the world bounds of the draw items, moves them in the visibility tree and marks
+	// the views every item is visible in, neither outside the frustum nor behind the
+	// occluders; call once the draw list matrices are final
+	void cullFrame(FrameSnapshot& frame)
+	{
+		ProfileScope scope(profiler, "cullFrame");
+
+		jobSystem.parallel_for(frame.drawList.size(), 256, [&frame](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					DrawItem& item = frame.drawList[i];
+					item.bounds = item.mesh->GetLocalBounds().transformed(item.model);
+					item.visibleViews = 0;
+				}
+			}, "drawItemBounds");
+
+		// the tree is rebuilt when entities with meshes came or went
+		if (visibilityProxies.size() != frame.drawList.size())
+		{
+			visibilityTree = DynamicAabbTree();
+			visibilityProxies.clear();
+			for (size_t i = 0; i < frame.drawList.size(); i++)
+				visibilityProxies.push_back(visibilityTree.insert(frame.drawList[i].bounds, static_cast<uint32_t>(i)));
+			selectedLods.assign(frame.drawList.size(), { 0, 0 });
+		}
+		for (size_t i = 0; i < frame.drawList.size(); i++)
+			visibilityTree.move(visibilityProxies[i], frame.drawList[i].bounds);
+
+		const ViewFrustum mainFrustum(frame.mainView.projection * frame.mainView.view);
+		visibilityTree.cull(mainFrustum, [&frame](uint32_t index) { frame.drawList[index].visibleViews |= frame.drawList[index].views & VIEW_MAIN; });
+		// the mirror only shows a part of the reflected view, its frustum is a conservative bound
+		const ViewFrustum reflectedFrustum(frame.reflectedView.projection * frame.reflectedView.view);
+		visibilityTree.cull(reflectedFrustum, [&frame](uint32_t index) { frame.drawList[index].visibleViews |= frame.drawList[index].views & VIEW_REFLECTED; });
+
+		cullOccluded(frame, mainOcclusion, frame.mainView, VIEW_MAIN);
+		cullOccluded(frame, reflectedOcclusion, frame.reflectedView, VIEW_REFLECTED);
+	}
+
+	// picks the level of detail of every draw item per view from the size of its error on screen
+	void selectLods(FrameSnapshot& frame)
+	{
+		ProfileScope scope(profiler, "selectLods");
+
+		jobSystem.parallel_for(frame.drawList.size(), 256, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					DrawItem& item = frame.drawList[i];
+					// the errors are in model units
+					const float scale = std::max({ glm::length(glm::vec3(item.model[0])), glm::length(glm::vec3(item.model[1])), glm::length(glm::vec3(item.model[2])) });
+
+					std::array<unsigned int, 2>& selected = selectedLods[i];
+					if (item.visibleViews & VIEW_MAIN)
+						selected[0] = selectLod(*item.mesh, scale * getPixelsPerUnit(frame.mainView, item.bounds, frame.viewportHeight), lodErrorPixels, selected[0]);
+					if (item.visibleViews & VIEW_REFLECTED)
+						selected[1] = selectLod(*item.mesh, scale * getPixelsPerUnit(frame.reflectedView, item.bounds, frame.viewportHeight), lodErrorPixels * reflectedLodBias, selected[1]);
+					item.mainLod = selected[0];
+					item.reflectedLod = selected[1];
+				}
+			}, "selectLods");
+	}
+
+	// true once no shader variant would block the render thread on first use
+	bool isReady() const
+	{
+		return shaders.skybox.isReady() && shaders.lighting.isReady() && shaders.constant.isReady();
+	}
+
+	// counts of the last rendered frame
+	const RenderStats& getStats() const
+	{
+		return stats;
+	}
+
+	// renders one frame into the bound framebuffer
+	void render(const FrameSnapshot& frame, GpuProfiler& gpuProfiler)
+	{
+		stats = RenderStats();
+
+		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		glStencilMask(0x00);
+
+		// select shader variants for the current settings
+		Shader& lightingShader = shaders.lighting.get(frame.shaderFeatures);
+		Shader& skyboxShader = shaders.skybox.get(frame.shaderFeatures);
+		Shader& constantShader = shaders.constant.get(0);
+
+		lightingShader.use();
+
+		// set global uniforms
+		lightingShader.setVec3("pointLights[0].position", frame.pointLight.position);
+		lightingShader.setVec3("spotLights[0].position", frame.spotLight.position);
+		lightingShader.setVec3("spotLights[0].direction", frame.spotLight.direction);
+		lightingShader.setFloat("fogIntensity", frame.fogIntensity);
+		lightingShader.setVec3("fogColor", fogColor);
+
+		unsigned int cubemapTexture = frame.isDay ? cubemapDayTexture : cubemapNightTexture;
+		gpuProfiler.begin("main");
+		drawScene(lightingShader, frame.drawList, frame.mainView, VIEW_MAIN);
+
+		// draw skybox as last
+		gpuProfiler.begin("skybox");
+		drawSkybox(skyboxShader, cubemapTexture, glm::mat4(glm::mat3(frame.mainView.view)), frame.mainView.projection);
+
+
+		// RENDER MIRROR
+		// -------------
+		gpuProfiler.begin("mirror stencil");
+		glStencilFunc(GL_ALWAYS, 1, 0xFF);
+		glStencilMask(0xFF);
+
+		constantShader.use();
+		constantShader.setMat4("projection", frame.mainView.projection);
+		constantShader.setMat4("view", frame.mainView.view);
+
+		mirror.Draw(constantShader);
+		stats.drawCalls++;
+		stats.triangles += 2;
+
+		glStencilFunc(GL_EQUAL, 1, 0xFF);
+		glStencilMask(0x00);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		// -------------
+
+
+
+		// RENDER REFLECTED OBJECTS
+		// ------------------------
+		gpuProfiler.begin("reflected");
+		lightingShader.use();
+		drawScene(lightingShader, frame.drawList, frame.reflectedView, VIEW_REFLECTED);
+
+		gpuProfiler.begin("reflected skybox");
+		drawSkybox(skyboxShader, cubemapTexture, glm::mat4(glm::mat3(frame.reflectedView.view)), frame.reflectedView.projection);
+		gpuProfiler.end();
+
+		glStencilMask(0xFF);
+		glStencilFunc(GL_ALWAYS, 1, 0xFF);
+		// ------------------------
+	}
+
+	static unsigned int loadCubemap(JobSystem& jobSystem, const std::vector<std::string>& faces)
+	{
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+		// decode all faces in parallel, only the upload has to happen on the GL thread
+		struct Face
+		{
+			unsigned char* data;
+			int width, height, nrChannels;
+		};
+		std::vector<Face> decoded(faces.size());
+		jobSystem.parallel_for(faces.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				Face& face = decoded[i];
+				face.data = stbi_load(faces[i].c_str(), &face.width, &face.height, &face.nrChannels, 0);
+			}
+		}, "loadCubemap");
+
+		for (unsigned int i = 0; i < faces.size(); i++)
+		{
+			const Face& face = decoded[i];
+			if (face.data)
+			{
+				GLenum format = 0;
+				if (face.nrChannels == 1)
+					format = GL_RED;
+				else if (face.nrChannels == 3)
+					format = GL_RGB;
+				else if (face.nrChannels == 4)
+					format = GL_RGBA;
+
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, face.width, face.height, 0, format, GL_UNSIGNED_BYTE, face.data);
+				stbi_image_free(face.data);
+			}
+			else
+			{
+				std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
+				stbi_image_free(face.data);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+		return textureID;
+	}
+
+private:
+	// the mirror quad in its model space, two triangles in the z = 0 plane
+	static std::array<float, 18> getMirrorVertices(const glm::vec2& halfSize)
+	{
+		const float x = halfSize.x;
+		const float y = halfSize.y;
+		return {
+			-x, -y, 0.0f,
+			-x,  y, 0.0f,
+			 x,  y, 0.0f,
+
+			 x,  y, 0.0f,
+			 x, -y, 0.0f,
+			-x, -y, 0.0f,
+		};
+	}
+
+	// the reflection at the plane the mirror model puts the quad's z = 0 plane in
+	static glm::mat4 getReflection(const glm::mat4& mirrorModel)
+	{
+		const glm::vec3 normal = glm::normalize(normalMatrix(mirrorModel) * glm::vec3(0.0f, 0.0f, 1.0f));
+		const float distance = glm::dot(normal, glm::vec3(mirrorModel[3]));
+		// I - 2 n n^T, moved by twice the plane's distance from the origin along n
+		glm::mat4 reflection = glm::mat4(glm::mat3(1.0f) - 2.0f * glm::outerProduct(normal, normal));
+		reflection[3] = glm::vec4(2.0f * distance * normal, 1.0f);
+		return reflection;
+	}
+
+	static glm::vec3 calculateFlashlightPositionAndAngle(float A, float time, float& angle)
+	{
+		float x = A * glm::sin(time);
+		float z = x * glm::cos(time);
+
+
+		float dx = A * glm::cos(time);
+		float dz = A * glm::cos(2 * time);
+
+		angle = glm::atan(dx, dz);
+		return glm::vec3(x, 0.0f, z);
+	}
+
+	// rasterizes the occluders in the view on the CPU and clears the view bit of the items they hide
+	void cullOccluded(FrameSnapshot& frame, OcclusionCuller& culler, const ViewState& viewState, unsigned int view)
+	{
+		ProfileScope scope(profiler, "cullOccluded");
+
+		culler.begin(viewState.projection * viewState.view);
+		for (const DrawItem& item : frame.drawList)
+		{
+			if (item.occluder && (item.visibleViews & view))
+				culler.addOccluder(*item.occluder, item.model);
+		}
+		culler.rasterize(jobSystem);
+
+		for (DrawItem& item : frame.drawList)
+		{
+			if ((item.visibleViews & view) && !culler.isVisible(item.bounds))
+				item.visibleViews &= ~view;
+		}
+	}
+
+	// pixels a world unit covers at the point of the box closest to the camera
+	static float getPixelsPerUnit(const ViewState& viewState, const BoundingBox& bounds, float viewportHeight)
+	{
+		const float distance = glm::length(glm::clamp(viewState.position, bounds.min, bounds.max) - viewState.position);
+		return 0.5f * viewportHeight * viewState.projection[1][1] / std::max(distance, 1e-3f);
+	}
+
+	// the coarsest level whose error stays within maxPixels; levels coarser than the current
+	// one have to stay within the hysteresis fraction of it
+	unsigned int selectLod(const RenderMesh& mesh, float pixelsPerUnit, float maxPixels, unsigned int current) const
+	{
+		unsigned int lod = 0;
+		for (unsigned int i = 1; i < mesh.GetLodCount(); i++)
+		{
+			const float limit = i > current ? maxPixels * lodHysteresis : maxPixels;
+			if (mesh.GetLodError(i) * pixelsPerUnit > limit)
+				break;
+			lod = i;
+		}
+		return lod;
+	}
+
+	void drawObjects(Shader& shader, const std::vector<DrawItem>& drawList, const ViewState& viewState, unsigned int view)
+	{
+		// the matrices the meshes are culled with, of all visible items in one batch
+		std::vector<const DrawItem*> visible;
+		std::vector<glm::mat4> models;
+		for (const DrawItem& item : drawList)
+		{
+			if (!(item.visibleViews & view))
+			{
+				stats.culledObjects++;
+				continue;
+			}
+			visible.push_back(&item);
+			models.push_back(item.model);
+		}
+		std::vector<glm::mat4> modelViewProjections(models.size());
+		multiplyMatrices(viewState.projection * viewState.view, models.data(), modelViewProjections.data(), models.size());
+
+		for (size_t i = 0; i < visible.size(); i++)
+		{
+			const DrawItem& item = *visible[i];
+			const unsigned int lod = view == VIEW_MAIN ? item.mainLod : item.reflectedLod;
+			const MeshDrawCounts counts = item.mesh->Draw(shader, item.model, item.normalModel, modelViewProjections[i], lod);
+			stats.drawCalls += counts.drawCalls;
+			stats.triangles += counts.triangles;
+			stats.culledMeshes += static_cast<unsigned int>(item.mesh->GetMeshCount()) - counts.drawCalls;
+			stats.objects++;
+		}
+	}
+
+	void drawScene(Shader& lightingShader, const std::vector<DrawItem>& drawList, const ViewState& viewState, unsigned int view)
+	{
+		ProfileScope scope(profiler, "drawScene");
+
+		// set observer position
+		lightingShader.setVec3("viewPos", viewState.position);
+
+		// view/projection transformations
+		lightingShader.setMat4("projection", viewState.projection);
+		lightingShader.setMat4("view", viewState.view);
+
+		// render objects
+		drawObjects(lightingShader, drawList, viewState, view);
+	}
+
+	void drawSkybox(Shader& shader, unsigned int cubemapTexture, glm::mat4 view, glm::mat4 projection)
+	{
+		ProfileScope scope(profiler, "skybox");
+
+		shader.use();
+		shader.setVec3("fogColor", fogColor);
+		shader.setMat4("view", view);
+		shader.setMat4("projection", projection);
+		skybox.Draw(shader, cubemapTexture);
+		stats.drawCalls++;
+		stats.triangles += 12;
+	}
+};
@@ -0,0 +1,894 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#pragma warning(push, 0)
+#include <learnopengl/transform_hierarchy.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#pragma warning(pop)
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Scene files describe what DemoScene loads: meshes, entities with their
+// transforms, lights and paths, the cameras, the sun and the mirror. They are
+// written as text and compiled into a binary form that is mapped into memory
+// and read in place, without parsing or copying.
+//
+// The text form has one statement per line, # starts a comment:
+//
+//   sun DIRECTION COLOR
+//   mirror [position XYZ] [rotation XYZ] [scale S|XYZ] [size WIDTH HEIGHT]
+//   mesh NAME PATH                 path relative to the repository root
+//   entity [NAME]                  the lines up to the next entity describe it
+//     mesh NAME                    a mesh declared above; entities without one are not drawn
+//     position XYZ
+//     rotation XYZ                 Euler angles in degrees, applied Y * X * Z
+//     scale S|XYZ
+//     occluder                     hides what is behind it from the occlusion culler
+//     hidden_in_mirror
+//     point_light OFFSET COLOR
+//     spot_light OFFSET DIRECTION EDGE_COEFF COLOR
+//     path ORIGIN HEADING AMPLITUDE SPEED SCALE   see FlashlightPath
+//   camera still|pointed|attached [position XYZ] [front XYZ] [follow|watch ENTITY] [offset XYZ]
+//
+// The binary form is a SceneFileHeader followed by one flat array per
+// SceneSection. The entity sections are parallel arrays indexed by entity,
+// lights, paths and cameras refer to entities by index. Everything is stored
+// little endian with 4 byte alignment, as the demo's targets lay it out in
+// memory, so the arrays are used where they are mapped.
+
+enum class SceneSection : uint32_t
+{
+	Settings,
+	// characters of the mesh paths
+	Strings,
+	Meshes,
+	// per entity: model matrix, mesh index and SceneEntityFlag bits
+	Transforms,
+	EntityMeshes,
+	EntityFlags,
+	PointLights,
+	SpotLights,
+	Paths,
+	Cameras,
+	Count
+};
+
+enum SceneEntityFlag : uint32_t
+{
+	SCENE_OCCLUDER = 1 << 0,
+	SCENE_HIDDEN_IN_MIRROR = 1 << 1,
+};
+
+// an entity or mesh index that refers to nothing
+constexpr uint32_t sceneNone = UINT32_MAX;
+
+struct SceneSettings
+{
+	glm::vec3 sunDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec3 sunColor = glm::vec3(0.5f);
+	glm::mat4 mirrorModel = glm::mat4(1.0f);
+	// half the width and height of the mirror quad before mirrorModel; zero for no mirror
+	glm::vec2 mirrorHalfSize = glm::vec2(0.0f);
+};
+
+struct SceneMesh
+{
+	uint32_t pathOffset;
+	uint32_t pathLength;
+};
+
+struct ScenePointLight
+{
+	uint32_t entity;
+	glm::vec3 offset;
+	glm::vec3 color;
+};
+
+struct SceneSpotLight
+{
+	uint32_t entity;
+	glm::vec3 offset;
+	glm::vec3 direction;
+	float edgeCoeff;
+	glm::vec3 color;
+};
+
+struct ScenePath
+{
+	uint32_t entity;
+	glm::vec3 origin;
+	float heading;
+	float amplitude;
+	float speed;
+	float scale;
+};
+
+// the cameras the demo switches between
+enum class SceneCameraRole : uint32_t
+{
+	Still,
+	Pointed,
+	Attached,
+};
+
+enum class SceneCameraAttachment : uint32_t
+{
+	None,
+	Follow,
+	Watch,
+};
+
+struct SceneCamera
+{
+	SceneCameraRole role;
+	SceneCameraAttachment attachment;
+	// the entity followed or watched, sceneNone without attachment
+	uint32_t target;
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 offset;
+};
+
+struct SceneSectionRange
+{
+	// bytes from the start of the file
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct SceneFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t sectionCount;
+	SceneSectionRange sections[static_cast<size_t>(SceneSection::Count)];
+};
+
+constexpr char sceneFileMagic[8] = { 'D', 'E', 'M', 'O', 'S', 'C', 'N', '\0' };
+constexpr uint32_t sceneFileVersion = 1;
+
+// the record size of every section, in SceneSection order
+constexpr uint32_t sceneRecordSizes[] = {
+	sizeof(SceneSettings), sizeof(char), sizeof(SceneMesh), sizeof(glm::mat4), sizeof(uint32_t), sizeof(uint32_t),
+	sizeof(ScenePointLight), sizeof(SceneSpotLight), sizeof(ScenePath), sizeof(SceneCamera)
+};
+static_assert(std::size(sceneRecordSizes) == static_cast<size_t>(SceneSection::Count), "every section needs a record size");
+// the layout is the file format; padding or alignment changes would break existing files
+static_assert(sizeof(SceneSettings) == 96 && sizeof(ScenePointLight) == 28 && sizeof(SceneSpotLight) == 44
+	&& sizeof(ScenePath) == 32 && sizeof(SceneCamera) == 48 && sizeof(glm::mat4) == 64, "scene records must not be padded");
+
+// a record array of a scene file
+template <typename T>
+struct SceneArray
+{
+	const T* data = nullptr;
+	uint32_t count = 0;
+
+	const T* begin() const { return data; }
+	const T* end() const { return data + count; }
+	uint32_t size() const { return count; }
+	const T& operator[](uint32_t index) const { return data[index]; }
+};
+
+// The content of a scene as growing arrays, filled by the text parser or by code
+// that generates scenes, and turned into the binary form by serialize().
+struct SceneDescription
+{
+	SceneSettings settings;
+	std::string strings;
+	std::vector<SceneMesh> meshes;
+	std::vector<glm::mat4> transforms;
+	std::vector<uint32_t> entityMeshes;
+	std::vector<uint32_t> entityFlags;
+	std::vector<ScenePointLight> pointLights;
+	std::vector<SceneSpotLight> spotLights;
+	std::vector<ScenePath> paths;
+	std::vector<SceneCamera> cameras;
+
+	uint32_t addMesh(const std::string& path)
+	{
+		meshes.push_back({ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(path.size()) });
+		strings += path;
+		return static_cast<uint32_t>(meshes.size() - 1);
+	}
+
+	uint32_t addEntity(const glm::mat4& model, uint32_t mesh, uint32_t flags = 0)
+	{
+		transforms.push_back(model);
+		entityMeshes.push_back(mesh);
+		entityFlags.push_back(flags);
+		return static_cast<uint32_t>(transforms.size() - 1);
+	}
+
+	// the binary form: the header, then every section at a 16 byte boundary
+	std::vector<uint8_t> serialize() const
+	{
+		SceneFileHeader header = {};
+		std::memcpy(header.magic, sceneFileMagic, sizeof(header.magic));
+		header.version = sceneFileVersion;
+		header.sectionCount = static_cast<uint32_t>(SceneSection::Count);
+
+		const std::pair<const void*, size_t> sections[] = {
+			{ &settings, 1 }, { strings.data(), strings.size() }, { meshes.data(), meshes.size() },
+			{ transforms.data(), transforms.size() }, { entityMeshes.data(), entityMeshes.size() }, { entityFlags.data(), entityFlags.size() },
+			{ pointLights.data(), pointLights.size() }, { spotLights.data(), spotLights.size() }, { paths.data(), paths.size() },
+			{ cameras.data(), cameras.size() }
+		};
+
+		size_t size = sizeof(SceneFileHeader);
+		for (size_t i = 0; i < std::size(sections); i++)
+		{
+			size = (size + 15) & ~size_t(15);
+			header.sections[i] = { static_cast<uint32_t>(size), static_cast<uint32_t>(sections[i].second) };
+			size += sections[i].second * sceneRecordSizes[i];
+		}
+
+		std::vector<uint8_t> image(size, 0);
+		std::memcpy(image.data(), &header, sizeof(header));
+		for (size_t i = 0; i < std::size(sections); i++)
+		{
+			if (sections[i].second > 0)
+				std::memcpy(image.data() + header.sections[i].offset, sections[i].first, sections[i].second * sceneRecordSizes[i]);
+		}
+		return image;
+	}
+};
+
+// A whole file mapped read-only into memory.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	bool open(const std::string& path)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		HANDLE mapping = NULL;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping)
+		{
+			// the view keeps the mapping alive
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			size = data ? static_cast<size_t>(fileSize.QuadPart) : 0;
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+#else
+		const int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+		{
+			void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (mapped != MAP_FAILED)
+			{
+				data = static_cast<const uint8_t*>(mapped);
+				size = static_cast<size_t>(status.st_size);
+			}
+		}
+		::close(file);
+#endif
+		return data != nullptr;
+	}
+
+	void close()
+	{
+		if (!data)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<uint8_t*>(data), size);
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	const uint8_t* getData() const
+	{
+		return data;
+	}
+
+	size_t getSize() const
+	{
+		return size;
+	}
+
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+// A loaded scene file. Compiled files are mapped and read in place; text files
+// are parsed and compiled in memory, so both are read through the same arrays.
+// The arrays stay valid as long as the SceneFile.
+class SceneFile
+{
+public:
+	SceneFile() = default;
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+
+	// loads the compiled or text scene at path, told apart by the magic at its
+	// start; prints the error and returns false when the file is invalid
+	bool load(const std::string& path)
+	{
+		close();
+		if (!mapping.open(path))
+		{
+			std::cout << "ERROR::SCENE_FILE::NOT_FOUND " << path << std::endl;
+			return false;
+		}
+		if (mapping.getSize() >= sizeof(sceneFileMagic) && std::memcmp(mapping.getData(), sceneFileMagic, sizeof(sceneFileMagic)) == 0)
+			return open(mapping.getData(), mapping.getSize(), path);
+
+		const std::string text(reinterpret_cast<const char*>(mapping.getData()), mapping.getSize());
+		mapping.close();
+		SceneDescription description;
+		if (!parse(text, path, description))
+			return false;
+		image = description.serialize();
+		return open(image.data(), image.size(), path);
+	}
+
+	// reads the scene from a description instead of a file
+	bool load(const SceneDescription& description)
+	{
+		close();
+		image = description.serialize();
+		return open(image.data(), image.size(), "description");
+	}
+
+	// parses the text scene at textPath and writes its binary form to binaryPath
+	static bool compile(const std::string& textPath, const std::string& binaryPath)
+	{
+		std::ifstream input(textPath, std::ios::binary);
+		if (!input)
+		{
+			std::cout << "ERROR::SCENE_FILE::NOT_FOUND " << textPath << std::endl;
+			return false;
+		}
+		std::stringstream text;
+		text << input.rdbuf();
+
+		SceneDescription description;
+		if (!parse(text.str(), textPath, description))
+			return false;
+		const std::vector<uint8_t> compiled = description.serialize();
+
+		std::ofstream output(binaryPath, std::ios::binary | std::ios::trunc);
+		output.write(reinterpret_cast<const char*>(compiled.data()), static_cast<std::streamsize>(compiled.size()));
+		if (!output)
+		{
+			std::cout << "ERROR::SCENE_FILE::NOT_WRITTEN " << binaryPath << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// parses the text form into description; prints the first error and returns false on failure
+	static bool parse(const std::string& text, const std::string& name, SceneDescription& description)
+	{
+		TextParser parser(name, description);
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			if (!parser.parseLine(line))
+				return false;
+		}
+		return parser.finish();
+	}
+
+	// the file is mapped rather than parsed
+	bool isMapped() const
+	{
+		return mapping.getData() != nullptr;
+	}
+
+	const SceneSettings& getSettings() const
+	{
+		return *getSection<SceneSettings>(SceneSection::Settings).data;
+	}
+
+	SceneArray<SceneMesh> getMeshes() const
+	{
+		return getSection<SceneMesh>(SceneSection::Meshes);
+	}
+
+	std::string_view getMeshPath(uint32_t mesh) const
+	{
+		const SceneMesh& record = getMeshes()[mesh];
+		return std::string_view(getSection<char>(SceneSection::Strings).data + record.pathOffset, record.pathLength);
+	}
+
+	uint32_t getEntityCount() const
+	{
+		return getSection<glm::mat4>(SceneSection::Transforms).count;
+	}
+
+	SceneArray<glm::mat4> getTransforms() const
+	{
+		return getSection<glm::mat4>(SceneSection::Transforms);
+	}
+
+	// mesh index per entity, sceneNone for entities that are not drawn
+	SceneArray<uint32_t> getEntityMeshes() const
+	{
+		return getSection<uint32_t>(SceneSection::EntityMeshes);
+	}
+
+	// SceneEntityFlag bits per entity
+	SceneArray<uint32_t> getEntityFlags() const
+	{
+		return getSection<uint32_t>(SceneSection::EntityFlags);
+	}
+
+	SceneArray<ScenePointLight> getPointLights() const
+	{
+		return getSection<ScenePointLight>(SceneSection::PointLights);
+	}
+
+	SceneArray<SceneSpotLight> getSpotLights() const
+	{
+		return getSection<SceneSpotLight>(SceneSection::SpotLights);
+	}
+
+	SceneArray<ScenePath> getPaths() const
+	{
+		return getSection<ScenePath>(SceneSection::Paths);
+	}
+
+	SceneArray<SceneCamera> getCameras() const
+	{
+		return getSection<SceneCamera>(SceneSection::Cameras);
+	}
+
+private:
+	MappedFile mapping;
+	// the compiled form of a parsed text file
+	std::vector<uint8_t> image;
+	const uint8_t* data = nullptr;
+
+	void close()
+	{
+		mapping.close();
+		image.clear();
+		data = nullptr;
+	}
+
+	template <typename T>
+	SceneArray<T> getSection(SceneSection section) const
+	{
+		const SceneSectionRange& range = reinterpret_cast<const SceneFileHeader*>(data)->sections[static_cast<size_t>(section)];
+		return { reinterpret_cast<const T*>(data + range.offset), range.count };
+	}
+
+	// checks everything the accessors rely on once, so they need no checks
+	bool open(const uint8_t* bytes, size_t size, const std::string& name)
+	{
+		auto fail = [&](const char* message)
+			{
+				std::cout << "ERROR::SCENE_FILE::INVALID " << name << ": " << message << std::endl;
+				close();
+				return false;
+			};
+
+		if (size < sizeof(SceneFileHeader))
+			return fail("truncated header");
+		const SceneFileHeader* header = reinterpret_cast<const SceneFileHeader*>(bytes);
+		if (std::memcmp(header->magic, sceneFileMagic, sizeof(sceneFileMagic)) != 0)
+			return fail("not a scene file");
+		if (header->version != sceneFileVersion || header->sectionCount != static_cast<uint32_t>(SceneSection::Count))
+			return fail("unsupported version");
+		for (size_t i = 0; i < static_cast<size_t>(SceneSection::Count); i++)
+		{
+			const SceneSectionRange& range = header->sections[i];
+			if (range.offset % 4 != 0 || range.offset < sizeof(SceneFileHeader)
+				|| static_cast<uint64_t>(range.offset) + static_cast<uint64_t>(range.count) * sceneRecordSizes[i] > size)
+				return fail("section out of bounds");
+		}
+		data = bytes;
+
+		if (getSection<SceneSettings>(SceneSection::Settings).count != 1)
+			return fail("missing settings");
+		const uint32_t stringLength = getSection<char>(SceneSection::Strings).count;
+		for (const SceneMesh& mesh : getMeshes())
+		{
+			if (static_cast<uint64_t>(mesh.pathOffset) + mesh.pathLength > stringLength)
+				return fail("mesh path out of bounds");
+		}
+
+		const uint32_t entityCount = getEntityCount();
+		if (getEntityMeshes().count != entityCount || getEntityFlags().count != entityCount)
+			return fail("entity arrays differ in length");
+		const uint32_t meshCount = getMeshes().count;
+		for (uint32_t mesh : getEntityMeshes())
+		{
+			if (mesh != sceneNone && mesh >= meshCount)
+				return fail("entity mesh out of bounds");
+		}
+		for (const ScenePointLight& light : getPointLights())
+		{
+			if (light.entity >= entityCount)
+				return fail("point light entity out of bounds");
+		}
+		for (const SceneSpotLight& light : getSpotLights())
+		{
+			if (light.entity >= entityCount)
+				return fail("spot light entity out of bounds");
+		}
+		for (const ScenePath& path : getPaths())
+		{
+			if (path.entity >= entityCount)
+				return fail("path entity out of bounds");
+		}
+		for (const SceneCamera& camera : getCameras())
+		{
+			if (static_cast<uint32_t>(camera.role) > static_cast<uint32_t>(SceneCameraRole::Attached)
+				|| static_cast<uint32_t>(camera.attachment) > static_cast<uint32_t>(SceneCameraAttachment::Watch)
+				|| (camera.attachment != SceneCameraAttachment::None && camera.target >= entityCount))
+				return fail("camera out of bounds");
+		}
+		return true;
+	}
+
+	// the state of parsing the text form line by line
+	class TextParser
+	{
+	public:
+		TextParser(const std::string& name, SceneDescription& description)
+			: name(name), description(description)
+		{
+		}
+
+		bool parseLine(const std::string& line)
+		{
+			lineNumber++;
+			tokens.clear();
+			std::istringstream words(line.substr(0, line.find('#')));
+			std::string word;
+			while (words >> word)
+				tokens.push_back(word);
+			if (tokens.empty())
+				return true;
+
+			next = 1;
+			const std::string& keyword = tokens[0];
+			if (keyword == "sun")
+				return readVec3(description.settings.sunDirection) && readVec3(description.settings.sunColor) && atEnd();
+			if (keyword == "mirror")
+				return parseMirror();
+			// mesh NAME PATH declares a mesh, mesh NAME inside an entity uses one
+			if (keyword == "mesh" && (!inEntity || tokens.size() > 2))
+				return parseMesh();
+			if (keyword == "entity")
+				return parseEntity();
+			if (keyword == "camera")
+				return parseCamera();
+			if (inEntity)
+				return parseEntityProperty(keyword);
+			return fail("unknown statement " + keyword);
+		}
+
+		// resolves the entity names of the cameras
+		bool finish()
+		{
+			finishEntity();
+			for (const PendingTarget& pending : pendingTargets)
+			{
+				lineNumber = pending.line;
+				const auto entity = entityNames.find(pending.name);
+				if (entity == entityNames.end())
+					return fail("unknown entity " + pending.name);
+				description.cameras[pending.camera].target = entity->second;
+			}
+			return true;
+		}
+
+	private:
+		struct Placement
+		{
+			glm::vec3 position = glm::vec3(0.0f);
+			glm::vec3 rotation = glm::vec3(0.0f);
+			glm::vec3 scale = glm::vec3(1.0f);
+		};
+
+		struct PendingTarget
+		{
+			size_t camera;
+			std::string name;
+			unsigned int line;
+		};
+
+		const std::string& name;
+		SceneDescription& description;
+		std::vector<std::string> tokens;
+		size_t next = 0;
+		unsigned int lineNumber = 0;
+
+		std::unordered_map<std::string, uint32_t> meshNames;
+		std::unordered_map<std::string, uint32_t> entityNames;
+		std::vector<PendingTarget> pendingTargets;
+
+		// the entity the property lines describe
+		bool inEntity = false;
+		Placement placement;
+
+		bool fail(const std::string& message)
+		{
+			std::cout << "ERROR::SCENE_FILE::PARSE_FAILED " << name << ":" << lineNumber << ": " << message << std::endl;
+			return false;
+		}
+
+		bool atEnd()
+		{
+			return next == tokens.size() || fail("unexpected " + tokens[next]);
+		}
+
+		bool isNumber(size_t index) const
+		{
+			if (index >= tokens.size())
+				return false;
+			char* end;
+			std::strtof(tokens[index].c_str(), &end);
+			return end != tokens[index].c_str() && *end == '\0';
+		}
+
+		bool readFloat(float& value)
+		{
+			if (!isNumber(next))
+				return fail(next < tokens.size() ? "expected a number instead of " + tokens[next] : "expected a number");
+			value = std::strtof(tokens[next++].c_str(), nullptr);
+			return true;
+		}
+
+		bool readVec3(glm::vec3& value)
+		{
+			return readFloat(value.x) && readFloat(value.y) && readFloat(value.z);
+		}
+
+		// one number for a uniform scale or three
+		bool readScale(glm::vec3& value)
+		{
+			if (isNumber(next + 1))
+				return readVec3(value);
+			float uniform;
+			if (!readFloat(uniform))
+				return false;
+			value = glm::vec3(uniform);
+			return true;
+		}
+
+		bool readWord(std::string& word)
+		{
+			if (next >= tokens.size())
+				return fail("expected a name after " + tokens[next - 1]);
+			word = tokens[next++];
+			return true;
+		}
+
+		// position, rotation and scale keywords; returns false without error when the token is something else
+		bool readPlacement(Placement& target, bool& matched)
+		{
+			const std::string& keyword = tokens[next];
+			matched = true;
+			next++;
+			if (keyword == "position")
+				return readVec3(target.position);
+			if (keyword == "rotation")
+				return readVec3(target.rotation);
+			if (keyword == "scale")
+				return readScale(target.scale);
+			next--;
+			matched = false;
+			return true;
+		}
+
+		bool parseMirror()
+		{
+			Placement mirror;
+			glm::vec2 size = glm::vec2(0.0f);
+			while (next < tokens.size())
+			{
+				bool matched;
+				if (!readPlacement(mirror, matched))
+					return false;
+				if (matched)
+					continue;
+				if (tokens[next] != "size")
+					return fail("unexpected " + tokens[next]);
+				next++;
+				if (!readFloat(size.x) || !readFloat(size.y))
+					return false;
+			}
+			description.settings.mirrorModel = composeTransform(mirror.position, mirror.rotation, mirror.scale);
+			description.settings.mirrorHalfSize = size * 0.5f;
+			return true;
+		}
+
+		bool parseMesh()
+		{
+			std::string meshName;
+			if (!readWord(meshName) || next >= tokens.size())
+				return fail("expected mesh NAME PATH");
+			if (meshNames.count(meshName))
+				return fail("mesh " + meshName + " declared twice");
+			std::string path = tokens[next++];
+			// paths may contain spaces
+			while (next < tokens.size())
+				path += " " + tokens[next++];
+			meshNames[meshName] = description.addMesh(path);
+			return true;
+		}
+
+		bool parseEntity()
+		{
+			finishEntity();
+			const uint32_t entity = description.addEntity(glm::mat4(1.0f), sceneNone);
+			inEntity = true;
+			placement = Placement();
+			if (next < tokens.size())
+			{
+				std::string entityName;
+				readWord(entityName);
+				if (entityNames.count(entityName))
+					return fail("entity " + entityName + " declared twice");
+				entityNames[entityName] = entity;
+			}
+			return atEnd();
+		}
+
+		// the transform is composed once all of the entity's lines are read
+		void finishEntity()
+		{
+			if (inEntity)
+				description.transforms.back() = composeTransform(placement.position, placement.rotation, placement.scale);
+			inEntity = false;
+		}
+
+		bool parseEntityProperty(const std::string& keyword)
+		{
+			const uint32_t entity = static_cast<uint32_t>(description.transforms.size() - 1);
+			next = 0;
+			bool matched;
+			if (!readPlacement(placement, matched))
+				return false;
+			if (matched)
+				return atEnd();
+
+			next = 1;
+			if (keyword == "mesh")
+			{
+				std::string meshName;
+				if (!readWord(meshName))
+					return false;
+				const auto mesh = meshNames.find(meshName);
+				if (mesh == meshNames.end())
+					return fail("unknown mesh " + meshName);
+				description.entityMeshes[entity] = mesh->second;
+				return atEnd();
+			}
+			if (keyword == "occluder")
+			{
+				description.entityFlags[entity] |= SCENE_OCCLUDER;
+				return atEnd();
+			}
+			if (keyword == "hidden_in_mirror")
+			{
+				description.entityFlags[entity] |= SCENE_HIDDEN_IN_MIRROR;
+				return atEnd();
+			}
+			if (keyword == "point_light")
+			{
+				ScenePointLight light = { entity, glm::vec3(0.0f), glm::vec3(1.0f) };
+				if (!readVec3(light.offset) || !readVec3(light.color))
+					return false;
+				description.pointLights.push_back(light);
+				return atEnd();
+			}
+			if (keyword == "spot_light")
+			{
+				SceneSpotLight light = { entity, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 50.0f, glm::vec3(1.0f) };
+				if (!readVec3(light.offset) || !readVec3(light.direction) || !readFloat(light.edgeCoeff) || !readVec3(light.color))
+					return false;
+				description.spotLights.push_back(light);
+				return atEnd();
+			}
+			if (keyword == "path")
+			{
+				ScenePath path = { entity, glm::vec3(0.0f), 0.0f, 5.0f, 0.5f, 1.0f };
+				if (!readVec3(path.origin) || !readFloat(path.heading) || !readFloat(path.amplitude) || !readFloat(path.speed) || !readFloat(path.scale))
+					return false;
+				description.paths.push_back(path);
+				return atEnd();
+			}
+			return fail("unknown entity property " + keyword);
+		}
+
+		bool parseCamera()
+		{
+			SceneCamera camera = { SceneCameraRole::Still, SceneCameraAttachment::None, sceneNone, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f) };
+			std::string role;
+			if (!readWord(role))
+				return false;
+			if (role == "still")
+				camera.role = SceneCameraRole::Still;
+			else if (role == "pointed")
+				camera.role = SceneCameraRole::Pointed;
+			else if (role == "attached")
+				camera.role = SceneCameraRole::Attached;
+			else
+				return fail("unknown camera " + role);
+
+			while (next < tokens.size())
+			{
+				const std::string& keyword = tokens[next++];
+				if (keyword == "position")
+				{
+					if (!readVec3(camera.position))
+						return false;
+				}
+				else if (keyword == "front")
+				{
+					if (!readVec3(camera.front))
+						return false;
+				}
+				else if (keyword == "offset")
+				{
+					if (!readVec3(camera.offset))
+						return false;
+				}
+				else if (keyword == "follow" || keyword == "watch")
+				{
+					camera.attachment = keyword == "follow" ? SceneCameraAttachment::Follow : SceneCameraAttachment::Watch;
+					std::string target;
+					if (!readWord(target))
+						return false;
+					pendingTargets.push_back({ description.cameras.size(), target, lineNumber });
+				}
+				else
+					return fail("unexpected " + keyword);
+			}
+			description.cameras.push_back(camera);
+			return true;
+		}
+	};
+};
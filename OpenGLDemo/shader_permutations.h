@@ -0,0 +1,170 @@
+#pragma once
+#include <learnopengl/shader_m.h>
+
+#include "program_cache.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Features that are resolved at compile time instead of with uniform branches.
+// Each set bit injects the matching #define into the shader sources.
+enum ShaderFeature : unsigned int
+{
+	FEATURE_BLINN = 1 << 0,
+	FEATURE_DAY = 1 << 1,
+	FEATURE_FOG = 1 << 2,
+};
+
+class ShaderPermutations
+{
+	struct Variant
+	{
+		Shader shader;
+		uint64_t cacheKey = 0;
+		// compiled from source, so the binary still has to be written to the cache
+		bool needsStore = false;
+		// linked and onCompile has run
+		bool initialized = false;
+	};
+
+	std::string vertexCode;
+	std::string fragmentCode;
+	std::vector<std::pair<unsigned int, std::string>> features;
+	std::vector<std::pair<std::string, int>> constants;
+	std::unordered_map<unsigned int, Variant> variants;
+	unsigned int featureMask = 0;
+
+public:
+	// called once for every newly compiled variant with the program bound,
+	// used to upload uniforms that never change afterwards
+	std::function<void(Shader&)> onCompile;
+	// optional on-disk cache of linked program binaries
+	ProgramCache* programCache = nullptr;
+
+	ShaderPermutations(const char* vertexPath, const char* fragmentPath)
+		: vertexCode(Shader::readFile(vertexPath)), fragmentCode(Shader::readFile(fragmentPath))
+	{
+	}
+
+	// features and constants have to be registered before the first variant is requested
+	void addFeature(unsigned int bit, const std::string& define)
+	{
+		features.emplace_back(bit, define);
+		featureMask |= bit;
+	}
+
+	void setConstant(const std::string& name, int value)
+	{
+		constants.emplace_back(name, value);
+	}
+
+	// returns the variant for the given features; bits this shader does not know about
+	// are ignored. The first call for a variant waits for its program to finish linking.
+	Shader& get(unsigned int mask)
+	{
+		Variant& variant = submit(mask);
+		if (!variant.initialized)
+			initialize(variant);
+		return variant.shader;
+	}
+
+	// hands every combination of the registered features to the driver without waiting
+	// for any of them, so compilation overlaps with whatever the caller does next
+	void submitAll()
+	{
+		// iterate over all subsets of featureMask
+		unsigned int mask = 0;
+		do
+		{
+			submit(mask);
+			mask = (mask - featureMask) & featureMask;
+		} while (mask != 0);
+	}
+
+	// true when no submitted variant would block on first use
+	bool isReady() const
+	{
+		for (const auto& [mask, variant] : variants)
+		{
+			if (!variant.initialized && !variant.shader.isReady())
+				return false;
+		}
+		return true;
+	}
+
+	size_t variantCount() const
+	{
+		return variants.size();
+	}
+
+	// inserts the defines right after the #version directive, which has to stay first
+	static std::string injectDefines(const std::string& source, const std::string& defines)
+	{
+		const size_t versionPos = source.find("#version");
+		if (versionPos == std::string::npos)
+			return defines + source;
+
+		const size_t lineEnd = source.find('\n', versionPos);
+		if (lineEnd == std::string::npos)
+			return source + "\n" + defines;
+
+		return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+	}
+
+private:
+	// starts building the variant unless it already exists; restores it from the
+	// program cache when possible, otherwise submits it to the compiler
+	Variant& submit(unsigned int mask)
+	{
+		mask &= featureMask;
+		auto it = variants.find(mask);
+		if (it != variants.end())
+			return it->second;
+
+		const std::string defines = buildDefines(mask);
+		const std::string vertexVariant = injectDefines(vertexCode, defines);
+		const std::string fragmentVariant = injectDefines(fragmentCode, defines);
+
+		uint64_t cacheKey = 0;
+		if (programCache)
+		{
+			cacheKey = programCache->makeKey(vertexVariant, fragmentVariant, defines);
+			if (unsigned int program = programCache->load(cacheKey))
+				return variants.emplace(mask, Variant{ Shader::fromProgram(program), cacheKey, false }).first->second;
+		}
+
+		return variants.emplace(mask, Variant{ Shader::fromSource(vertexVariant, fragmentVariant), cacheKey, programCache != nullptr }).first->second;
+	}
+
+	void initialize(Variant& variant)
+	{
+		const bool linked = variant.shader.finishBuild();
+		if (linked && variant.needsStore)
+			programCache->store(variant.cacheKey, variant.shader.ID);
+		variant.needsStore = false;
+
+		if (onCompile)
+		{
+			variant.shader.use();
+			onCompile(variant.shader);
+		}
+		variant.initialized = true;
+	}
+
+	std::string buildDefines(unsigned int mask) const
+	{
+		std::string defines;
+		for (const auto& [bit, name] : features)
+		{
+			if (mask & bit)
+				defines += "#define " + name + "\n";
+		}
+		for (const auto& [name, value] : constants)
+			defines += "#define " + name + " " + std::to_string(value) + "\n";
+		return defines;
+	}
+};
@@ -0,0 +1,151 @@
+#pragma once
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Advances simulation time in fixed ticks, independent of the frame rate.
+// Real time is accumulated every frame and consumed a tick at a time, so the
+// same sequence of inputs always produces the same sequence of states. The
+// remainder of the accumulator is the fraction the display lies between the
+// last two ticks, see getAlpha. A slow frame runs at most maxTicksPerFrame
+// ticks and drops the rest of the time instead of snowballing.
+class SimulationClock
+{
+public:
+	SimulationClock(double tickRate = 60.0, unsigned int maxTicksPerFrame = 8)
+		: tickDuration(1.0 / tickRate), maxTicksPerFrame(maxTicksPerFrame)
+	{
+	}
+
+	double getTickDuration() const
+	{
+		return tickDuration;
+	}
+
+	uint64_t getTick() const
+	{
+		return tick;
+	}
+
+	// simulation time of the last tick
+	double getTime() const
+	{
+		return tick * tickDuration;
+	}
+
+	// how far the display is between the previous and the last tick, in [0, 1)
+	double getAlpha() const
+	{
+		return std::min(accumulator / tickDuration, 1.0);
+	}
+
+	// time the interpolated state shows; one tick behind getTime at alpha 0
+	double getInterpolatedTime() const
+	{
+		return std::max(0.0, getTime() - (1.0 - getAlpha()) * tickDuration);
+	}
+
+	void pause()
+	{
+		paused = true;
+	}
+
+	void resume()
+	{
+		paused = false;
+	}
+
+	bool isPaused() const
+	{
+		return paused;
+	}
+
+	// runs the given number of ticks with the next frame, also while paused
+	void step(unsigned int ticks = 1)
+	{
+		pendingSteps += ticks;
+	}
+
+	// scales real time before it is accumulated; ticks keep their fixed length
+	void setTimeScale(double scale)
+	{
+		timeScale = std::max(0.0, scale);
+	}
+
+	double getTimeScale() const
+	{
+		return timeScale;
+	}
+
+	// adds the real time that passed since the last frame; the ticks it makes due
+	// are then taken with consumeTick
+	void advance(double realSeconds)
+	{
+		if (!paused)
+			accumulator += std::max(0.0, realSeconds) * timeScale;
+
+		unsigned int ticks = static_cast<unsigned int>(accumulator / tickDuration);
+		accumulator -= ticks * tickDuration;
+		if (ticks > maxTicksPerFrame)
+		{
+			droppedTicks += ticks - maxTicksPerFrame;
+			ticks = maxTicksPerFrame;
+		}
+		pendingTicks += ticks + pendingSteps;
+		pendingSteps = 0;
+	}
+
+	// moves to the next tick if one is due; run one simulation step per true result
+	bool consumeTick()
+	{
+		if (pendingTicks == 0)
+			return false;
+		pendingTicks--;
+		tick++;
+		return true;
+	}
+
+	// ticks skipped because frames took longer than maxTicksPerFrame ticks
+	uint64_t getDroppedTicks() const
+	{
+		return droppedTicks;
+	}
+
+private:
+	double tickDuration;
+	unsigned int maxTicksPerFrame;
+
+	uint64_t tick = 0;
+	double accumulator = 0.0;
+	unsigned int pendingTicks = 0;
+	unsigned int pendingSteps = 0;
+	uint64_t droppedTicks = 0;
+
+	bool paused = false;
+	double timeScale = 1.0;
+};
+
+// blends two affine transforms for display: translation and scale linearly,
+// rotation along the shortest arc
+inline glm::mat4 interpolateTransform(const glm::mat4& from, const glm::mat4& to, float alpha)
+{
+	if (from == to)
+		return to;
+
+	glm::vec3 fromScale, toScale, fromTranslation, toTranslation, skew;
+	glm::quat fromRotation, toRotation;
+	glm::vec4 perspective;
+	if (!glm::decompose(from, fromScale, fromRotation, fromTranslation, skew, perspective) ||
+		!glm::decompose(to, toScale, toRotation, toTranslation, skew, perspective))
+		return to;
+
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::mix(fromTranslation, toTranslation, alpha));
+	model *= glm::mat4_cast(glm::slerp(fromRotation, toRotation, alpha));
+	return glm::scale(model, glm::mix(fromScale, toScale, alpha));
+}
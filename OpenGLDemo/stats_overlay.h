@@ -0,0 +1,114 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include "text_overlay.h"
+#include "frame_pacer.h"
+#include "frame_state.h"
+#include "profiler.h"
+
+// Live frame metrics in the top left corner: a frame-time graph, pacing,
+// draw counts and the GPU pass timings. Text is formatted into a stack
+// buffer, so drawing the overlay does not allocate once the batch has grown.
+class StatsOverlay
+{
+public:
+	static constexpr size_t graphLength = 120;
+
+	StatsOverlay(ProgramCache& programCache) : text(programCache)
+	{
+	}
+
+	void addFrameTime(double milliseconds)
+	{
+		frameTimes[graphIndex % graphLength] = static_cast<float>(milliseconds);
+		graphIndex++;
+	}
+
+	// draws into the bound framebuffer of the given size; the scene was rendered at renderWidth x renderHeight
+	void draw(int width, int height, int renderWidth, int renderHeight, const FramePacingStats& pacing, const RenderStats& renderStats, const std::vector<GpuPassTiming>& passes)
+	{
+		const float lineHeight = text.getLineHeight();
+		const float panelWidth = std::max(graphLength * barWidth, panelColumns * text.getTextWidth(" ")) + 2 * margin;
+		const float panelHeight = (6 + passes.size()) * lineHeight + graphHeight + 3.5f * margin;
+
+		text.begin(width, height);
+		text.rect(margin, margin, panelWidth, panelHeight, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+
+		const float x = 2 * margin;
+		float y = 2 * margin;
+		char line[64];
+
+		const double lastFrame = frameTimes[(graphIndex + graphLength - 1) % graphLength];
+		std::snprintf(line, sizeof(line), "FRAME %6.2f MS  %5.0f FPS", lastFrame, lastFrame > 0.0 ? 1000.0 / lastFrame : 0.0);
+		text.text(x, y, line, white);
+		y += lineHeight;
+		std::snprintf(line, sizeof(line), "MEAN %.2f  SD %.2f  MAX %.1f", pacing.mean, pacing.standardDeviation, pacing.max);
+		text.text(x, y, line, grey);
+		y += lineHeight + margin / 2;
+
+		drawGraph(x, y);
+		y += graphHeight + margin;
+
+		std::snprintf(line, sizeof(line), "DRAW CALLS %u  TRIS %.1fK", renderStats.drawCalls, renderStats.triangles / 1000.0);
+		text.text(x, y, line, white);
+		y += lineHeight;
+		std::snprintf(line, sizeof(line), "OBJECTS %u  CULLED %u (+%u MESHES)", renderStats.objects, renderStats.culledObjects, renderStats.culledMeshes);
+		text.text(x, y, line, white);
+		y += lineHeight;
+		std::snprintf(line, sizeof(line), "RES %dX%d  %3.0f%%", renderWidth, renderHeight, 100.0 * renderWidth / std::max(width, 1));
+		text.text(x, y, line, white);
+		y += lineHeight;
+
+		double gpuTotal = 0.0;
+		for (const GpuPassTiming& pass : passes)
+		{
+			std::snprintf(line, sizeof(line), "%-18s %6.2f MS", pass.name, pass.milliseconds);
+			text.text(x, y, line, grey);
+			y += lineHeight;
+			gpuTotal += pass.milliseconds;
+		}
+		std::snprintf(line, sizeof(line), "%-18s %6.2f MS", "GPU TOTAL", gpuTotal);
+		text.text(x, y, line, white);
+
+		text.draw();
+	}
+
+private:
+	// characters in the widest line, a pass timing
+	static constexpr int panelColumns = 28;
+	static constexpr float margin = 8.0f;
+	static constexpr float barWidth = 3.0f;
+	static constexpr float graphHeight = 64.0f;
+	// frame time at the top of the graph
+	static constexpr float graphScale = 1000.0f / 30.0f;
+	static constexpr glm::vec4 white = glm::vec4(1.0f);
+	static constexpr glm::vec4 grey = glm::vec4(0.75f, 0.75f, 0.75f, 1.0f);
+
+	TextOverlay text;
+	std::array<float, graphLength> frameTimes{};
+	size_t graphIndex = 0;
+
+	// oldest frame on the left; green within 60 Hz, yellow within 30 Hz, red beyond
+	void drawGraph(float x, float y)
+	{
+		text.rect(x, y, graphLength * barWidth, graphHeight, glm::vec4(1.0f, 1.0f, 1.0f, 0.1f));
+		for (size_t i = 0; i < graphLength; i++)
+		{
+			const float frameTime = frameTimes[(graphIndex + i) % graphLength];
+			if (frameTime <= 0.0f)
+				continue;
+
+			const float barHeight = std::min(frameTime / graphScale, 1.0f) * graphHeight;
+			const glm::vec4 color = frameTime <= 1000.0f / 60.0f ? glm::vec4(0.3f, 0.9f, 0.3f, 1.0f)
+				: frameTime <= 1000.0f / 30.0f ? glm::vec4(0.9f, 0.8f, 0.2f, 1.0f) : glm::vec4(0.9f, 0.3f, 0.2f, 1.0f);
+			text.rect(x + i * barWidth, y + graphHeight - barHeight, barWidth - 1.0f, barHeight, color);
+		}
+		// 60 Hz line
+		text.rect(x, y + graphHeight * (1.0f - (1000.0f / 60.0f) / graphScale), graphLength * barWidth, 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.4f));
+	}
+};
@@ -0,0 +1,283 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#pragma warning(push, 0)
+#include <learnopengl/shader_m.h>
+#pragma warning(pop)
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "shader_permutations.h"
+#include "program_cache.h"
+
+// Screen-space text and rectangles for debug overlays. Everything queued
+// between begin and draw goes into one vertex buffer and is drawn with a
+// single call; rectangles sample a solid block of the glyph atlas so they
+// share the batch with the text. Uses a built-in 5x7 bitmap font covering
+// ASCII 32-95, lowercase letters are drawn as uppercase.
+class TextOverlay
+{
+public:
+	static constexpr int glyphWidth = 5;
+	static constexpr int glyphHeight = 7;
+	// glyph plus spacing, in font pixels
+	static constexpr int cellWidth = 6;
+	static constexpr int cellHeight = 9;
+
+	TextOverlay(ProgramCache& programCache, float scale = 2.0f)
+		: shader("Shaders/overlay_shader.vert", "Shaders/overlay_shader.frag"), scale(scale)
+	{
+		shader.programCache = &programCache;
+		shader.onCompile = [](Shader& shader)
+			{
+				shader.setInt("atlas", 0);
+			};
+		shader.submitAll();
+
+		createAtlas();
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+		glBindVertexArray(0);
+	}
+
+	~TextOverlay()
+	{
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteTextures(1, &atlasTexture);
+	}
+
+	TextOverlay(const TextOverlay&) = delete;
+	TextOverlay& operator=(const TextOverlay&) = delete;
+
+	float getLineHeight() const
+	{
+		return cellHeight * scale;
+	}
+
+	float getTextWidth(std::string_view text) const
+	{
+		return text.size() * cellWidth * scale;
+	}
+
+	// starts a new batch for a screen of the given size in pixels
+	void begin(int width, int height)
+	{
+		screenSize = glm::vec2(width, height);
+		vertices.clear();
+	}
+
+	// queues text with its top left corner at x, y; returns the x after the last glyph
+	float text(float x, float y, std::string_view text, const glm::vec4& color)
+	{
+		const uint32_t packedColor = glm::packUnorm4x8(color);
+		for (char c : text)
+		{
+			if (c >= 'a' && c <= 'z')
+				c -= 'a' - 'A';
+			if (c < firstGlyph || c >= firstGlyph + glyphCount)
+				c = '?';
+
+			if (c != ' ')
+			{
+				const int glyph = c - firstGlyph;
+				const glm::vec2 cell = glm::vec2(glyph % atlasColumns * cellWidth, glyph / atlasColumns * cellHeight);
+				addQuad(glm::vec2(x, y), glm::vec2(glyphWidth, glyphHeight) * scale, cell, cell + glm::vec2(glyphWidth, glyphHeight), packedColor);
+			}
+			x += cellWidth * scale;
+		}
+		return x;
+	}
+
+	// queues a filled rectangle
+	void rect(float x, float y, float width, float height, const glm::vec4& color)
+	{
+		// inner texels of the solid block, so filtering never reaches a glyph
+		const glm::vec2 solid = glm::vec2(1.0f, atlasRows * cellHeight + 1.0f);
+		addQuad(glm::vec2(x, y), glm::vec2(width, height), solid, solid + glm::vec2(1.0f), glm::packUnorm4x8(color));
+	}
+
+	// draws everything queued since begin into the bound framebuffer with one draw call
+	void draw()
+	{
+		if (vertices.empty())
+			return;
+
+		const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		const GLboolean stencilTest = glIsEnabled(GL_STENCIL_TEST);
+		const GLboolean blend = glIsEnabled(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		Shader& overlayShader = shader.get(0);
+		overlayShader.use();
+		overlayShader.setVec2("screenSize", screenSize);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, atlasTexture);
+
+		// orphan last frame's storage instead of waiting for the GPU to finish reading it
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+		glBindVertexArray(0);
+
+		if (depthTest)
+			glEnable(GL_DEPTH_TEST);
+		if (stencilTest)
+			glEnable(GL_STENCIL_TEST);
+		if (!blend)
+			glDisable(GL_BLEND);
+	}
+
+private:
+	struct Vertex
+	{
+		glm::vec2 position;
+		glm::vec2 texCoords;
+		uint32_t color;
+	};
+
+	static constexpr char firstGlyph = ' ';
+	static constexpr int glyphCount = 64;
+	static constexpr int atlasColumns = 16;
+	static constexpr int atlasRows = glyphCount / atlasColumns;
+	// one extra row of cells holds the solid block used by rect
+	static constexpr int atlasWidth = atlasColumns * cellWidth;
+	static constexpr int atlasHeight = (atlasRows + 1) * cellHeight;
+
+	// one byte per row, bit 4 is the leftmost pixel
+	static constexpr uint8_t font[glyphCount * glyphHeight] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // space
+		0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04,  // !
+		0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00,  // "
+		0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A,  // #
+		0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04,  // $
+		0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03,  // %
+		0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D,  // &
+		0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,  // '
+		0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02,  // (
+		0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08,  // )
+		0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00,  // *
+		0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00,  // +
+		0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x08,  // ,
+		0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00,  // -
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04,  // .
+		0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00,  // /
+		0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E,  // 0
+		0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E,  // 1
+		0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F,  // 2
+		0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E,  // 3
+		0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02,  // 4
+		0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E,  // 5
+		0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E,  // 6
+		0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08,  // 7
+		0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E,  // 8
+		0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C,  // 9
+		0x00, 0x04, 0x04, 0x00, 0x04, 0x04, 0x00,  // :
+		0x00, 0x04, 0x04, 0x00, 0x04, 0x04, 0x08,  // ;
+		0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02,  // <
+		0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00,  // =
+		0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08,  // >
+		0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04,  // ?
+		0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E,  // @
+		0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11,  // A
+		0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E,  // B
+		0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E,  // C
+		0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C,  // D
+		0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F,  // E
+		0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10,  // F
+		0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F,  // G
+		0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11,  // H
+		0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E,  // I
+		0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C,  // J
+		0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11,  // K
+		0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F,  // L
+		0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11,  // M
+		0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11,  // N
+		0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E,  // O
+		0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10,  // P
+		0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D,  // Q
+		0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11,  // R
+		0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E,  // S
+		0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,  // T
+		0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E,  // U
+		0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04,  // V
+		0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A,  // W
+		0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11,  // X
+		0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04,  // Y
+		0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F,  // Z
+		0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E,  // [
+		0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00,  // backslash
+		0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E,  // ]
+		0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00,  // ^
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F,  // _
+	};
+
+	ShaderPermutations shader;
+	float scale;
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
+	unsigned int atlasTexture = 0;
+	glm::vec2 screenSize = glm::vec2(1.0f);
+	std::vector<Vertex> vertices;
+
+	void createAtlas()
+	{
+		std::vector<uint8_t> pixels(atlasWidth * atlasHeight, 0);
+		for (int glyph = 0; glyph < glyphCount; glyph++)
+		{
+			const int cellX = glyph % atlasColumns * cellWidth;
+			const int cellY = glyph / atlasColumns * cellHeight;
+			for (int row = 0; row < glyphHeight; row++)
+				for (int column = 0; column < glyphWidth; column++)
+					if (font[glyph * glyphHeight + row] & (0x10 >> column))
+						pixels[(cellY + row) * atlasWidth + cellX + column] = 0xFF;
+		}
+		for (int y = atlasRows * cellHeight; y < atlasHeight; y++)
+			for (int x = 0; x < cellWidth; x++)
+				pixels[y * atlasWidth + x] = 0xFF;
+
+		glGenTextures(1, &atlasTexture);
+		glBindTexture(GL_TEXTURE_2D, atlasTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		// rows are stored top down, so texel rows match screen rows
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// two triangles; the texture rectangle is given in atlas texels
+	void addQuad(glm::vec2 position, glm::vec2 size, glm::vec2 texelMin, glm::vec2 texelMax, uint32_t color)
+	{
+		const glm::vec2 atlasSize = glm::vec2(atlasWidth, atlasHeight);
+		const glm::vec2 uvMin = texelMin / atlasSize;
+		const glm::vec2 uvMax = texelMax / atlasSize;
+
+		const Vertex topLeft = { position, uvMin, color };
+		const Vertex topRight = { glm::vec2(position.x + size.x, position.y), glm::vec2(uvMax.x, uvMin.y), color };
+		const Vertex bottomLeft = { glm::vec2(position.x, position.y + size.y), glm::vec2(uvMin.x, uvMax.y), color };
+		const Vertex bottomRight = { position + size, uvMax, color };
+
+		vertices.insert(vertices.end(), { topLeft, bottomLeft, bottomRight, bottomRight, topRight, topLeft });
+	}
+};